@@ -1,15 +1,79 @@
-QT       += core gui widgets
-
-CONFIG += c++17
-
-SOURCES += main.cpp \
-    villagereditor.cpp
-
-HEADERS += \
-    villagereditor.h
-
-# 生成可执行文件
-TARGET = VillagerTradeEditor
-DESTDIR = ./bin
-RESOURCES += resources.qrc
-RC_ICONS = resources/icons/VillagerTradeEditor.ico
+QT       += core gui widgets concurrent network
+
+CONFIG += c++17
+
+# 内存分配统计构建：qmake CONFIG+=memtrace（按阶段统计分配，Ctrl+Alt+M 查看）。
+# 只支持 Linux（glibc）：其他平台上 Qt 库内部的分配无法接管，统计没有意义，不启用
+memtrace {
+    linux {
+        DEFINES += VTE_MEMTRACE
+    } else {
+        warning("memtrace 只支持 Linux（glibc），本次构建不启用内存分配统计")
+    }
+}
+
+SOURCES += main.cpp \
+    batchexport.cpp \
+    bulkedit.cpp \
+    catalogservice.cpp \
+    commandline.cpp \
+    corpusgenerator.cpp \
+    csvtokenizer.cpp \
+    documentcache.cpp \
+    documentio.cpp \
+    documenttabs.cpp \
+    editjournal.cpp \
+    filefingerprint.cpp \
+    guibenchmark.cpp \
+    itemcatalog.cpp \
+    itemidresolver.cpp \
+    jsonescape.cpp \
+    layeredcatalog.cpp \
+    memtrace.cpp \
+    nbtcodec.cpp \
+    nbtvalidator.cpp \
+    singleinstance.cpp \
+    stallwatchdog.cpp \
+    startuptiming.cpp \
+    tracer.cpp \
+    tradefields.cpp \
+    tradequery.cpp \
+    undostack.cpp \
+    villagereditor.cpp
+
+HEADERS += \
+    batchexport.h \
+    bulkedit.h \
+    catalogservice.h \
+    commandline.h \
+    corpusgenerator.h \
+    csvtokenizer.h \
+    documentcache.h \
+    documentio.h \
+    documenttabs.h \
+    editjournal.h \
+    filefingerprint.h \
+    guibenchmark.h \
+    itemcatalog.h \
+    itemidresolver.h \
+    jsonescape.h \
+    layeredcatalog.h \
+    memtrace.h \
+    nbtcodec.h \
+    nbtvalidator.h \
+    persistentlist.h \
+    singleinstance.h \
+    stallwatchdog.h \
+    startuptiming.h \
+    tracer.h \
+    tradedata.h \
+    tradefields.h \
+    tradequery.h \
+    undostack.h \
+    villagereditor.h
+
+# 生成可执行文件
+TARGET = VillagerTradeEditor
+DESTDIR = ./bin
+RESOURCES += resources.qrc
+RC_ICONS = resources/icons/VillagerTradeEditor.ico
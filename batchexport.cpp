@@ -0,0 +1,372 @@
+#include "batchexport.h"
+#include "layeredcatalog.h"
+#include "nbtcodec.h"
+#include "tradefields.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentMap>
+#include <utility>
+
+namespace {
+
+const quint32 kManifestMagic = 0x56544242;   // "VTBB"
+const quint32 kManifestVersion = 1;
+const char kManifestName[] = ".vtebuild";
+const int kWatchDelayMs = 300;   // 保存文件时常常连续触发几次变化，合并后再导出
+
+QString outputName(const QString &inputPath, int index, int count)
+{
+    const QString stem = QFileInfo(inputPath).completeBaseName();
+    return count > 1 ? QString("%1-%2.json").arg(stem).arg(index + 1) : stem + ".json";
+}
+
+} // namespace
+
+struct BatchExporter::InputResult {
+    QString path;
+    FileFingerprint stat;
+    VillagerDocument document;   // 写入后清空
+    QStringList outputs;
+    QList<QPair<QString, OutputEntry>> written;
+    int skipped = 0;
+    QString error;
+};
+
+BatchExporter::BatchExporter(const QStringList &inputs, const QString &outputDir, QObject *parent)
+    : QObject(parent)
+    , m_inputs(inputs)
+    , m_outputDir(QDir(outputDir).absolutePath())
+{
+    QDir().mkpath(m_outputDir);
+    loadManifest();
+
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(kWatchDelayMs);
+    connect(&m_debounce, &QTimer::timeout, this, &BatchExporter::rebuildTouched);
+}
+
+QByteArray BatchExporter::exportKey(const VillagerData &villager, const QByteArray &catalogVersion)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << qint32(NbtCodec::kSerializerVersion) << catalogVersion
+        << villager.profession << qint32(villager.markVariant) << quint32(villager.trades.size());
+    for (TradeOption trade : villager.trades) {
+        NbtCodec::materialize(trade);   // 键覆盖全部字段，先展开一次，避免每个字段各展开一次
+        for (int f = 0; f < TradeFields::FieldCount; ++f) {
+            const QVariant v = TradeFields::value(trade, f);
+            if (v.metaType().id() == QMetaType::QJsonArray) {   // 自定义节点按紧凑 JSON 计入
+                out << QJsonDocument(v.toJsonArray()).toJson(QJsonDocument::Compact);
+            } else {
+                out << v;
+            }
+        }
+    }
+    return FileFingerprint::hashData(data);
+}
+
+QStringList BatchExporter::expandInputs() const
+{
+    QStringList files;
+    for (const QString &input : m_inputs) {
+        const QFileInfo info(input);
+        if (info.isDir()) {
+            const QFileInfoList entries = QDir(info.absoluteFilePath()).entryInfoList({ "*.json" }, QDir::Files, QDir::Name);
+            for (const QFileInfo &entry : entries) {
+                if (entry.absolutePath() != m_outputDir) files.append(entry.absoluteFilePath());
+            }
+        } else {
+            files.append(info.absoluteFilePath());
+        }
+    }
+    return files;
+}
+
+bool BatchExporter::inputUpToDate(const QString &path, const FileFingerprint &stat) const
+{
+    const auto it = m_inputEntries.constFind(path);
+    if (m_force || it == m_inputEntries.cend()) return false;
+    if (!it->stat.sameStat(stat) || it->catalogVersion != m_catalogVersion) return false;
+    for (const QString &name : it->outputs) {
+        const auto out = m_outputEntries.constFind(name);
+        if (out == m_outputEntries.cend() || !out->stat.sameStat(FileFingerprint::fromStat(m_outputDir + "/" + name))) return false;
+    }
+    return true;
+}
+
+void BatchExporter::refreshCatalog()
+{
+    // 物品库版本参与缓存键：物品库变化后所有输出都重新导出。每次构建都检查，只有变化的层才重新加载
+    m_catalog.refresh(LayeredCatalog::declaredLayers());
+    m_catalogVersion = m_catalog.version();
+}
+
+BatchExporter::InputResult BatchExporter::parseInput(const QString &path) const
+{
+    InputResult result;
+    result.path = path;
+    result.stat = FileFingerprint::fromStat(path);
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        result.error = QString("%1：%2").arg(QDir::toNativeSeparators(path), file.errorString());
+        return result;
+    }
+    QString parseError;
+    result.document = NbtCodec::parseDocument(QString::fromUtf8(file.readAll()), &parseError);
+    file.close();
+    if (!parseError.isEmpty()) {
+        // 监视模式下文件可能还没写完：不写任何输出，也不把它记为已导出，下次变化时再试
+        result.error = QString("%1：%2").arg(QDir::toNativeSeparators(path), parseError);
+        result.document = VillagerDocument();
+        return result;
+    }
+
+    const int count = result.document.villagers.size();
+    for (int i = 0; i < count; ++i) result.outputs.append(outputName(path, i, count));
+    return result;
+}
+
+void BatchExporter::writeOutputs(InputResult &result) const
+{
+    for (int i = 0; i < result.document.villagers.size(); ++i) {
+        const VillagerData &villager = result.document.villagers[i];
+        const QString &name = result.outputs[i];
+        const QString outPath = m_outputDir + "/" + name;
+
+        // 键相同且输出文件还是上次写入的样子：跳过编码与写入
+        const QByteArray key = exportKey(villager, m_catalogVersion);
+        const auto cached = m_outputEntries.constFind(name);
+        if (!m_force && cached != m_outputEntries.cend() && cached->key == key
+            && cached->stat.sameStat(FileFingerprint::fromStat(outPath))) {
+            ++result.skipped;
+            continue;
+        }
+
+        QSaveFile out(outPath);
+        const QByteArray data = NbtCodec::serialize(villager.trades, villager.profession, villager.markVariant).toUtf8();
+        if (!out.open(QIODevice::WriteOnly) || out.write(data) != data.size() || !out.commit()) {
+            result.error = QString("%1：%2").arg(QDir::toNativeSeparators(outPath), out.errorString());
+            continue;
+        }
+        result.written.append({ name, OutputEntry{ key, FileFingerprint::fromStat(outPath) } });
+    }
+    result.document = VillagerDocument();
+}
+
+BatchExporter::Stats BatchExporter::build()
+{
+    return build(expandInputs());
+}
+
+BatchExporter::Stats BatchExporter::build(const QStringList &files)
+{
+    Stats stats;
+    refreshCatalog();
+    QStringList pending;
+    for (const QString &path : files) {
+        const FileFingerprint stat = FileFingerprint::fromStat(path);
+        if (!stat.isValid()) {
+            // 输入被删除：清除它留下的输出
+            const InputEntry entry = m_inputEntries.take(path);
+            for (const QString &name : entry.outputs) {
+                if (QFile::remove(m_outputDir + "/" + name)) ++stats.removed;
+                m_outputEntries.remove(name);
+            }
+            continue;
+        }
+        if (inputUpToDate(path, stat)) {
+            stats.skipped += m_inputEntries.value(path).outputs.size();
+            continue;
+        }
+        if (!pending.contains(path)) pending.append(path);
+    }
+    pending.sort();   // 输出文件名冲突时按路径顺序决定归属，每次结果相同
+
+    // 各输入互不相关，并行解析；清单只在主线程中更新
+    QList<InputResult> results = QtConcurrent::blockingMapped<QList<InputResult>>(pending, [this](const QString &path) {
+        return parseInput(path);
+    });
+
+    // 输出文件名只由输入的文件名决定，不同输入可能得到同一个名字（a/foo.json 与 b/foo.json，
+    // 或有多个村民的 foo.json 与输入 foo-1.json）。写入前为每个名字确定唯一的输入：
+    // 本次不重新导出的输入保留原有的名字，其余按路径顺序，冲突的输入报错且不写入
+    QHash<QString, QString> owners;   // 输出文件名 -> 输入路径
+    const QStringList current = expandInputs();
+    for (const QString &path : current) {
+        if (pending.contains(path)) continue;
+        const auto it = m_inputEntries.constFind(path);
+        if (it == m_inputEntries.cend()) continue;
+        for (const QString &name : it->outputs) owners.insert(name, path);
+    }
+    for (InputResult &result : results) {
+        if (!result.error.isEmpty()) continue;
+        for (const QString &name : std::as_const(result.outputs)) {
+            const QString owner = owners.value(name, result.path);
+            if (owner == result.path) continue;
+            result.error = QString("%1：输出文件名 %2 与 %3 冲突，未导出")
+                               .arg(QDir::toNativeSeparators(result.path), name, QDir::toNativeSeparators(owner));
+            break;
+        }
+        if (!result.error.isEmpty()) {
+            result.document = VillagerDocument();
+            continue;
+        }
+        for (const QString &name : std::as_const(result.outputs)) owners.insert(name, result.path);
+    }
+
+    // 名字已互不相同，各输入并行编码与写入
+    QtConcurrent::blockingMap(results, [this](InputResult &result) {
+        if (result.error.isEmpty()) writeOutputs(result);
+    });
+
+    for (const InputResult &result : std::as_const(results)) {
+        stats.written += result.written.size();
+        stats.skipped += result.skipped;
+        if (!result.error.isEmpty()) stats.errors.append(result.error);
+        for (const auto &entry : result.written) m_outputEntries.insert(entry.first, entry.second);
+
+        // 有输出写入失败（或输入读取失败、文件名冲突）时让这个输入下次重新检查，保留上次的输出列表
+        if (!result.error.isEmpty()) {
+            m_inputEntries[result.path].stat = FileFingerprint();
+            continue;
+        }
+        // 村民变少时删除多出来的旧输出；已归另一个输入的名字不删
+        const InputEntry previous = m_inputEntries.value(result.path);
+        for (const QString &name : previous.outputs) {
+            if (result.outputs.contains(name) || owners.contains(name)) continue;
+            if (QFile::remove(m_outputDir + "/" + name)) ++stats.removed;
+            m_outputEntries.remove(name);
+        }
+        m_inputEntries.insert(result.path, InputEntry{ result.stat, m_catalogVersion, result.outputs });
+    }
+    saveManifest();
+    return stats;
+}
+
+void BatchExporter::watch()
+{
+    for (const QString &input : m_inputs) {
+        const QFileInfo info(input);
+        if (info.isDir()) m_watcher.addPath(info.absoluteFilePath());
+    }
+    const QStringList files = expandInputs();
+    if (!files.isEmpty()) m_watcher.addPaths(files);
+    watchCatalog();
+
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path) {
+        // 物品库变化改变所有输出的键，全部重新检查
+        if (catalogFiles().contains(path)) m_rescan = true;
+        else m_touched.insert(path);
+        m_debounce.start();
+    });
+    // 目录变化：新增或删除了文件
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+        m_rescan = true;
+        m_debounce.start();
+    });
+    qInfo().noquote() << QString("[导出] 正在监视 %1 个输入文件，按 Ctrl+C 结束").arg(files.size());
+}
+
+void BatchExporter::rebuildTouched()
+{
+    QSet<QString> files = std::exchange(m_touched, QSet<QString>());
+    if (std::exchange(m_rescan, false)) {
+        // 新文件会被导出；没有变化的文件在 inputUpToDate 中直接跳过
+        const QStringList current = expandInputs();
+        for (const QString &path : current) files.insert(path);
+        for (auto it = m_inputEntries.cbegin(); it != m_inputEntries.cend(); ++it) {
+            if (!QFileInfo::exists(it.key())) files.insert(it.key());
+        }
+    }
+
+    // 以“写临时文件再改名”方式保存的文件会从监视列表中消失，重新加入
+    const QStringList watched = m_watcher.files();
+    for (const QString &path : std::as_const(files)) {
+        if (!watched.contains(path) && QFileInfo::exists(path)) m_watcher.addPath(path);
+    }
+    watchCatalog();
+    report(build(files.values()));
+}
+
+QStringList BatchExporter::catalogFiles()
+{
+    return QStringList{ LayeredCatalog::declarationPath() } + LayeredCatalog::declaredLayers();
+}
+
+void BatchExporter::watchCatalog()
+{
+    const QStringList watched = m_watcher.files();
+    for (const QString &path : catalogFiles()) {
+        if (!watched.contains(path) && QFileInfo::exists(path)) m_watcher.addPath(path);
+    }
+}
+
+void BatchExporter::report(const Stats &stats)
+{
+    qInfo().noquote() << QString("[导出] 写入 %1 个，未变化跳过 %2 个，删除 %3 个，失败 %4 个")
+                             .arg(stats.written).arg(stats.skipped).arg(stats.removed).arg(stats.errors.size());
+    for (const QString &error : stats.errors) qWarning().noquote() << "[导出]" << error;
+}
+
+void BatchExporter::loadManifest()
+{
+    QFile file(m_outputDir + "/" + kManifestName);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    qint32 serializerVersion = 0;
+    in >> magic >> version >> serializerVersion;
+    // 序列化版本变化时旧输出都已过时，整个清单作废
+    if (in.status() != QDataStream::Ok || magic != kManifestMagic || version != kManifestVersion
+        || serializerVersion != NbtCodec::kSerializerVersion) return;
+
+    QHash<QString, InputEntry> inputs;
+    QHash<QString, OutputEntry> outputs;
+    quint32 count = 0;
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        InputEntry entry;
+        in >> path >> entry.stat >> entry.catalogVersion >> entry.outputs;
+        inputs.insert(path, entry);
+    }
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString name;
+        OutputEntry entry;
+        in >> name >> entry.key >> entry.stat;
+        outputs.insert(name, entry);
+    }
+    if (in.status() != QDataStream::Ok) return;
+    m_inputEntries = inputs;
+    m_outputEntries = outputs;
+}
+
+void BatchExporter::saveManifest() const
+{
+    QSaveFile file(m_outputDir + "/" + kManifestName);
+    if (!file.open(QIODevice::WriteOnly)) return;   // 写不了清单只是下次不能跳过
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kManifestMagic << kManifestVersion << qint32(NbtCodec::kSerializerVersion);
+    out << quint32(m_inputEntries.size());
+    for (auto it = m_inputEntries.cbegin(); it != m_inputEntries.cend(); ++it) {
+        out << it.key() << it->stat << it->catalogVersion << it->outputs;
+    }
+    out << quint32(m_outputEntries.size());
+    for (auto it = m_outputEntries.cbegin(); it != m_outputEntries.cend(); ++it) {
+        out << it.key() << it->key << it->stat;
+    }
+    if (out.status() == QDataStream::Ok) file.commit();
+    else file.cancelWriting();
+}
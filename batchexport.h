@@ -0,0 +1,83 @@
+#ifndef BATCHEXPORT_H
+#define BATCHEXPORT_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include "filefingerprint.h"
+#include "layeredcatalog.h"
+#include "tradedata.h"
+
+// ==================== 增量批量导出 ====================
+// 把若干结构文件中的每个村民导出为单独的结构文件：<输出目录>/<文件名>.json，
+// 一个文件中有多个村民时为 <文件名>-<序号>.json。不同输入得到同一个输出文件名时，后一个（按路径）报错不导出。
+// 每个输出以 “交易 + 职业 + 变种 + 物品库版本 + 序列化版本” 的哈希为键，记录在输出目录的 .vtebuild 清单中：
+// 键没变且输出文件没有被改动过的村民既不编码也不写入；输入文件的大小与修改时间都没变时连解析也跳过，
+// 因此没有改动时重新构建几百个村民几乎不做任何事。watch() 监视输入，只重新导出被修改的文件。
+class BatchExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        int written = 0;
+        int skipped = 0;
+        int removed = 0;   // 输入中已经不存在的村民留下的旧输出
+        QStringList errors;
+    };
+
+    // inputs 可以是文件或目录（目录中的 *.json，不递归）
+    BatchExporter(const QStringList &inputs, const QString &outputDir, QObject *parent = nullptr);
+
+    void setForce(bool force) { m_force = force; }   // 忽略清单，全部重新导出
+
+    Stats build();                            // 检查全部输入
+    Stats build(const QStringList &files);    // 只检查这些输入文件；已删除的文件清除其输出
+    void watch();                             // 开始监视输入（需要事件循环）
+
+    static void report(const Stats &stats);
+    static QByteArray exportKey(const VillagerData &villager, const QByteArray &catalogVersion);
+
+private:
+    struct OutputEntry {
+        QByteArray key;
+        FileFingerprint stat;   // 写入后的输出文件，被外部改动过就重新导出
+    };
+    struct InputEntry {
+        FileFingerprint stat;
+        QByteArray catalogVersion;
+        QStringList outputs;
+    };
+    struct InputResult;
+
+    static QStringList catalogFiles();   // 物品库声明文件与各层文件
+
+    QStringList expandInputs() const;
+    void refreshCatalog();
+    bool inputUpToDate(const QString &path, const FileFingerprint &stat) const;
+    // 以下两个在工作线程中执行，只读清单
+    InputResult parseInput(const QString &path) const;
+    void writeOutputs(InputResult &result) const;
+    void loadManifest();
+    void saveManifest() const;
+    void rebuildTouched();
+    void watchCatalog();
+
+    QStringList m_inputs;
+    QString m_outputDir;
+    LayeredCatalog m_catalog;
+    QByteArray m_catalogVersion;
+    bool m_force = false;
+    QHash<QString, InputEntry> m_inputEntries;     // 输入文件绝对路径 -> 上次导出的结果
+    QHash<QString, OutputEntry> m_outputEntries;   // 输出文件名 -> 键
+
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounce;
+    QSet<QString> m_touched;
+    bool m_rescan = false;
+};
+
+#endif // BATCHEXPORT_H
@@ -0,0 +1,176 @@
+#include "bulkedit.h"
+#include "tradefields.h"
+#include <QtNumeric>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+const qsizetype kParallelThreshold = 256;   // 行数达到这个值时按行并行
+
+// 与编辑器中对应输入框的范围一致，批量修改不会得到界面上无法输入的值
+void editorRange(int field, int &low, int &high)
+{
+    using namespace TradeFields;
+    low = 0;
+    high = 32767;
+    switch (field) {
+    case Uses: case MaxUses: low = -32767; break;
+    case Tier: high = 5; break;
+    default:
+        switch (field % ItemFieldCount) {
+        case Count: high = 999; break;
+        case EnchId: high = 255; break;
+        case EnchLevel: low = 1; high = 255; break;
+        default: break;
+        }
+        break;
+    }
+}
+
+int clampToEditor(int field, qint64 v)
+{
+    int low, high;
+    editorRange(field, low, high);
+    return int(qBound<qint64>(low, v, high));
+}
+
+// 启用开关只接受 true / false / 1 / 0，其余文本（包括 QVariant::toBool 视为真的任意字符串）都无效
+bool parseFlag(const QVariant &v, bool *ok)
+{
+    if (v.typeId() == QMetaType::Bool) {
+        *ok = true;
+        return v.toBool();
+    }
+    const QString text = v.toString().trimmed().toLower();
+    *ok = text == "true" || text == "1" || text == "false" || text == "0";
+    return text == "true" || text == "1";
+}
+
+bool isNameField(int field)
+{
+    return field >= 0 && field < TradeFields::Uses && field % TradeFields::ItemFieldCount == TradeFields::Name;
+}
+
+bool setIfChanged(TradeOption &trade, int field, const QVariant &v)
+{
+    if (TradeFields::value(trade, field) == v) return false;
+    return TradeFields::setValue(trade, field, v);
+}
+
+} // namespace
+
+namespace BulkEdit {
+
+bool isValid(const Transform &t, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return false;
+    };
+    if (t.op == ReplaceItemId) {
+        if (t.field != -1 && !isNameField(t.field)) return fail("替换物品 ID 只能用于物品名字段");
+        if (t.value.toString().trimmed().isEmpty()) return fail("新的物品 ID 不能为空");
+        return true;
+    }
+    if (t.field < 0 || t.field >= TradeFields::FieldCount) return fail("未知的字段");
+    if (t.field % TradeFields::ItemFieldCount == TradeFields::CustomNodes && t.field < TradeFields::Uses) {
+        return fail("自定义节点不能批量修改");
+    }
+    if ((t.op == Scale || t.op == Offset) && !TradeFields::isNumeric(t.field)) return fail("缩放与偏移只能用于整数字段");
+    bool ok = true;
+    if (t.op == Scale) {
+        const double factor = t.value.toDouble(&ok);
+        ok = ok && qIsFinite(factor);
+    }
+    if (t.op == Offset || (t.op == Set && TradeFields::isNumeric(t.field))) t.value.toInt(&ok);
+    if (!ok) return fail(QString("“%1”不是有效的数值").arg(t.value.toString()));
+    if (t.op == Set && !TradeFields::isNumeric(t.field) && !TradeFields::isText(t.field)) {
+        parseFlag(t.value, &ok);
+        if (!ok) return fail(QString("开关只能设为 true / false 或 1 / 0，而不是“%1”").arg(t.value.toString()));
+    }
+    return true;
+}
+
+QString describe(const Transform &t)
+{
+    const QString field = t.field < 0 ? QString("所有物品名") : TradeFields::path(t.field);
+    switch (t.op) {
+    case Set: return QString("%1 = %2").arg(field, t.value.toString());
+    case Scale: return QString("%1 × %2").arg(field, t.value.toString());
+    case Offset: return QString("%1 %2 %3").arg(field, t.value.toInt() < 0 ? QString("-") : QString("+")).arg(qAbs(t.value.toInt()));
+    case ReplaceItemId:
+        return QString("%1：%2 → %3").arg(field, t.from.isEmpty() ? QString("任意") : t.from, t.value.toString());
+    }
+    return field;
+}
+
+bool apply(TradeOption &trade, const Transform &t)
+{
+    switch (t.op) {
+    case Set: {
+        if (TradeFields::isNumeric(t.field)) return setIfChanged(trade, t.field, clampToEditor(t.field, t.value.toInt()));
+        if (TradeFields::isText(t.field)) return setIfChanged(trade, t.field, t.value.toString());
+        bool ok;
+        const bool flag = parseFlag(t.value, &ok);   // 其余的是启用开关
+        return ok && setIfChanged(trade, t.field, flag);
+    }
+    case Scale: {
+        // 先在浮点数上限制到输入框的范围再取整：超出 qint64 的值直接交给 qRound64 是未定义行为
+        int low, high;
+        editorRange(t.field, low, high);
+        const double scaled = TradeFields::value(trade, t.field).toInt() * t.value.toDouble();
+        return setIfChanged(trade, t.field, int(qRound64(qBound<double>(low, scaled, high))));
+    }
+    case Offset:
+        return setIfChanged(trade, t.field, clampToEditor(t.field, qint64(TradeFields::value(trade, t.field).toInt()) + t.value.toInt()));
+    case ReplaceItemId: {
+        const QString to = t.value.toString().trimmed();
+        bool changed = false;
+        for (int slot = 0; slot < TradeFields::SlotCount; ++slot) {
+            const int field = TradeFields::itemField(TradeFields::Slot(slot), TradeFields::Name);
+            if (t.field != -1 && t.field != field) continue;
+            const QString name = TradeFields::value(trade, field).toString();
+            // 不限原 ID 时也跳过空的物品栏（例如未使用的 BuyB）
+            if (name.isEmpty() || (!t.from.isEmpty() && name != t.from)) continue;
+            changed |= setIfChanged(trade, field, to);
+        }
+        return changed;
+    }
+    }
+    return false;
+}
+
+QList<int> applyToRows(QList<TradeOption> &trades, const QList<int> &rows, const Transform &t)
+{
+    QList<int> targets;
+    targets.reserve(rows.size());
+    for (int row : rows) {
+        if (row >= 0 && row < trades.size()) targets.append(row);
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    // 先分离列表，之后各线程只写各自的那一条交易和那一个标记
+    TradeOption *data = trades.data();
+    std::vector<char> changed(targets.size(), 0);
+    const int *rowOf = targets.constData();
+    auto run = [&](qsizetype k) { changed[k] = apply(data[rowOf[k]], t); };
+    if (targets.size() < kParallelThreshold) {
+        for (qsizetype k = 0; k < targets.size(); ++k) run(k);
+    } else {
+        std::vector<qsizetype> indices(targets.size());
+        std::iota(indices.begin(), indices.end(), 0);
+        QtConcurrent::blockingMap(indices, run);
+    }
+
+    QList<int> result;
+    for (qsizetype k = 0; k < targets.size(); ++k) {
+        if (changed[k]) result.append(targets[k]);
+    }
+    return result;
+}
+
+} // namespace BulkEdit
@@ -0,0 +1,40 @@
+#ifndef BULKEDIT_H
+#define BULKEDIT_H
+
+#include <QList>
+#include <QString>
+#include <QVariant>
+#include "tradedata.h"
+
+// ==================== 批量修改 ====================
+// 对选中的多条交易执行同一个按字段寻址（见 TradeFields）的变换：设为某值、按比例缩放、
+// 加减偏移量，或把物品 ID 整体替换。一次遍历完成，交易较多时并行；调用方据返回的行号
+// 只提交一个撤销步骤、只刷新这些行和一次预览。
+namespace BulkEdit {
+
+enum Operation {
+    Set,             // 任意字段：写入 value
+    Scale,           // 整数字段：乘以 value（四舍五入）
+    Offset,          // 整数字段：加上 value
+    ReplaceItemId,   // 物品名字段：等于 from（为空时不限）的改为 value；field 为 -1 时三个物品都替换
+};
+
+struct Transform {
+    Operation op = Set;
+    int field = -1;   // TradeFields 字段编号
+    QVariant value;
+    QString from;     // 只用于 ReplaceItemId
+};
+
+// 参数是否适用于该字段（例如缩放只用于整数字段）；不适用时 error 说明原因
+bool isValid(const Transform &t, QString *error = nullptr);
+QString describe(const Transform &t);   // 用于状态栏，例如 "sell.count × 2"
+
+// 变换一条交易，返回是否有字段真正改变。整数结果限制在编辑器对应输入框的范围内
+bool apply(TradeOption &trade, const Transform &t);
+// 变换 trades 中 rows 指定的各行，返回真正改变了的行（升序）
+QList<int> applyToRows(QList<TradeOption> &trades, const QList<int> &rows, const Transform &t);
+
+} // namespace BulkEdit
+
+#endif // BULKEDIT_H
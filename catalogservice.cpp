@@ -0,0 +1,91 @@
+#include "catalogservice.h"
+#include "tracer.h"
+#include "memtrace.h"
+#include "startuptiming.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringListModel>
+#include <QtConcurrent/QtConcurrentRun>
+
+CatalogService *CatalogService::instance()
+{
+    // 挂在 qApp 下，随应用程序一起析构
+    static CatalogService *service = new CatalogService(QCoreApplication::instance());
+    return service;
+}
+
+QString CatalogService::configPath()
+{
+    return QCoreApplication::applicationDirPath() + "/items_config.csv";
+}
+
+CatalogService::CatalogService(QObject *parent)
+    : QObject(parent)
+    , m_completerModel(new QStringListModel(this))
+{
+    connect(&m_watcher, &QFutureWatcher<CatalogSnapshot>::finished, this, &CatalogService::onLoadFinished);
+}
+
+void CatalogService::loadAsync()
+{
+    if (m_ready || m_watcher.isRunning()) return;
+    startLoad();
+}
+
+void CatalogService::reload()
+{
+    if (m_watcher.isRunning()) {
+        // 当前这次加载可能读到的是旧文件，结束后再加载一次
+        m_reloadPending = true;
+        return;
+    }
+    startLoad();
+}
+
+void CatalogService::startLoad()
+{
+    m_watcher.setFuture(QtConcurrent::run([this]() { return loadSnapshot(); }));
+}
+
+CatalogSnapshot CatalogService::loadSnapshot()
+{
+    VTE_TRACE("CatalogService::loadSnapshot");
+    VTE_MEM_SCOPE(MemTrace::CatalogLoad);
+    const QString basePath = configPath();
+    if (!QFile::exists(basePath)) {
+        ItemCatalog::createDefaultConfig(basePath);
+    }
+
+    // 只重新解析发生变化的层；没有任何变化时沿用上一次的合并结果
+    m_layers.refresh(LayeredCatalog::declaredLayers());
+
+    CatalogSnapshot snapshot;
+    snapshot.items = m_layers.items();
+    snapshot.version = m_layers.version();
+    snapshot.completerItems.reserve(snapshot.items.size() * 3);
+    for (const auto &mapping : snapshot.items) {
+        snapshot.completerItems << mapping.chineseName
+                                << mapping.englishId
+                                << QString("%1（%2）").arg(mapping.chineseName, mapping.englishId);
+    }
+    snapshot.resolver.build(snapshot.items);
+    return snapshot;
+}
+
+void CatalogService::onLoadFinished()
+{
+    if (m_reloadPending) {
+        m_reloadPending = false;
+        startLoad();
+        return;
+    }
+
+    m_snapshot = m_watcher.result();
+    m_completerModel->setStringList(m_snapshot.completerItems);
+    if (!m_ready) {
+        // 启动计时只记录第一次加载；配置修改后的重新加载不经过这里
+        m_ready = true;
+        StartupTiming::mark(QString("物品库加载完成（%1 项）").arg(m_snapshot.items.size()).toUtf8().constData());
+    }
+    emit catalogReady();
+}
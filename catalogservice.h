@@ -0,0 +1,61 @@
+#ifndef CATALOGSERVICE_H
+#define CATALOGSERVICE_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QStringList>
+#include "itemcatalog.h"
+#include "layeredcatalog.h"
+#include "itemidresolver.h"
+
+class QStringListModel;
+
+// 一次加载的结果：物品列表与自动补全候选（在工作线程中一并生成）
+struct CatalogSnapshot {
+    QList<ItemMapping> items;
+    QStringList completerItems;
+    ItemIdResolver resolver;
+    QByteArray version;
+};
+
+// ==================== 物品库服务 ====================
+// 物品库在工作线程中加载（包括首次运行时生成默认配置），加载完成后发出 catalogReady。
+// 支持 items_catalogs.txt 声明的多层物品库，重新加载时只重新解析发生变化的层。
+// 全进程共用一份，编辑器窗口只读取快照，不再各自读取 CSV。
+class CatalogService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static CatalogService *instance();
+
+    static QString configPath();   // applicationDirPath()/items_config.csv（基础层）
+
+    void loadAsync();   // 尚未加载时启动后台加载；已加载或正在加载时什么也不做
+    void reload();      // 配置文件被修改后重新加载
+
+    bool isReady() const { return m_ready; }
+    const QList<ItemMapping> &items() const { return m_snapshot.items; }
+    QStringListModel *completerModel() const { return m_completerModel; }
+    const ItemIdResolver &resolver() const { return m_snapshot.resolver; }
+    QByteArray version() const { return m_snapshot.version; }   // 合并后物品库的版本（各层指纹组合）
+
+signals:
+    void catalogReady();
+
+private:
+    explicit CatalogService(QObject *parent = nullptr);
+    void startLoad();
+    void onLoadFinished();
+
+    CatalogSnapshot loadSnapshot();   // 在工作线程中执行
+
+    LayeredCatalog m_layers;          // 只在加载线程中访问（同一时间只有一次加载）
+    QFutureWatcher<CatalogSnapshot> m_watcher;
+    CatalogSnapshot m_snapshot;
+    QStringListModel *m_completerModel;
+    bool m_ready = false;
+    bool m_reloadPending = false;
+};
+
+#endif // CATALOGSERVICE_H
@@ -0,0 +1,130 @@
+#include "commandline.h"
+#include "batchexport.h"
+#include "corpusgenerator.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+// 触发命令行模式的参数
+const char *const kModeOptions[] = { "--export", "--generate", "--generate-catalog" };
+
+int runExport(QCoreApplication &app, const QCommandLineParser &parser, const QString &outputDir, bool watch, bool force)
+{
+    const QStringList inputs = parser.positionalArguments();
+    if (inputs.isEmpty()) {
+        qWarning().noquote() << "[导出] 没有指定输入文件或目录";
+        return 2;
+    }
+
+    BatchExporter exporter(inputs, outputDir);
+    exporter.setForce(force);
+    const BatchExporter::Stats stats = exporter.build();
+    BatchExporter::report(stats);
+    if (!watch) return stats.errors.isEmpty() ? 0 : 1;
+
+    exporter.watch();
+    return app.exec();
+}
+
+// 数值参数：未设置时保留默认值，无法解析时报错
+template <typename T>
+bool readNumber(const QCommandLineParser &parser, const QCommandLineOption &option, T &out)
+{
+    if (!parser.isSet(option)) return true;
+    bool ok = false;
+    const double value = parser.value(option).toDouble(&ok);
+    if (!ok || value < 0) {
+        qWarning().noquote() << QString("[生成] 参数 --%1 的值无效：%2").arg(option.names().first(), parser.value(option));
+        return false;
+    }
+    out = T(value);
+    return true;
+}
+
+int runGenerate(const QString &documentPath, const QString &catalogPath, const CorpusGenerator::Options &options)
+{
+    QString error;
+    if (!documentPath.isEmpty()) {
+        if (!CorpusGenerator::writeDocument(documentPath, options, &error)) {
+            qWarning().noquote() << QString("[生成] %1：%2").arg(documentPath, error);
+            return 1;
+        }
+        qInfo().noquote() << QString("[生成] %1：%2 个村民，%3 条交易（种子 %4）")
+                                 .arg(documentPath).arg(qMax(1, options.villagers)).arg(options.trades).arg(options.seed);
+    }
+    if (!catalogPath.isEmpty()) {
+        if (!CorpusGenerator::writeCatalog(catalogPath, options, &error)) {
+            qWarning().noquote() << QString("[生成] %1：%2").arg(catalogPath, error);
+            return 1;
+        }
+        qInfo().noquote() << QString("[生成] %1：%2 行物品库").arg(catalogPath).arg(options.catalogRows);
+    }
+    return 0;
+}
+
+} // namespace
+
+namespace CommandLine {
+
+bool isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        for (const char *option : kModeOptions) {
+            // 同时接受 --export 目录 与 --export=目录
+            const size_t n = std::strlen(option);
+            if (std::strncmp(argv[i], option, n) == 0 && (argv[i][n] == '\0' || argv[i][n] == '=')) return true;
+        }
+    }
+    return false;
+}
+
+int run(QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("村民交易编辑器（命令行模式）");
+    parser.addHelpOption();
+    parser.addPositionalArgument("输入", "结构文件，或包含结构文件（*.json）的目录。", "[输入...]");
+
+    const QCommandLineOption exportOption("export", "把输入中的每个村民导出为单独的结构文件，保存到<目录>；没有变化的村民直接跳过。", "目录");
+    const QCommandLineOption watchOption("watch", "导出后继续监视输入，只重新导出被修改的文件。");
+    const QCommandLineOption forceOption("force", "忽略导出缓存，全部重新导出。");
+    parser.addOptions({ exportOption, watchOption, forceOption });
+
+    // 压力测试语料：同样的参数与种子生成逐字节相同的文件
+    const QCommandLineOption generateOption("generate", "生成一个压力测试用的结构文件到<文件>。", "文件");
+    const QCommandLineOption generateCatalogOption("generate-catalog", "生成一个压力测试用的物品库 CSV 到<文件>。", "文件");
+    const QCommandLineOption seedOption("seed", "随机种子（默认 1）。", "整数");
+    const QCommandLineOption tradesOption("trades", "交易总数（默认 1000）。", "数量");
+    const QCommandLineOption villagersOption("villagers", "村民数，大于 1 时打包成一个结构（默认 1）。", "数量");
+    const QCommandLineOption loreOption("lore", "带名称与 Lore 的物品比例（默认 0.2）。", "比例");
+    const QCommandLineOption loreLinesOption("lore-lines", "每条 Lore 的行数（默认 3）。", "数量");
+    const QCommandLineOption enchOption("ench", "带附魔的物品比例（默认 0.2）。", "比例");
+    const QCommandLineOption customOption("custom", "带自定义节点的物品比例（默认 0.05）。", "比例");
+    const QCommandLineOption customNodesOption("custom-nodes", "每个这样的物品的自定义节点数（默认 8）。", "数量");
+    const QCommandLineOption rowsOption("rows", "物品库行数（默认 1000）；结构文件也会引用这些物品。", "数量");
+    const QCommandLineOption presetOption("preset", "带预设 JSON 的物品库行比例（默认 0.1）。", "比例");
+    parser.addOptions({ generateOption, generateCatalogOption, seedOption, tradesOption, villagersOption, loreOption,
+                        loreLinesOption, enchOption, customOption, customNodesOption, rowsOption, presetOption });
+    parser.process(app);
+
+    if (parser.isSet(generateOption) || parser.isSet(generateCatalogOption)) {
+        CorpusGenerator::Options options;
+        const bool ok = readNumber(parser, seedOption, options.seed) && readNumber(parser, tradesOption, options.trades)
+                     && readNumber(parser, villagersOption, options.villagers) && readNumber(parser, loreOption, options.loreRatio)
+                     && readNumber(parser, loreLinesOption, options.loreLines) && readNumber(parser, enchOption, options.enchRatio)
+                     && readNumber(parser, customOption, options.customRatio) && readNumber(parser, customNodesOption, options.customNodes)
+                     && readNumber(parser, rowsOption, options.catalogRows) && readNumber(parser, presetOption, options.presetRatio);
+        if (!ok) return 2;
+        return runGenerate(parser.value(generateOption), parser.value(generateCatalogOption), options);
+    }
+
+    if (parser.isSet(exportOption)) {
+        return runExport(app, parser, parser.value(exportOption), parser.isSet(watchOption), parser.isSet(forceOption));
+    }
+    parser.showHelp(2);
+}
+
+} // namespace CommandLine
@@ -0,0 +1,17 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+class QCoreApplication;
+
+// ==================== 命令行模式 ====================
+// 带有模式参数（--export、--generate、--generate-catalog）启动时不创建窗口，在控制台中完成任务后退出。
+namespace CommandLine {
+
+// 在创建 QApplication 之前检查参数中是否有命令行模式
+bool isRequested(int argc, char *argv[]);
+// 解析参数并执行；返回进程退出码
+int run(QCoreApplication &app);
+
+} // namespace CommandLine
+
+#endif // COMMANDLINE_H
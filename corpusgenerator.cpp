@@ -0,0 +1,217 @@
+#include "corpusgenerator.h"
+#include "nbtcodec.h"
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QStringList>
+#include <QTextStream>
+#include <iterator>
+
+namespace {
+
+// 原版物品；物品库行数大于 0 时另外使用生成的 vte_gen:item_N
+const char *const kVanillaItems[] = {
+    "minecraft:emerald", "minecraft:diamond", "minecraft:iron_ingot", "minecraft:gold_ingot",
+    "minecraft:iron_sword", "minecraft:diamond_sword", "minecraft:bread", "minecraft:apple",
+    "minecraft:book", "minecraft:map", "minecraft:paper", "minecraft:compass",
+};
+const char *const kProfessions[] = {
+    "cartographer", "armorer", "weaponsmith", "mason", "fletcher", "toolsmith", "butcher",
+    "cleric", "shepherd", "farmer", "fisherman", "librarian", "leatherworker",
+};
+const char *const kCategories[] = { "基础", "矿物", "武器", "食物", "方块", "工具" };
+
+QString generatedId(qsizetype n)
+{
+    return QString("vte_gen:item_%1").arg(n);
+}
+
+class Generator
+{
+public:
+    explicit Generator(const CorpusGenerator::Options &options) : m_options(options), m_rng(options.seed) {}
+
+    bool chance(double ratio) { return ratio > 0 && m_rng.generateDouble() < ratio; }
+    int between(int low, int high) { return low + int(m_rng.bounded(quint32(high - low + 1))); }
+
+    QString itemId()
+    {
+        if (m_options.catalogRows > 0 && chance(0.5)) return generatedId(m_rng.bounded(quint64(m_options.catalogRows)));
+        return QString::fromLatin1(kVanillaItems[m_rng.bounded(quint32(std::size(kVanillaItems)))]);
+    }
+
+    // 自定义节点：整数、字符串、字符串列表与嵌套复合标签交替出现，覆盖校验与编解码的各条路径
+    QJsonArray customNodes(int count)
+    {
+        QJsonArray nodes;
+        for (int k = 0; k < count; ++k) {
+            const QString name = QString("VteGen%1").arg(k);
+            switch (m_rng.bounded(4)) {
+            case 0:
+                nodes.append(NbtCodec::createNode(name, int(m_rng.bounded(100000)), 3));
+                break;
+            case 1:
+                nodes.append(NbtCodec::createNode(name, QString("生成的文本 %1").arg(m_rng.generate()), 8));
+                break;
+            case 2: {
+                QJsonArray list;
+                const int n = between(3, 8);
+                for (int i = 0; i < n; ++i) list.append(NbtCodec::createNode("", itemId(), 8));
+                nodes.append(NbtCodec::createNode(name, list, 9));
+                break;
+            }
+            default: {
+                QJsonArray inner;
+                inner.append(NbtCodec::createNode("x", int(m_rng.bounded(1000)), 3));
+                inner.append(NbtCodec::createNode("y", int(m_rng.bounded(256)), 3));
+                inner.append(NbtCodec::createNode("z", int(m_rng.bounded(1000)), 3));
+                nodes.append(NbtCodec::createNode(name, inner, 10));
+                break;
+            }
+            }
+        }
+        return nodes;
+    }
+
+    ItemData item(const QString &id, int maxCount)
+    {
+        ItemData d;
+        d.name = id;
+        d.count = between(1, maxCount);
+        if (chance(m_options.loreRatio)) {
+            d.enableName = true;
+            d.displayName = QString("生成物品 %1").arg(m_rng.bounded(100000));
+            d.enableLore = true;
+            QStringList lines;
+            for (int i = 0; i < m_options.loreLines; ++i) lines.append(QString("第 %1 行说明 %2").arg(i + 1).arg(m_rng.generate()));
+            d.lore = lines.join('\n');
+        }
+        if (chance(m_options.enchRatio)) {
+            d.enableEnch = true;
+            d.enchId = between(0, 70);
+            d.enchLevel = between(1, 5);
+        }
+        if (chance(m_options.customRatio) && m_options.customNodes > 0) {
+            d.enableCustom = true;
+            d.customNodes = customNodes(m_options.customNodes);
+        }
+        return d;
+    }
+
+    TradeOption trade()
+    {
+        TradeOption t;
+        t.buyA.name = "minecraft:emerald";   // 价格物品保持朴素
+        t.buyA.count = between(1, 64);
+        t.buyB = chance(0.3) ? item(itemId(), 16) : ItemData();
+        t.sell = item(itemId(), 16);
+        t.maxUses = between(1, 99);
+        t.uses = between(0, t.maxUses);
+        t.tier = between(0, 4);
+        return t;
+    }
+
+    // 村民的职业与变种，不含交易
+    VillagerData villager()
+    {
+        VillagerData villager;
+        villager.profession = QString::fromLatin1(kProfessions[m_rng.bounded(quint32(std::size(kProfessions)))]);
+        villager.markVariant = between(0, 6);
+        return villager;
+    }
+
+    QList<VillagerData> villagers()
+    {
+        const int count = qMax(1, m_options.villagers);
+        QList<VillagerData> result;
+        result.reserve(count);
+        for (int v = 0; v < count; ++v) {
+            VillagerData villager = this->villager();
+            // 交易平均分给各村民，余数给前面的村民
+            const qsizetype share = m_options.trades / count + (v < m_options.trades % count ? 1 : 0);
+            villager.trades.reserve(share);
+            for (qsizetype i = 0; i < share; ++i) villager.trades.append(trade());
+            result.append(villager);
+        }
+        return result;
+    }
+
+    QRandomGenerator &rng() { return m_rng; }
+
+private:
+    const CorpusGenerator::Options &m_options;
+    QRandomGenerator m_rng;
+};
+
+bool fail(QString *error, const QString &message)
+{
+    if (error) *error = message;
+    return false;
+}
+
+} // namespace
+
+namespace CorpusGenerator {
+
+QList<VillagerData> generateVillagers(const Options &options)
+{
+    return Generator(options).villagers();
+}
+
+bool writeDocument(const QString &path, const Options &options, QString *error)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return fail(error, file.errorString());
+    if (options.villagers <= 1) {
+        // 单个村民：边生成边编码写出，百万条交易也不需要在内存中保留交易列表或整个文本。
+        // 随机数的使用顺序与 generateVillagers 相同，输出与先生成再 serialize 一致
+        Generator gen(options);
+        const VillagerData villager = gen.villager();
+        if (!NbtCodec::writeSingle(&file, options.trades, [&gen](qsizetype) { return gen.trade(); },
+                                   villager.profession, villager.markVariant)) {
+            return fail(error, file.errorString());
+        }
+    } else {
+        const QList<VillagerData> villagers = generateVillagers(options);
+        // 实体 ID 也由种子决定，保证输出可重现
+        NbtCodec::PackLayout layout;
+        layout.firstUniqueId = -1 - qint64(QRandomGenerator(options.seed).generate64() >> 2);
+        if (!NbtCodec::writePacked(&file, villagers, layout)) return fail(error, file.errorString());
+    }
+    if (!file.commit()) return fail(error, file.errorString());
+    return true;
+}
+
+bool writeCatalog(const QString &path, const Options &options, QString *error)
+{
+    // 物品库使用独立的随机序列，与结构文件的生成互不影响
+    Options catalogOptions = options;
+    catalogOptions.seed = options.seed ^ 0x5A5A5A5Au;
+    Generator gen(catalogOptions);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return fail(error, file.errorString());
+    QTextStream out(&file);
+    out.setEncoding(QStringConverter::Utf8);
+    out << "# 由 --generate-catalog 生成（种子 " << options.seed << "，" << options.catalogRows << " 行）\n";
+    out << "# 格式：分类, 英文ID, 中文名, 默认Damage值, 预设JSON\n\n";
+
+    for (const char *id : kVanillaItems) out << "基础, " << id << ", " << id << ", 0,\n";
+    for (qsizetype n = 0; n < options.catalogRows; ++n) {
+        out << kCategories[gen.rng().bounded(quint32(std::size(kCategories)))] << ", " << generatedId(n)
+            << ", 生成物品" << n << ", " << (gen.chance(0.1) ? 32767 : 0) << ",";
+        if (gen.chance(options.presetRatio)) {
+            // 与 createDefaultConfig 相同的 CSV 转义：整体加引号，内部引号写两次
+            QString json = QString::fromUtf8(QJsonDocument(gen.customNodes(qMax(1, options.customNodes / 2))).toJson(QJsonDocument::Compact));
+            json.replace("\"", "\"\"");
+            out << " \"" << json << "\"";
+        }
+        out << "\n";
+    }
+    out.flush();
+    if (out.status() != QTextStream::Ok) return fail(error, file.errorString());
+    if (!file.commit()) return fail(error, file.errorString());
+    return true;
+}
+
+} // namespace CorpusGenerator
@@ -0,0 +1,35 @@
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <QList>
+#include <QString>
+#include "tradedata.h"
+
+// ==================== 压力测试语料生成 ====================
+// 按种子生成可重现的村民结构文件与物品库 CSV，供性能测试与分析使用。
+// 同样的参数与种子总是得到逐字节相同的输出（生成过程是单线程的）。
+namespace CorpusGenerator {
+
+struct Options {
+    quint32 seed = 1;
+    qsizetype trades = 1000;    // 所有村民的交易总数
+    int villagers = 1;          // 大于 1 时打包成一个多村民结构
+    double loreRatio = 0.2;     // 带 Lore 的物品比例
+    int loreLines = 3;
+    double enchRatio = 0.2;     // 带附魔的物品比例
+    double customRatio = 0.05;  // 带自定义节点的物品比例
+    int customNodes = 8;        // 每个这样的物品的自定义节点数（含嵌套列表与复合标签）
+    qsizetype catalogRows = 1000;
+    double presetRatio = 0.1;   // 带预设 JSON 的物品库行比例
+};
+
+QList<VillagerData> generateVillagers(const Options &options);
+
+// 写出结构文件：单个村民按内置模板，多个村民打包成网格
+bool writeDocument(const QString &path, const Options &options, QString *error = nullptr);
+// 写出物品库 CSV（格式同 items_config.csv）
+bool writeCatalog(const QString &path, const Options &options, QString *error = nullptr);
+
+} // namespace CorpusGenerator
+
+#endif // CORPUSGENERATOR_H
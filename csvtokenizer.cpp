@@ -0,0 +1,204 @@
+#include "csvtokenizer.h"
+#include <QtAlgorithms>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define VTE_CSV_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+// GCC/Clang（含 MinGW）可以在运行时按 CPU 能力选择 AVX2 版本，无需整个程序都用 -mavx2 编译
+#if defined(VTE_CSV_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#  define VTE_CSV_AVX2 1
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+// 小于该大小的文件直接单线程切分，避免线程调度开销
+const qsizetype kParallelThreshold = 256 * 1024;
+const qsizetype kMinChunkSize = 64 * 1024;
+
+// 返回 [p, end) 中第一个等于 a 或 b 的字节，找不到返回 end
+const char *scanScalar(const char *p, const char *end, char a, char b)
+{
+    for (; p < end; ++p) {
+        if (*p == a || *p == b) return p;
+    }
+    return end;
+}
+
+#ifdef VTE_CSV_SSE2
+const char *scanSse2(const char *p, const char *end, char a, char b)
+{
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, va),
+                                                        _mm_cmpeq_epi8(chunk, vb)));
+        if (mask) return p + qCountTrailingZeroBits(quint32(mask));
+        p += 16;
+    }
+    return scanScalar(p, end, a, b);
+}
+#endif
+
+#ifdef VTE_CSV_AVX2
+__attribute__((target("avx2")))
+const char *scanAvx2(const char *p, const char *end, char a, char b)
+{
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    while (end - p >= 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        const int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, va),
+                                                              _mm256_cmpeq_epi8(chunk, vb)));
+        if (mask) return p + qCountTrailingZeroBits(quint32(mask));
+        p += 32;
+    }
+    return scanSse2(p, end, a, b);
+}
+#endif
+
+using ScanFn = const char *(*)(const char *, const char *, char, char);
+
+ScanFn selectScan()
+{
+#ifdef VTE_CSV_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return scanAvx2;
+#endif
+#ifdef VTE_CSV_SSE2
+    return scanSse2;
+#else
+    return scanScalar;
+#endif
+}
+
+inline const char *scanAny(const char *p, const char *end, char a, char b)
+{
+    static const ScanFn fn = selectScan();
+    return fn(p, end, a, b);
+}
+
+inline bool isAsciiSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+QStringList splitRange(const char *p, const char *end)
+{
+    QStringList fields;
+    QByteArray field;             // 只有字段中出现引号时才需要拼接片段
+    const char *spanStart = p;
+    bool inQuote = false;
+
+    // 字段结束：没有拼接过片段时直接切片转码
+    auto finishField = [&](const char *to) {
+        if (field.isEmpty()) {
+            fields.append(QString::fromUtf8(spanStart, to - spanStart));
+        } else {
+            field.append(spanStart, to - spanStart);
+            fields.append(QString::fromUtf8(field));
+            field.clear();
+        }
+    };
+
+    while (true) {
+        const char *q = scanAny(p, end, '"', ',');
+        if (q == end) break;
+
+        if (*q == ',') {
+            if (inQuote) {
+                // 引号内的逗号属于字段内容，继续留在当前片段中
+                p = q + 1;
+                continue;
+            }
+            finishField(q);
+            spanStart = p = q + 1;
+            continue;
+        }
+
+        // 引号：先把引号前的片段放入字段
+        field.append(spanStart, q - spanStart);
+        if (!inQuote) {
+            inQuote = true;
+            p = q + 1;
+        } else if (q + 1 < end && q[1] == '"') {
+            // 连续两个双引号表示一个转义的双引号
+            field.append('"');
+            p = q + 2;
+        } else {
+            inQuote = false;
+            p = q + 1;
+        }
+        spanStart = p;
+    }
+    finishField(end); // 添加最后一个字段
+    return fields;
+}
+
+QList<QStringList> tokenizeChunk(const QByteArrayView &chunk)
+{
+    QList<QStringList> rows;
+    const char *p = chunk.data();
+    const char *end = p + chunk.size();
+    while (p < end) {
+        const char *nl = scanAny(p, end, '\n', '\n');
+        const char *b = p;
+        const char *e = nl;
+        p = (nl < end) ? nl + 1 : end;
+
+        while (b < e && isAsciiSpace(*b)) ++b;
+        while (e > b && isAsciiSpace(e[-1])) --e;
+        if (b == e || *b == '#') continue;
+
+        rows.append(splitRange(b, e));
+    }
+    return rows;
+}
+
+} // namespace
+
+namespace CsvTokenizer {
+
+QStringList splitLine(QByteArrayView line)
+{
+    return splitRange(line.data(), line.data() + line.size());
+}
+
+QList<QStringList> tokenize(QByteArrayView data)
+{
+    if (data.startsWith(QByteArrayView("\xEF\xBB\xBF"))) data = data.sliced(3);
+    if (data.size() < kParallelThreshold) return tokenizeChunk(data);
+
+    // 按换行对齐切块，每块独立切分，最后按块顺序拼接
+    const int threads = qMax(1, QThread::idealThreadCount());
+    const qsizetype target = qMax(kMinChunkSize, data.size() / (threads * 4));
+    QList<QByteArrayView> chunks;
+    qsizetype pos = 0;
+    while (pos < data.size()) {
+        qsizetype cut = qMin(pos + target, data.size());
+        if (cut < data.size()) {
+            const char *nl = scanAny(data.data() + cut, data.data() + data.size(), '\n', '\n');
+            cut = qMin<qsizetype>((nl - data.data()) + 1, data.size());
+        }
+        chunks.append(data.sliced(pos, cut - pos));
+        pos = cut;
+    }
+
+    QFuture<QList<QStringList>> future = QtConcurrent::mapped(chunks, tokenizeChunk);
+    future.waitForFinished();
+
+    QList<QStringList> rows;
+    const QList<QList<QStringList>> parts = future.results();
+    qsizetype total = 0;
+    for (const auto &part : parts) total += part.size();
+    rows.reserve(total);
+    for (const auto &part : parts) rows.append(part);
+    return rows;
+}
+
+} // namespace CsvTokenizer
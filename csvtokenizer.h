@@ -0,0 +1,23 @@
+#ifndef CSVTOKENIZER_H
+#define CSVTOKENIZER_H
+
+#include <QByteArrayView>
+#include <QStringList>
+#include <QList>
+
+// ==================== CSV 分词器 ====================
+// 直接在 UTF-8 原始缓冲区上工作：用 SSE2/AVX2（不支持时退回标量实现）成块查找引号、逗号和换行，
+// 字段按片段整体切出，不再逐字符追加。引号规则与旧的 parseCsvLine 完全一致：
+// 引号内的逗号属于字段内容，引号内连续两个双引号表示一个双引号。
+namespace CsvTokenizer {
+
+// 切分单行（不含换行符）
+QStringList splitLine(QByteArrayView line);
+
+// 切分整个文件：跳过空行与 # 开头的注释行，行首的 UTF-8 BOM 会被忽略。
+// 缓冲区较大时按行块并行处理，结果仍保持原有行序。
+QList<QStringList> tokenize(QByteArrayView data);
+
+} // namespace CsvTokenizer
+
+#endif // CSVTOKENIZER_H
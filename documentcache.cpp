@@ -0,0 +1,163 @@
+#include "documentcache.h"
+#include "nbtcodec.h"
+#include <QCborValue>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace {
+
+const quint32 kCacheMagic = 0x56544443;   // "VTDC"
+const quint32 kCacheVersion = 2;
+
+// 自定义节点与原始文档以 CBOR 形式存入缓存，读取时无需再走一遍 JSON 文本解析
+QByteArray encodeJson(const QJsonValue &value)
+{
+    if (value.isNull() || value.isUndefined()) return QByteArray();
+    return QCborValue::fromJsonValue(value).toCbor();
+}
+
+QJsonValue decodeJson(const QByteArray &cbor)
+{
+    if (cbor.isEmpty()) return QJsonValue();
+    return QCborValue::fromCbor(cbor).toJsonValue();
+}
+
+void writeItem(QDataStream &out, const ItemData &d)
+{
+    out << d.name << qint32(d.count) << qint32(d.damage);
+    // 未展开的物品只保存原始节点，读回后同样保持未展开
+    out << !d.pendingNodes.isEmpty();
+    if (!d.pendingNodes.isEmpty()) {
+        out << encodeJson(d.pendingNodes);
+        return;
+    }
+    out << d.enableName << d.displayName << d.enableLore << d.lore
+        << d.enableEnch << qint32(d.enchId) << qint32(d.enchLevel)
+        << d.enableCustom << (d.customNodes.isEmpty() ? QByteArray() : encodeJson(d.customNodes));
+}
+
+void readItem(QDataStream &in, ItemData &d)
+{
+    qint32 count = 0, damage = 0, enchId = 0, enchLevel = 0;
+    QByteArray customCbor;
+    bool pending = false;
+    in >> d.name >> count >> damage >> pending;
+    d.count = count;
+    d.damage = damage;
+    if (pending) {
+        in >> customCbor;
+        d.pendingNodes = decodeJson(customCbor).toArray();
+        return;
+    }
+    in >> d.enableName >> d.displayName >> d.enableLore >> d.lore
+       >> d.enableEnch >> enchId >> enchLevel
+       >> d.enableCustom >> customCbor;
+    d.enchId = enchId;
+    d.enchLevel = enchLevel;
+    d.customNodes = decodeJson(customCbor).toArray();
+}
+
+} // namespace
+
+namespace DocumentCache {
+
+QString cachePath(const QString &sourcePath)
+{
+    return sourcePath + ".vtecache";
+}
+
+bool read(const QString &sourcePath, FileFingerprint &fp, VillagerDocument &out)
+{
+    QFile file(cachePath(sourcePath));
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) return false;
+
+    uchar *p = file.map(0, file.size());
+    if (!p) return false;
+
+    // 直接在映射内存上反序列化，不复制整个缓存文件
+    const QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char *>(p), file.size());
+    QDataStream in(raw);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    QString cachedPath;
+    FileFingerprint cached;
+    in >> magic >> version >> cachedPath >> cached;
+    if (in.status() != QDataStream::Ok || magic != kCacheMagic || version != kCacheVersion) return false;
+    if (cachedPath != QFileInfo(sourcePath).absoluteFilePath()) return false;
+
+    if (!cached.sameStat(fp)) {
+        // 修改时间变了但内容可能没变（例如仅被 touch），用内容哈希做最终判断
+        if (cached.size != fp.size) return false;
+        if (fp.hash.isEmpty()) fp.hash = FileFingerprint::hashFile(sourcePath);
+        if (fp.hash != cached.hash) return false;
+    }
+
+    VillagerDocument document;
+    QByteArray sourceCbor;
+    quint32 villagerCount = 0;
+    in >> sourceCbor >> villagerCount;
+    const QJsonValue source = decodeJson(sourceCbor);
+    if (source.isObject()) document.source = QJsonDocument(source.toObject());
+    else if (source.isArray()) document.source = QJsonDocument(source.toArray());
+
+    for (quint32 v = 0; v < villagerCount && in.status() == QDataStream::Ok; ++v) {
+        VillagerData villager;
+        qint32 markVariant = 0, entityIndex = -1;
+        quint32 tradeCount = 0;
+        in >> villager.profession >> markVariant >> entityIndex >> tradeCount;
+        villager.markVariant = markVariant;
+        villager.entityIndex = entityIndex;
+        // 每条交易至少占几十字节，计数损坏时不按它预分配
+        villager.trades.reserve(qMin<quint32>(tradeCount, quint32(raw.size() / 16)));
+        for (quint32 i = 0; i < tradeCount && in.status() == QDataStream::Ok; ++i) {
+            TradeOption trade;
+            qint32 uses = 0, maxUses = 0, tier = 0;
+            readItem(in, trade.buyA);
+            readItem(in, trade.buyB);
+            readItem(in, trade.sell);
+            in >> uses >> maxUses >> tier;
+            trade.uses = uses;
+            trade.maxUses = maxUses;
+            trade.tier = tier;
+            villager.trades.append(trade);
+        }
+        document.villagers.append(villager);
+    }
+    if (in.status() != QDataStream::Ok || document.villagers.isEmpty()) return false;
+
+    out = document;
+    return true;
+}
+
+void write(const QString &sourcePath, const FileFingerprint &fp, const VillagerDocument &document)
+{
+    QSaveFile file(cachePath(sourcePath));
+    if (!file.open(QIODevice::WriteOnly)) return;   // 目录不可写时静默跳过，下次仍完整解析
+
+    // 只保存去掉交易的原始文档，交易以二进制形式单独保存
+    const QJsonDocument source = NbtCodec::skeleton(document);
+    const QJsonValue sourceValue = source.isObject() ? QJsonValue(source.object())
+                                 : source.isArray() ? QJsonValue(source.array()) : QJsonValue();
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kCacheMagic << kCacheVersion << QFileInfo(sourcePath).absoluteFilePath() << fp;
+    out << encodeJson(sourceValue) << quint32(document.villagers.size());
+    for (const VillagerData &villager : document.villagers) {
+        out << villager.profession << qint32(villager.markVariant) << qint32(villager.entityIndex)
+            << quint32(villager.trades.size());
+        for (const TradeOption &trade : villager.trades) {
+            writeItem(out, trade.buyA);
+            writeItem(out, trade.buyB);
+            writeItem(out, trade.sell);
+            out << qint32(trade.uses) << qint32(trade.maxUses) << qint32(trade.tier);
+        }
+    }
+    if (out.status() == QDataStream::Ok) file.commit();
+    else file.cancelWriting();
+}
+
+} // namespace DocumentCache
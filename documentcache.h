@@ -0,0 +1,23 @@
+#ifndef DOCUMENTCACHE_H
+#define DOCUMENTCACHE_H
+
+#include <QString>
+#include "filefingerprint.h"
+#include "tradedata.h"
+
+// ==================== 结构文件的解析缓存 ====================
+// 解析结果（各村民的交易、职业、变种，以及去掉交易的原始文档）以紧凑的二进制格式保存在
+// 源文件旁的 <文件名>.vtecache 中。缓存以源文件的路径、大小、修改时间与内容哈希为键，
+// 打开时内存映射直接反序列化；源文件没有变化时不再做 JSON 解析与交易提取。
+namespace DocumentCache {
+
+QString cachePath(const QString &sourcePath);
+
+// 缓存对应当前的源文件时返回 true；fp 为源文件的 fromStat，需要时在其中补上内容哈希
+bool read(const QString &sourcePath, FileFingerprint &fp, VillagerDocument &out);
+// fp 需要带内容哈希；目录不可写时静默跳过
+void write(const QString &sourcePath, const FileFingerprint &fp, const VillagerDocument &document);
+
+} // namespace DocumentCache
+
+#endif // DOCUMENTCACHE_H
@@ -0,0 +1,195 @@
+#include "documentio.h"
+#include "documentcache.h"
+#include "nbtcodec.h"
+#include "tracer.h"
+#include "memtrace.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace {
+
+const qint64 kCacheMinSize = 1024 * 1024;   // 小文件直接解析比读写缓存更快
+
+// 把已经解析好的文档按批交付（与解析时的交付顺序相同）
+void deliverParsed(QPromise<DocumentIO::LoadChunk> &promise, const VillagerDocument &document, int total)
+{
+    qsizetype done = 0;
+    for (int v = 0; v < document.villagers.size(); ++v) {
+        const QList<TradeOption> &trades = document.villagers[v].trades;
+        for (qsizetype b = 0; b < trades.size(); b += DocumentIO::kLoadBatch) {
+            if (promise.isCanceled()) return;
+            DocumentIO::LoadChunk chunk;
+            chunk.villager = v;
+            chunk.trades = trades.mid(b, DocumentIO::kLoadBatch);
+            done += chunk.trades.size();
+            promise.addResult(std::move(chunk));
+            promise.setProgressValue(30 + int(70 * done / total));
+        }
+    }
+}
+
+} // namespace
+
+namespace DocumentIO {
+
+void load(QPromise<LoadChunk> &promise, const QString &path)
+{
+    VTE_TRACE("DocumentIO::load");
+    VTE_MEM_SCOPE(MemTrace::Parse);
+    promise.setProgressRange(0, 100);
+
+    LoadChunk header;
+    header.first = true;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        header.error = file.errorString();
+        promise.addResult(std::move(header));
+        return;
+    }
+    FileFingerprint fp = FileFingerprint::fromStat(path);
+    header.text = QString::fromUtf8(file.readAll());
+    file.close();
+    promise.setProgressValue(10);
+    if (promise.isCanceled()) return;
+
+    // 源文件没有变化时直接使用解析缓存，跳过 JSON 解析与交易提取
+    VillagerDocument cached;
+    if (fp.size >= kCacheMinSize && DocumentCache::read(path, fp, cached)) {
+        header.document = cached;
+        for (VillagerData &villager : header.document.villagers) {
+            header.total += villager.trades.size();
+            villager.trades.clear();
+        }
+        const int total = header.total;
+        promise.setProgressValue(30);
+        promise.addResult(std::move(header));
+        deliverParsed(promise, cached, total);
+        promise.setProgressValue(100);
+        return;
+    }
+
+    // JSON 解析是一步完成的，先枚举村民实体，之后再提取交易
+    QList<QJsonArray> recipes;
+    header.document = NbtCodec::scanDocument(header.text, &recipes);
+    for (const QJsonArray &r : std::as_const(recipes)) header.total += r.size();
+    const int total = header.total;
+    VillagerDocument parsed = header.document;   // 收集完整结果写入缓存
+    promise.setProgressValue(30);
+    promise.addResult(std::move(header));
+
+    // 按村民切成批次；每次并行解析一组批次，再按原顺序交付
+    struct Batch {
+        int villager;
+        qsizetype begin;
+        qsizetype end;
+    };
+    QList<Batch> batches;
+    for (int v = 0; v < recipes.size(); ++v) {
+        for (qsizetype b = 0; b < recipes[v].size(); b += kLoadBatch) {
+            batches.append(Batch{ v, b, qMin(b + kLoadBatch, recipes[v].size()) });
+        }
+    }
+    const qsizetype window = qMax(1, QThread::idealThreadCount()) * 2;
+    qsizetype done = 0;
+    for (qsizetype w = 0; w < batches.size(); w += window) {
+        if (promise.isCanceled()) return;
+        QList<LoadChunk> chunks = QtConcurrent::blockingMapped<QList<LoadChunk>>(batches.mid(w, window), [&recipes](const Batch &batch) {
+            VTE_MEM_SCOPE(MemTrace::Parse);
+            LoadChunk chunk;
+            chunk.villager = batch.villager;
+            chunk.trades.reserve(batch.end - batch.begin);
+            for (qsizetype i = batch.begin; i < batch.end; ++i) {
+                chunk.trades.append(NbtCodec::parseTrade(recipes[batch.villager][i]));
+            }
+            return chunk;
+        });
+        for (LoadChunk &chunk : chunks) {
+            if (promise.isCanceled()) return;
+            done += chunk.trades.size();
+            parsed.villagers[chunk.villager].trades.append(chunk.trades);   // 隐式共享，不复制交易
+            promise.addResult(std::move(chunk));
+            promise.setProgressValue(30 + int(70 * done / total));
+        }
+    }
+    if (fp.size >= kCacheMinSize) {
+        if (fp.hash.isEmpty()) fp.hash = FileFingerprint::hashFile(path);
+        DocumentCache::write(path, fp, parsed);
+    }
+    promise.setProgressValue(100);
+}
+
+void save(QPromise<QString> &promise, const QString &path, const VillagerDocument &document, const CommitFlag &committed)
+{
+    VTE_TRACE("DocumentIO::save");
+    promise.setProgressRange(0, 100);
+
+    // 序列化占 0~60，写入占 60~100
+    qsizetype total = 0;
+    for (const VillagerData &villager : document.villagers) total += villager.trades.size();
+    const QString text = NbtCodec::serialize(document, [&](qsizetype done) {
+        if (total > 0) promise.setProgressValue(int(60 * done / total));
+        return !promise.isCanceled();
+    });
+    if (promise.isCanceled()) return;
+    const QByteArray data = text.toUtf8();
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        promise.addResult(file.errorString());
+        return;
+    }
+    const qsizetype chunkSize = 1024 * 1024;
+    for (qsizetype pos = 0; pos < data.size(); pos += chunkSize) {
+        if (promise.isCanceled()) {
+            file.cancelWriting();   // 丢弃临时文件，目标文件保持原样
+            return;
+        }
+        const qsizetype n = qMin(chunkSize, data.size() - pos);
+        if (file.write(data.constData() + pos, n) != n) break;
+        promise.setProgressValue(60 + int(40 * (pos + n) / data.size()));
+    }
+    // 提交前最后一次响应取消；提交之后的取消不再生效
+    if (promise.isCanceled()) {
+        file.cancelWriting();
+        return;
+    }
+    if (!file.commit()) {
+        promise.addResult(file.errorString());
+        return;
+    }
+    committed->store(true);
+    promise.setProgressValue(100);
+    promise.addResult(QString());
+}
+
+void exportPacked(QPromise<QString> &promise, const QString &path, const QList<VillagerData> &villagers,
+                  const NbtCodec::PackLayout &layout, const CommitFlag &committed)
+{
+    VTE_TRACE("DocumentIO::exportPacked");
+    promise.setProgressRange(0, 100);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        promise.addResult(file.errorString());
+        return;
+    }
+    const bool ok = NbtCodec::writePacked(&file, villagers, layout, [&](qsizetype done) {
+        if (!villagers.isEmpty()) promise.setProgressValue(int(100 * done / villagers.size()));
+        return !promise.isCanceled();
+    });
+    if (promise.isCanceled()) {
+        file.cancelWriting();
+        return;
+    }
+    if (!ok || !file.commit()) {
+        promise.addResult(file.errorString());
+        return;
+    }
+    committed->store(true);
+    promise.setProgressValue(100);
+    promise.addResult(QString());
+}
+
+} // namespace DocumentIO
@@ -0,0 +1,48 @@
+#ifndef DOCUMENTIO_H
+#define DOCUMENTIO_H
+
+#include <QList>
+#include <QPromise>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include "nbtcodec.h"
+#include "tradedata.h"
+
+// ==================== 后台加载与保存 ====================
+// 供 QtConcurrent::run 调用的工作函数，通过 QPromise 报告进度（0~100）并响应取消。
+// 较大的文件加载后把解析结果写入旁边的 .vtecache（见 DocumentCache），再次打开时不再解析。
+namespace DocumentIO {
+
+// 加载结果按批交付，界面可以边解析边填充表格；同一村民的批次按顺序到达
+struct LoadChunk {
+    int villager = 0;      // 这一批交易所属的村民
+    QList<TradeOption> trades;
+
+    // 以下字段只在第一批中有效
+    bool first = false;
+    QString error;         // 非空表示读取失败，此时没有后续批次
+    int total = 0;         // 所有村民的交易总数
+    VillagerDocument document;   // 各村民的职业、变种与实体位置（交易为空）
+    QString text;          // 原始文本，用于预览
+};
+
+const int kLoadBatch = 256;
+
+void load(QPromise<LoadChunk> &promise, const QString &path);
+
+// 目标文件已被替换时置位。提交之后就不能撤回：这时再按取消，QFuture 会丢弃随后的结果，
+// 调用方应以这个标志而不是 isCanceled() 判断文件是否已经写入
+using CommitFlag = std::shared_ptr<std::atomic_bool>;
+
+// 序列化后通过 QSaveFile 写入：写完并提交后才替换目标文件，中途崩溃或取消不会破坏原文件。
+// 结果为错误信息，成功时为空字符串
+void save(QPromise<QString> &promise, const QString &path, const VillagerDocument &document, const CommitFlag &committed);
+
+// 把多个村民打包成一个结构写入 path（见 NbtCodec::writePacked），同样通过 QSaveFile 提交
+void exportPacked(QPromise<QString> &promise, const QString &path, const QList<VillagerData> &villagers,
+                  const NbtCodec::PackLayout &layout, const CommitFlag &committed);
+
+} // namespace DocumentIO
+
+#endif // DOCUMENTIO_H
@@ -0,0 +1,158 @@
+#include "documenttabs.h"
+#include "villagereditor.h"
+#include <QCloseEvent>
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QShortcut>
+#include <QTabWidget>
+#include <QTimer>
+#include <QToolButton>
+
+DocumentTabs::DocumentTabs(QWidget *parent)
+    : QMainWindow(parent)
+    , m_tabs(new QTabWidget(this))
+{
+    resize(1300, 900);
+    m_tabs->setDocumentMode(true);
+    m_tabs->setTabsClosable(true);
+    m_tabs->setMovable(true);
+    setCentralWidget(m_tabs);
+
+    QToolButton *btnNew = new QToolButton(this);
+    btnNew->setText("+");
+    btnNew->setToolTip("新建文档 (Ctrl+T)");
+    m_tabs->setCornerWidget(btnNew, Qt::TopRightCorner);
+
+    connect(btnNew, &QToolButton::clicked, this, &DocumentTabs::newDocument);
+    connect(m_tabs, &QTabWidget::tabCloseRequested, this, &DocumentTabs::closeDocument);
+    connect(m_tabs, &QTabWidget::currentChanged, this, &DocumentTabs::updateWindowTitle);
+    connect(new QShortcut(QKeySequence("Ctrl+T"), this), &QShortcut::activated, this, &DocumentTabs::newDocument);
+    connect(new QShortcut(QKeySequence("Ctrl+O"), this), &QShortcut::activated, this, &DocumentTabs::openWithDialog);
+    connect(new QShortcut(QKeySequence("Ctrl+W"), this), &QShortcut::activated, this, [this]() {
+        closeDocument(m_tabs->currentIndex());
+    });
+
+    // 窗口出现后再检查上次是否异常退出
+    QTimer::singleShot(0, this, &DocumentTabs::offerRecovery);
+}
+
+// 上次异常退出留下编辑日志时询问是否恢复。恢复到新的空白标签页中：
+// 命令行打开的文件此时可能还在加载，加载完成会覆盖恢复结果
+void DocumentTabs::offerRecovery()
+{
+    const QList<EditJournal::Recovery> orphans = EditJournal::findOrphans();
+    if (orphans.isEmpty()) return;
+    const EditJournal::Recovery &recovery = orphans.first();   // 最近的一次会话
+
+    const QString baseName = recovery.basePath.isEmpty() ? QString("新建的文档") : QDir::toNativeSeparators(recovery.basePath);
+    auto answer = QMessageBox::question(this, "恢复未保存的修改",
+                                        QString("上次程序异常退出，留下了 %1 条未保存的修改（基于：%2）。\n\n是否恢复？")
+                                            .arg(recovery.records.size()).arg(baseName));
+    if (answer != QMessageBox::Yes) {
+        QFile::remove(recovery.journalPath);
+        return;
+    }
+    newDocument()->recover(recovery);
+}
+
+VillagerEditor *DocumentTabs::newDocument()
+{
+    VillagerEditor *editor = new VillagerEditor(m_tabs);
+    editor->setWindowFlags(Qt::Widget);   // 作为标签页嵌入，而不是独立窗口
+    auto refreshTitles = [this, editor]() {
+        updateTabTitle(editor);
+        updateWindowTitle();
+    };
+    connect(editor, &VillagerEditor::documentPathChanged, this, refreshTitles);
+    connect(editor, &VillagerEditor::modifiedChanged, this, refreshTitles);
+    m_tabs->setCurrentIndex(m_tabs->addTab(editor, QString()));
+    updateTabTitle(editor);
+    updateWindowTitle();
+    return editor;
+}
+
+void DocumentTabs::openDocument(const QString &path)
+{
+    for (int i = 0; i < m_tabs->count(); ++i) {
+        const QString opened = editorAt(i)->documentPath();
+        if (!opened.isEmpty() && QFileInfo(opened) == QFileInfo(path)) {
+            m_tabs->setCurrentIndex(i);
+            return;
+        }
+    }
+    VillagerEditor *editor = newDocument();
+    // 加载完成后标题才由 documentPathChanged 更新，这里先显示文件名
+    m_tabs->setTabText(m_tabs->indexOf(editor), QFileInfo(path).fileName());
+    m_tabs->setTabToolTip(m_tabs->indexOf(editor), QDir::toNativeSeparators(path));
+    updateWindowTitle();
+    editor->openPath(path);
+}
+
+void DocumentTabs::openWithDialog()
+{
+    const QStringList paths = QFileDialog::getOpenFileNames(this, "在新标签页中打开", "", "JSON (*.json);;所有 (*.*)");
+    for (const QString &path : paths) openDocument(path);
+}
+
+void DocumentTabs::closeDocument(int index)
+{
+    VillagerEditor *editor = editorAt(index);
+    if (!editor || !confirmDiscard({ editor })) return;
+    m_tabs->removeTab(index);
+    editor->deleteLater();
+    if (m_tabs->count() == 0) newDocument();   // 始终保留一个可编辑的文档
+}
+
+void DocumentTabs::closeEvent(QCloseEvent *event)
+{
+    QList<VillagerEditor *> editors;
+    for (int i = 0; i < m_tabs->count(); ++i) editors.append(editorAt(i));
+    if (confirmDiscard(editors)) {
+        event->accept();
+    } else {
+        event->ignore();
+    }
+}
+
+// 关闭标签页会删除编辑器并丢弃其编辑日志，未保存的修改无法再恢复
+bool DocumentTabs::confirmDiscard(const QList<VillagerEditor *> &editors)
+{
+    QStringList names;
+    VillagerEditor *first = nullptr;
+    for (VillagerEditor *editor : editors) {
+        if (!editor || !editor->isModified()) continue;
+        if (!first) first = editor;
+        const QString path = editor->documentPath();
+        names << (path.isEmpty() ? QString("未命名") : QDir::toNativeSeparators(path));
+    }
+    if (names.isEmpty()) return true;
+
+    m_tabs->setCurrentWidget(first);
+    auto answer = QMessageBox::question(this, "未保存的修改",
+                                        QString("以下文档有未保存的修改，关闭后将丢失：\n%1\n\n仍要关闭吗？").arg(names.join('\n')),
+                                        QMessageBox::Discard | QMessageBox::Cancel, QMessageBox::Cancel);
+    return answer == QMessageBox::Discard;
+}
+
+void DocumentTabs::updateTabTitle(VillagerEditor *editor)
+{
+    const int index = m_tabs->indexOf(editor);
+    if (index < 0) return;
+    const QString path = editor->documentPath();
+    const QString name = path.isEmpty() ? QString("未命名") : QFileInfo(path).fileName();
+    m_tabs->setTabText(index, editor->isModified() ? name + " *" : name);
+    m_tabs->setTabToolTip(index, QDir::toNativeSeparators(path));
+}
+
+void DocumentTabs::updateWindowTitle()
+{
+    const int index = m_tabs->currentIndex();
+    setWindowTitle(index < 0 ? QString("村民交易编辑器") : QString("%1 - 村民交易编辑器").arg(m_tabs->tabText(index)));
+}
+
+VillagerEditor *DocumentTabs::editorAt(int index) const
+{
+    return qobject_cast<VillagerEditor *>(m_tabs->widget(index));
+}
@@ -0,0 +1,37 @@
+#ifndef DOCUMENTTABS_H
+#define DOCUMENTTABS_H
+
+#include <QMainWindow>
+
+class QTabWidget;
+class VillagerEditor;
+
+// ==================== 多文档标签页 ====================
+// 每个标签页是一个独立的 VillagerEditor：自己的交易列表、撤销历史、编辑日志与预览序列化线程；
+// 物品库、自动补全模型由 CatalogService 在全进程共用。切换标签页只是切换显示，不重新解析文件。
+class DocumentTabs : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    explicit DocumentTabs(QWidget *parent = nullptr);
+
+    VillagerEditor *newDocument();
+    void openDocument(const QString &path);   // 已在某个标签页中打开时切换过去
+
+protected:
+    void closeEvent(QCloseEvent *event) override;   // 有未保存的标签页时先确认
+
+private:
+    void offerRecovery();
+    void openWithDialog();
+    void closeDocument(int index);
+    bool confirmDiscard(const QList<VillagerEditor *> &editors);   // 列出其中有未保存修改的文档并询问是否放弃
+    void updateTabTitle(VillagerEditor *editor);
+    void updateWindowTitle();
+    VillagerEditor *editorAt(int index) const;
+
+    QTabWidget *m_tabs;
+};
+
+#endif // DOCUMENTTABS_H
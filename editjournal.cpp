@@ -0,0 +1,323 @@
+#include "editjournal.h"
+#include "tradefields.h"
+#include <QAtomicInt>
+#include <QCborValue>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QLockFile>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+#include <utility>
+
+namespace {
+
+const quint32 kJournalMagic = 0x56544A45;   // "VTJE"
+const quint32 kJournalVersion = 2;   // 2：多村民（头部记录当前村民，新增 SelectVillager）
+const int kFlushDelayMs = 250;              // 记录攒够这么久再批量写入
+const qsizetype kFlushThreshold = 64 * 1024;
+
+enum Op {
+    SetField = 1,   // [op, row, field, value]
+    Insert = 2,     // [op, row, [字段值...]]
+    Remove = 3,     // [op, row]
+    Globals = 4,    // [op, profession, markVariant]
+    Reset = 5,      // [op, [[字段值...], ...]]
+    SelectVillager = 6,   // [op, index]，之后的记录作用于这个村民
+};
+
+QCborArray encodeTrade(const TradeOption &trade)
+{
+    QCborArray values;
+    for (int f = 0; f < TradeFields::FieldCount; ++f) {
+        values.append(QCborValue::fromVariant(TradeFields::value(trade, f)));
+    }
+    return values;
+}
+
+TradeOption decodeTrade(const QCborArray &values)
+{
+    TradeOption trade;
+    const int n = qMin(int(values.size()), int(TradeFields::FieldCount));
+    for (int f = 0; f < n; ++f) {
+        TradeFields::setValue(trade, f, values.at(f).toVariant());
+    }
+    return trade;
+}
+
+QByteArray encodeHeader(const QString &basePath, int villager)
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kJournalMagic << kJournalVersion << basePath
+        << (basePath.isEmpty() ? FileFingerprint() : FileFingerprint::fromStat(basePath)) << qint32(villager);
+    return header;
+}
+
+bool readJournal(const QString &path, EditJournal::Recovery &out)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray raw = file.readAll();
+
+    QDataStream in(raw);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != kJournalMagic || version != kJournalVersion) return false;
+    qint32 villager = 0;
+    in >> out.basePath >> out.baseFingerprint >> villager;
+    out.initialVillager = villager;
+    if (in.status() != QDataStream::Ok) return false;
+
+    // 逐条读取，遇到不完整或校验失败的记录（崩溃时写了一半）就停止
+    qsizetype pos = in.device()->pos();
+    while (raw.size() - pos >= 6) {
+        const quint32 length = qFromLittleEndian<quint32>(raw.constData() + pos);
+        const quint16 checksum = qFromLittleEndian<quint16>(raw.constData() + pos + 4);
+        if (raw.size() - pos - 6 < qsizetype(length)) break;
+        const QByteArrayView payload(raw.constData() + pos + 6, length);
+        if (qChecksum(payload) != checksum) break;
+        const QCborValue record = QCborValue::fromCbor(payload.toByteArray());
+        if (!record.isArray()) break;
+        out.records.append(record.toArray());
+        pos += 6 + length;
+    }
+    out.journalPath = path;
+    return true;
+}
+
+QString newJournalPath()
+{
+    // 同一进程可能有多个编辑器窗口，用计数器区分
+    static QAtomicInt counter;
+    return QString("%1/%2-%3-%4.journal")
+        .arg(EditJournal::directory())
+        .arg(QDateTime::currentMSecsSinceEpoch())
+        .arg(QCoreApplication::applicationPid())
+        .arg(counter.fetchAndAddRelaxed(1));
+}
+
+} // namespace
+
+EditJournal::EditJournal(QObject *parent)
+    : QObject(parent)
+    , m_path(newJournalPath())
+{
+    QDir().mkpath(directory());
+    m_lock = std::make_unique<QLockFile>(m_path + ".lock");
+    m_lock->setStaleLockTime(0);   // 只凭进程是否存活判断，长时间的会话也不会被当成过期
+    m_lock->tryLock(0);
+    m_file.setFileName(m_path);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(kFlushDelayMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+    // 写入期间到达的记录在这一批写完后接着写
+    connect(&m_writer, &QFutureWatcher<void>::finished, this, &EditJournal::flush);
+
+    rebase(QString(), 0);
+}
+
+EditJournal::~EditJournal()
+{
+    finish();
+}
+
+QString EditJournal::directory()
+{
+    return QCoreApplication::applicationDirPath() + "/recovery";
+}
+
+void EditJournal::rebase(const QString &basePath, int villager)
+{
+    // 之前的记录已经包含在新的基准文件里，尚未写出的也不再需要
+    m_pending.clear();
+    m_pendingHeader = encodeHeader(basePath, villager);
+    m_hasRecords = false;
+    // 文件里已有旧记录时尽快覆盖，避免崩溃后在新文件上重放旧修改
+    if (m_fileCreated) flush();
+}
+
+void EditJournal::recordTrade(int row, const TradeOption &before, const TradeOption &after)
+{
+    for (int field : TradeFields::changedFields(before, after)) {
+        append(QCborArray{ SetField, row, field, QCborValue::fromVariant(TradeFields::value(after, field)) });
+    }
+}
+
+void EditJournal::recordInsert(int row, const TradeOption &trade)
+{
+    append(QCborArray{ Insert, row, encodeTrade(trade) });
+}
+
+void EditJournal::recordRemove(int row)
+{
+    append(QCborArray{ Remove, row });
+}
+
+void EditJournal::recordGlobals(const QString &profession, int markVariant)
+{
+    append(QCborArray{ Globals, profession, markVariant });
+}
+
+void EditJournal::recordSelectVillager(int index)
+{
+    append(QCborArray{ SelectVillager, index });
+}
+
+void EditJournal::recordReset(const QList<TradeOption> &trades)
+{
+    QCborArray list;
+    for (const TradeOption &trade : trades) list.append(encodeTrade(trade));
+    append(QCborArray{ Reset, list });
+}
+
+void EditJournal::recordDiff(const QList<TradeOption> &before, const QList<TradeOption> &after)
+{
+    // 去掉相同的前缀和后缀，中间部分逐行比较字段，多出的行记录为插入或删除
+    qsizetype prefix = 0;
+    while (prefix < before.size() && prefix < after.size() && before[prefix] == after[prefix]) ++prefix;
+    qsizetype suffix = 0;
+    while (suffix < before.size() - prefix && suffix < after.size() - prefix
+           && before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) {
+        ++suffix;
+    }
+
+    const qsizetype oldCount = before.size() - prefix - suffix;
+    const qsizetype newCount = after.size() - prefix - suffix;
+    const qsizetype common = qMin(oldCount, newCount);
+    for (qsizetype i = prefix; i < prefix + common; ++i) recordTrade(int(i), before[i], after[i]);
+    for (qsizetype i = common; i < oldCount; ++i) recordRemove(int(prefix + common));
+    for (qsizetype i = common; i < newCount; ++i) recordInsert(int(prefix + i), after[prefix + i]);
+}
+
+void EditJournal::append(const QCborArray &record)
+{
+    const QByteArray payload = record.toCborValue().toCbor();
+    char frame[6];
+    qToLittleEndian<quint32>(quint32(payload.size()), frame);
+    qToLittleEndian<quint16>(qChecksum(payload), frame + 4);
+    m_pending.append(frame, sizeof(frame));
+    m_pending.append(payload);
+    m_hasRecords = true;
+
+    if (m_pending.size() >= kFlushThreshold) {
+        flush();
+    } else if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void EditJournal::flush()
+{
+    if (m_writer.isRunning()) return;   // 当前这批写完后会再次调用
+    if (m_pending.isEmpty() && (m_pendingHeader.isEmpty() || !m_fileCreated)) return;
+
+    m_fileCreated = true;
+    const QByteArray header = std::exchange(m_pendingHeader, QByteArray());
+    const QByteArray data = std::exchange(m_pending, QByteArray());
+    m_writer.setFuture(QtConcurrent::run([this, header, data]() {
+        ensureOpen();
+        if (!m_file.isOpen()) return;
+        if (!header.isEmpty()) {
+            m_file.resize(0);
+            m_file.write(header);
+        }
+        m_file.write(data);
+        m_file.flush();   // 交给操作系统，进程崩溃后数据仍在
+    }));
+}
+
+void EditJournal::ensureOpen()
+{
+    if (!m_file.isOpen()) m_file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+void EditJournal::finish()
+{
+    m_flushTimer.stop();
+    m_writer.waitForFinished();
+    if (!m_pending.isEmpty() || (!m_pendingHeader.isEmpty() && m_fileCreated)) {
+        ensureOpen();
+        if (!m_pendingHeader.isEmpty()) {
+            m_file.resize(0);
+            m_file.write(m_pendingHeader);
+        }
+        m_file.write(m_pending);
+        m_pending.clear();
+        m_pendingHeader.clear();
+    }
+    m_file.close();
+}
+
+void EditJournal::discard()
+{
+    m_flushTimer.stop();
+    m_writer.waitForFinished();
+    m_pending.clear();
+    m_pendingHeader.clear();
+    m_file.close();
+    QFile::remove(m_path);
+    m_fileCreated = false;
+}
+
+QList<EditJournal::Recovery> EditJournal::findOrphans()
+{
+    QList<Recovery> result;
+    const QFileInfoList files = QDir(directory()).entryInfoList({ "*.journal" }, QDir::Files, QDir::Time);
+    for (const QFileInfo &info : files) {
+        // 锁被存活的进程持有说明会话仍在运行（包括本进程的其他窗口）
+        QLockFile lock(info.absoluteFilePath() + ".lock");
+        lock.setStaleLockTime(0);
+        if (!lock.tryLock(0)) continue;
+
+        Recovery recovery;
+        if (!readJournal(info.absoluteFilePath(), recovery) || recovery.records.isEmpty()) {
+            QFile::remove(info.absoluteFilePath());
+            continue;
+        }
+        result.append(recovery);
+    }
+    return result;
+}
+
+void EditJournal::replay(const QList<QCborArray> &records, QList<VillagerData> &villagers, int &current)
+{
+    if (villagers.isEmpty()) villagers.append(VillagerData());
+    current = qBound(0, current, int(villagers.size()) - 1);
+    for (const QCborArray &record : records) {
+        const qint64 row = record.at(1).toInteger(-1);
+        QList<TradeOption> &trades = villagers[current].trades;
+        switch (record.at(0).toInteger()) {
+        case SetField:
+            if (row >= 0 && row < trades.size()) {
+                TradeFields::setValue(trades[row], int(record.at(2).toInteger(-1)), record.at(3).toVariant());
+            }
+            break;
+        case Insert:
+            trades.insert(qBound<qint64>(0, row, trades.size()), decodeTrade(record.at(2).toArray()));
+            break;
+        case Remove:
+            if (row >= 0 && row < trades.size()) trades.removeAt(row);
+            break;
+        case Globals:
+            villagers[current].profession = record.at(1).toString();
+            villagers[current].markVariant = int(record.at(2).toInteger());
+            break;
+        case Reset: {
+            trades.clear();
+            const QCborArray list = record.at(1).toArray();
+            for (const QCborValue &values : list) trades.append(decodeTrade(values.toArray()));
+            break;
+        }
+        case SelectVillager:
+            if (row >= 0 && row < villagers.size()) current = int(row);
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QObject>
+#include <QCborArray>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <memory>
+#include "filefingerprint.h"
+#include "tradedata.h"
+
+class QLockFile;
+
+// ==================== 编辑日志（崩溃恢复） ====================
+// 只追加的二进制日志：头部记录基准文件（最近一次加载或保存的文件），之后每条记录是一次修改
+// （某条交易的某个字段的新值、插入、删除、全局属性、切换当前村民）。记录在界面线程编码进缓冲区，
+// 由后台任务批量写入并 flush，界面线程从不等待磁盘。
+// 正常关闭时删除日志；启动时找到没有被运行中的会话持有的日志，就可以在基准文件上重放恢复。
+//
+// 文件格式：magic "VTJE"、版本、基准路径与指纹（QDataStream），
+// 之后每条记录为 [quint32 长度][quint16 校验和][CBOR 数组]，末尾写了一半的记录在读取时丢弃。
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditJournal(QObject *parent = nullptr);
+    ~EditJournal();   // 写完剩余记录；不删除日志（正常关闭请先调用 discard）
+
+    static QString directory();   // applicationDirPath()/recovery
+
+    // 以 basePath 为新的基准清空日志（加载、保存之后调用）；空路径表示新建的空文档。
+    // villager 是当前村民，之后的交易与全局属性记录都作用于它，直到 recordSelectVillager
+    void rebase(const QString &basePath, int villager);
+
+    void recordTrade(int row, const TradeOption &before, const TradeOption &after);   // 只记录变化的字段
+    void recordInsert(int row, const TradeOption &trade);
+    void recordRemove(int row);
+    void recordGlobals(const QString &profession, int markVariant);
+    void recordSelectVillager(int index);
+    void recordReset(const QList<TradeOption> &trades);
+    // 记录把 before 变成 after 的最小修改（撤销 / 重做时使用）
+    void recordDiff(const QList<TradeOption> &before, const QList<TradeOption> &after);
+
+    void discard();   // 正常关闭：写完后删除日志文件
+
+    // ---------- 恢复 ----------
+    struct Recovery {
+        QString journalPath;
+        QString basePath;
+        FileFingerprint baseFingerprint;
+        int initialVillager = 0;
+        QList<QCborArray> records;
+    };
+    // 上次异常退出留下的日志，按修改时间从新到旧；只有头部没有记录的日志直接删除
+    static QList<Recovery> findOrphans();
+    // 在基准文档的各村民上依次重放记录；current 传入 initialVillager，返回重放后的当前村民
+    static void replay(const QList<QCborArray> &records, QList<VillagerData> &villagers, int &current);
+
+private:
+    void append(const QCborArray &record);
+    void flush();
+    void finish();
+    void ensureOpen();
+
+    QString m_path;
+    std::unique_ptr<QLockFile> m_lock;
+    QFile m_file;              // 只在写入任务中访问（同一时刻最多一个任务）；finish / discard 等任务结束后才访问
+    bool m_fileCreated = false;   // 主线程记录：已经安排过写入任务，磁盘上可能有日志文件
+    QByteArray m_pending;      // 等待写入的记录
+    QByteArray m_pendingHeader;   // 非空时先清空文件再写入这个头部
+    bool m_hasRecords = false;
+    QTimer m_flushTimer;
+    QFutureWatcher<void> m_writer;
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,36 @@
+#include "filefingerprint.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+FileFingerprint FileFingerprint::fromStat(const QString &path)
+{
+    FileFingerprint fp;
+    QFileInfo info(path);
+    if (!info.exists() || !info.isFile()) return fp;
+    fp.size = info.size();
+    fp.mtime = info.lastModified().toMSecsSinceEpoch();
+    return fp;
+}
+
+QByteArray FileFingerprint::hashData(QByteArrayView data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+QByteArray FileFingerprint::hashFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    if (file.size() == 0) return hashData(QByteArrayView());
+
+    // 优先使用内存映射，避免把大文件整个拷贝进内存
+    if (uchar *p = file.map(0, file.size())) {
+        return hashData(QByteArrayView(reinterpret_cast<const char *>(p), file.size()));
+    }
+
+    QCryptographicHash hasher(QCryptographicHash::Sha1);
+    hasher.addData(&file);
+    return hasher.result();
+}
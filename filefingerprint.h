@@ -0,0 +1,35 @@
+#ifndef FILEFINGERPRINT_H
+#define FILEFINGERPRINT_H
+
+#include <QString>
+#include <QByteArray>
+#include <QDataStream>
+
+// ==================== 文件指纹 ====================
+// 用于判断磁盘缓存是否仍然对应源文件：大小 + 修改时间 + 内容哈希
+struct FileFingerprint {
+    qint64 size = -1;
+    qint64 mtime = 0;       // 修改时间（毫秒）
+    QByteArray hash;        // 内容哈希，按需计算
+
+    bool isValid() const { return size >= 0; }
+    bool sameStat(const FileFingerprint &other) const {
+        return size == other.size && mtime == other.mtime;
+    }
+
+    // 只读取文件大小与修改时间（不读内容）
+    static FileFingerprint fromStat(const QString &path);
+    // 读取（映射）整个文件并计算内容哈希
+    static QByteArray hashFile(const QString &path);
+    static QByteArray hashData(QByteArrayView data);
+};
+
+inline QDataStream &operator<<(QDataStream &out, const FileFingerprint &fp) {
+    return out << fp.size << fp.mtime << fp.hash;
+}
+
+inline QDataStream &operator>>(QDataStream &in, FileFingerprint &fp) {
+    return in >> fp.size >> fp.mtime >> fp.hash;
+}
+
+#endif // FILEFINGERPRINT_H
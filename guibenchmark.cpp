@@ -0,0 +1,212 @@
+#include "guibenchmark.h"
+#include "catalogservice.h"
+#include "corpusgenerator.h"
+#include "villagereditor.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+const int kDefaultIterations = 50;
+
+struct Result {
+    qsizetype trades;
+    QString scenario;
+    QList<double> samplesMs;
+};
+
+// 最近秩法：第 p 百分位是排序后第 ceil(p·n) 个样本
+double percentile(QList<double> sorted, double p)
+{
+    if (sorted.isEmpty()) return 0;
+    std::sort(sorted.begin(), sorted.end());
+    const qsizetype rank = qMax<qsizetype>(1, qsizetype(std::ceil(p * sorted.size())));
+    return sorted[qMin(rank, sorted.size()) - 1];
+}
+
+// 处理完所有待处理事件（包括布局与重绘）
+void drain()
+{
+    QCoreApplication::sendPostedEvents();
+    QCoreApplication::processEvents(QEventLoop::AllEvents);
+}
+
+void typeKey(QWidget *target, Qt::Key key, const QString &text)
+{
+    QKeyEvent press(QEvent::KeyPress, key, Qt::NoModifier, text);
+    QCoreApplication::sendEvent(target, &press);
+    QKeyEvent release(QEvent::KeyRelease, key, Qt::NoModifier, text);
+    QCoreApplication::sendEvent(target, &release);
+}
+
+void clickCell(QTableWidget *table, int row)
+{
+    QTableWidgetItem *item = table->item(row, 0);
+    if (!item) return;
+    table->scrollToItem(item);
+    const QPointF pos = table->visualItemRect(item).center();
+    const QPointF global = table->viewport()->mapToGlobal(pos);
+    QMouseEvent press(QEvent::MouseButtonPress, pos, global, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(table->viewport(), &press);
+    QMouseEvent release(QEvent::MouseButtonRelease, pos, global, Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(table->viewport(), &release);
+}
+
+void waitUntil(const std::function<bool()> &done)
+{
+    while (!done()) QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents, 50);
+    drain();
+}
+
+} // namespace
+
+// 预览在文档自己的后台线程中生成，计时到新的预览文本显示为止
+double GuiBenchmark::measure(VillagerEditor &editor, const std::function<void()> &action)
+{
+    QElapsedTimer timer;
+    timer.start();
+    action();
+    drain();
+    waitUntil([&editor]() { return !editor.m_previewWatcher.isRunning() && !editor.m_previewQueued; });
+    return timer.nsecsElapsed() / 1e6;
+}
+
+bool GuiBenchmark::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--gui-benchmark") == 0) return true;
+    }
+    return false;
+}
+
+int GuiBenchmark::run(QApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("村民交易编辑器（界面延迟基准测试）");
+    parser.addHelpOption();
+    const QCommandLineOption benchmarkOption("gui-benchmark", "运行界面延迟基准测试。");
+    const QCommandLineOption sizesOption("sizes", "文档大小（交易数），逗号分隔（默认 10,100,1000,10000）。", "列表", "10,100,1000,10000");
+    const QCommandLineOption iterationsOption("iterations", QString("每个场景的采样次数（默认 %1）。").arg(kDefaultIterations), "次数");
+    const QCommandLineOption seedOption("seed", "生成文档的随机种子（默认 1）。", "整数");
+    const QCommandLineOption outputOption("benchmark-output", "把结果另存为 JSON。", "文件");
+    parser.addOptions({ benchmarkOption, sizesOption, iterationsOption, seedOption, outputOption });
+    parser.process(app);
+
+    QList<qsizetype> sizes;
+    for (const QString &part : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const qsizetype n = part.trimmed().toLongLong(&ok);
+        if (!ok || n <= 0) {
+            qWarning().noquote() << "[基准] 无效的文档大小：" << part;
+            return 2;
+        }
+        sizes.append(n);
+    }
+    const int iterations = parser.isSet(iterationsOption) ? qMax(1, parser.value(iterationsOption).toInt()) : kDefaultIterations;
+    const quint32 seed = parser.isSet(seedOption) ? parser.value(seedOption).toUInt() : 1;
+
+    qputenv("VTE_STALL_MS", "0");   // 测量期间的卡顿是预期的，不写入卡顿日志
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qWarning().noquote() << "[基准] 无法创建临时目录";
+        return 1;
+    }
+
+    QList<Result> results;
+    QRandomGenerator rng(seed);
+    for (const qsizetype size : std::as_const(sizes)) {
+        CorpusGenerator::Options options;
+        options.seed = seed;
+        options.trades = size;
+        const QString path = dir.filePath(QString("bench-%1.json").arg(size));
+        QString error;
+        if (!CorpusGenerator::writeDocument(path, options, &error)) {
+            qWarning().noquote() << "[基准] 生成文档失败：" << error;
+            return 1;
+        }
+
+        VillagerEditor editor;
+        editor.m_interactive = false;
+        editor.show();
+        waitUntil([]() { return CatalogService::instance()->isReady(); });
+        editor.openPath(path);
+        waitUntil([&editor]() { return !editor.isBusy() && editor.m_loadingPath.isEmpty(); });
+
+        const int rows = editor.m_tradeOptions.size();
+        Result select{ size, "选择行", {} }, typeName{ size, "输入显示名", {} }, typeCustom{ size, "输入自定义节点", {} };
+        Result add{ size, "添加交易", {} }, remove{ size, "删除交易", {} };
+
+        for (int i = 0; i < iterations; ++i) {
+            const int row = int(rng.bounded(quint32(rows)));
+            select.samplesMs.append(measure(editor, [&]() { clickCell(editor.m_tradeTable, row); }));
+        }
+
+        // 在第一行的出售物品上输入；先启用显示名与自定义节点，让对应输入框可用
+        clickCell(editor.m_tradeTable, 0);
+        editor.wSell.cbEnableName->setChecked(true);
+        editor.wSell.cbEnableCustom->setChecked(true);
+        editor.wSell.teCustom->setPlainText("[]");   // 光标在开头，输入空格后仍是合法 JSON
+        drain();
+        for (int i = 0; i < iterations; ++i) {
+            typeName.samplesMs.append(measure(editor, [&]() { typeKey(editor.wSell.leDisp, Qt::Key_A, "a"); }));
+        }
+        for (int i = 0; i < iterations; ++i) {
+            typeCustom.samplesMs.append(measure(editor, [&]() { typeKey(editor.wSell.teCustom, Qt::Key_Space, " "); }));
+        }
+
+        for (int i = 0; i < iterations; ++i) {
+            add.samplesMs.append(measure(editor, [&]() { editor.addTradeOption(); }));
+            remove.samplesMs.append(measure(editor, [&]() { editor.deleteTradeOption(); }));
+        }
+        results << select << typeName << typeCustom << add << remove;
+        editor.close();
+    }
+
+    QJsonArray json;
+    qInfo().noquote() << QString("[基准] %1 | %2 | %3 | %4 | %5 (ms)")
+                             .arg(QString("交易数"), 8).arg(QString("场景"), -10).arg(QString("p50"), 8).arg(QString("p95"), 8).arg(QString("p99"), 8);
+    for (const Result &r : std::as_const(results)) {
+        const double p50 = percentile(r.samplesMs, 0.50), p95 = percentile(r.samplesMs, 0.95), p99 = percentile(r.samplesMs, 0.99);
+        qInfo().noquote() << QString("[基准] %1 | %2 | %3 | %4 | %5")
+                                 .arg(r.trades, 8).arg(r.scenario, -10)
+                                 .arg(p50, 8, 'f', 2).arg(p95, 8, 'f', 2).arg(p99, 8, 'f', 2);
+        QJsonObject obj;
+        obj["trades"] = r.trades;
+        obj["scenario"] = r.scenario;
+        obj["samples"] = r.samplesMs.size();
+        obj["p50"] = p50;
+        obj["p95"] = p95;
+        obj["p99"] = p99;
+        obj["max"] = percentile(r.samplesMs, 1.0);
+        json.append(obj);
+    }
+
+    if (parser.isSet(outputOption)) {
+        QJsonObject root;
+        root["seed"] = qint64(seed);
+        root["iterations"] = iterations;
+        root["qt"] = QString::fromLatin1(qVersion());
+        root["results"] = json;
+        QSaveFile file(parser.value(outputOption));
+        const QByteArray data = QJsonDocument(root).toJson();
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            qWarning().noquote() << "[基准] 无法写入结果：" << file.errorString();
+            return 1;
+        }
+    }
+    return 0;
+}
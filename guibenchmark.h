@@ -0,0 +1,23 @@
+#ifndef GUIBENCHMARK_H
+#define GUIBENCHMARK_H
+
+#include <functional>
+
+class QApplication;
+class VillagerEditor;
+
+// ==================== 界面延迟基准测试 ====================
+// --gui-benchmark 启动时不进入正常界面：依次生成不同大小的文档（见 CorpusGenerator），
+// 在真实的编辑器窗口中加载，模拟选择行、在显示名与自定义节点框中输入、添加与删除交易，
+// 测量从输入事件到表格与预览更新完成（事件队列处理完毕）的时间，输出 p50 / p95 / p99。
+class GuiBenchmark
+{
+public:
+    static bool isRequested(int argc, char *argv[]);
+    static int run(QApplication &app);   // 返回进程退出码
+
+private:
+    static double measure(VillagerEditor &editor, const std::function<void()> &action);
+};
+
+#endif // GUIBENCHMARK_H
@@ -0,0 +1,220 @@
+#include "itemcatalog.h"
+#include "tracer.h"
+#include "filefingerprint.h"
+#include "csvtokenizer.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QTextStream>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QJsonDocument>
+#include <QCborValue>
+
+namespace {
+
+const quint32 kCacheMagic = 0x56544943;   // "VTIC"
+const quint32 kCacheVersion = 1;
+const qsizetype kParallelFinalizeThreshold = 2000;
+
+// 预设节点以 CBOR 形式存入缓存，读取时无需再走一遍 JSON 文本解析
+QByteArray encodePresetNodes(const QJsonArray &nodes) {
+    return QCborValue::fromJsonValue(nodes).toCbor();
+}
+
+QJsonArray decodePresetNodes(const QByteArray &cbor) {
+    if (cbor.isEmpty()) return QJsonArray();
+    return QCborValue::fromCbor(cbor).toJsonValue().toArray();
+}
+
+// 读取缓存；只有当缓存对应当前 CSV 时才返回 true
+bool readCache(const QString &cachePath, const QString &csvPath,
+               FileFingerprint &fp, QList<ItemMapping> &out)
+{
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) return false;
+
+    uchar *p = file.map(0, file.size());
+    if (!p) return false;
+
+    // 直接在映射内存上反序列化，不复制整个缓存文件
+    const QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char *>(p), file.size());
+    QDataStream in(raw);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    FileFingerprint cached;
+    in >> magic >> version >> cached;
+    if (in.status() != QDataStream::Ok || magic != kCacheMagic || version != kCacheVersion) return false;
+
+    if (!cached.sameStat(fp)) {
+        // 修改时间变了但内容可能没变（例如仅被 touch），用内容哈希做最终判断
+        if (cached.size != fp.size) return false;
+        if (fp.hash.isEmpty()) fp.hash = FileFingerprint::hashFile(csvPath);
+        if (fp.hash != cached.hash) return false;
+    }
+
+    quint32 count = 0;
+    in >> count;
+    QList<ItemMapping> items;
+    // count 来自文件，按剩余字节数限制预分配：每条至少有 7 个长度前缀加一个 bool，共 29 字节
+    const qint64 remaining = raw.size() - in.device()->pos();
+    items.reserve(qMin<qint64>(count, remaining / 29));
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        ItemMapping m;
+        qint32 damage = 0;
+        QByteArray presetCbor;
+        in >> m.category >> m.englishId >> m.chineseName >> damage
+           >> m.presetJson >> m.presetValid >> presetCbor >> m.searchKey;
+        m.defaultDamage = damage;
+        m.presetNodes = decodePresetNodes(presetCbor);
+        items.append(m);
+    }
+    if (in.status() != QDataStream::Ok) return false;
+
+    out = items;
+    return true;
+}
+
+void writeCache(const QString &cachePath, const FileFingerprint &fp, const QList<ItemMapping> &items)
+{
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) return;   // 目录不可写时静默跳过，下次仍解析 CSV
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kCacheMagic << kCacheVersion << fp;
+    out << quint32(items.size());
+    for (const ItemMapping &m : items) {
+        out << m.category << m.englishId << m.chineseName << qint32(m.defaultDamage)
+            << m.presetJson << m.presetValid
+            << (m.presetValid ? encodePresetNodes(m.presetNodes) : QByteArray())
+            << m.searchKey;
+    }
+    if (out.status() == QDataStream::Ok) file.commit();
+    else file.cancelWriting();
+}
+
+} // namespace
+
+namespace ItemCatalog {
+
+QString displayLabel(const ItemMapping &mapping)
+{
+    return QString("[%1] %2（%3）").arg(mapping.category, mapping.chineseName, mapping.englishId);
+}
+
+void finalizeMapping(ItemMapping &mapping)
+{
+    mapping.presetValid = false;
+    mapping.presetNodes = QJsonArray();
+    if (!mapping.presetJson.isEmpty()) {
+        QJsonParseError err;
+        QJsonDocument doc = QJsonDocument::fromJson(mapping.presetJson.toUtf8(), &err);
+        if (err.error == QJsonParseError::NoError && doc.isArray()) {
+            mapping.presetValid = true;
+            mapping.presetNodes = doc.array();
+        }
+    }
+    mapping.searchKey = displayLabel(mapping).toCaseFolded();
+}
+
+// 生成默认的配置文件
+void createDefaultConfig(const QString &path)
+{
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QTextStream out(&file);
+        out.setEncoding(QStringConverter::Utf8);
+        out << "# Minecraft 村民交易物品配置文件\n";
+        out << "# 格式：分类, 英文ID, 中文名, 默认Damage值, 预设JSON(可选，必须为数组，且整体用双引号括起来，内部双引号写两次)\n";
+        out << "# 示例：武器, minecraft:diamond_sword, 钻石剑, 32767, \"[{\"\"name\"\":\"\"ench\"\",\"\"value\"\":[{\"\"name\"\":\"\"\"\",\"\"value\"\":[{\"\"name\"\":\"\"id\"\",\"\"value\"\":15,\"\"type\"\":2},{\"\"name\"\":\"\"lvl\"\",\"\"value\"\":5,\"\"type\"\":2}],\"\"type\"\":10}],\"\"type\"\":9}]\"\n";
+        out << "# 以 # 开头的行是注释，不会被读取\n\n";
+
+        out << "基础, minecraft:air, 空气, 0,\n";
+        out << "矿物, minecraft:emerald, 绿宝石, 0,\n";
+        out << "矿物, minecraft:diamond, 钻石, 0,\n";
+        out << "矿物, minecraft:iron_ingot, 铁锭, 0,\n";
+        out << "矿物, minecraft:gold_ingot, 金锭, 0,\n";
+        out << "武器, minecraft:iron_sword, 铁剑, 32767,\n";
+
+        // 为钻石剑添加预设 JSON，并进行 CSV 转义：整体加双引号，内部双引号替换为两个
+        QString rawJson = "[{\"name\":\"ench\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"id\",\"value\":15,\"type\":2},{\"name\":\"lvl\",\"value\":5,\"type\":2}],\"type\":10}],\"type\":9}]";
+        QString escapedJson = rawJson;
+        escapedJson.replace("\"", "\"\""); // 将每个双引号替换为两个双引号
+        out << "武器, minecraft:diamond_sword, 钻石剑, 32767, \"" << escapedJson << "\"\n";
+
+        out << "食物, minecraft:bread, 面包, 0,\n";
+        out << "食物, minecraft:apple, 苹果, 0,\n";
+        out << "方块, minecraft:chest, 箱子, 0,\n";
+        file.close();
+    }
+}
+
+QString cachePathFor(const QString &csvPath)
+{
+    QFileInfo info(csvPath);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".cache";
+}
+
+QList<ItemMapping> parseCatalogCsv(const QString &csvPath)
+{
+    QList<ItemMapping> items;
+    QFile file(csvPath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) return items;
+
+    // 直接在映射的 UTF-8 原始字节上分词，不先整体解码成 QString
+    QByteArray buffer;
+    QByteArrayView data;
+    if (uchar *p = file.map(0, file.size())) {
+        data = QByteArrayView(reinterpret_cast<const char *>(p), file.size());
+    } else {
+        buffer = file.readAll();
+        data = buffer;
+    }
+
+    const QList<QStringList> rows = CsvTokenizer::tokenize(data);
+    items.reserve(rows.size());
+    for (const QStringList &parts : rows) {
+        if (parts.size() < 4) continue;
+        ItemMapping mapping;
+        mapping.category = parts[0].trimmed();
+        mapping.englishId = parts[1].trimmed();
+        mapping.chineseName = parts[2].trimmed();
+        mapping.defaultDamage = parts[3].trimmed().toInt();
+        // 第五列（预设 JSON）：分词器已经去除了外层引号，并处理了双引号转义（两个双引号->一个）
+        if (parts.size() >= 5) mapping.presetJson = parts[4].trimmed();
+        items.append(mapping);
+    }
+    file.close();
+
+    // 预设 JSON 的校验解析是主要开销，大物品库并行处理
+    if (items.size() >= kParallelFinalizeThreshold) {
+        QtConcurrent::blockingMap(items, [](ItemMapping &m) { finalizeMapping(m); });
+    } else {
+        for (ItemMapping &m : items) finalizeMapping(m);
+    }
+    return items;
+}
+
+QList<ItemMapping> loadCatalog(const QString &csvPath)
+{
+    VTE_TRACE("ItemCatalog::loadCatalog");
+    FileFingerprint fp = FileFingerprint::fromStat(csvPath);
+    if (!fp.isValid()) return QList<ItemMapping>();
+
+    const QString cachePath = cachePathFor(csvPath);
+    QList<ItemMapping> items;
+    if (readCache(cachePath, csvPath, fp, items)) {
+        // 内容相同但时间戳变化时刷新缓存头，下次启动走最快路径
+        if (!fp.hash.isEmpty()) writeCache(cachePath, fp, items);
+        return items;
+    }
+
+    items = parseCatalogCsv(csvPath);
+    if (fp.hash.isEmpty()) fp.hash = FileFingerprint::hashFile(csvPath);
+    writeCache(cachePath, fp, items);
+    return items;
+}
+
+} // namespace ItemCatalog
@@ -0,0 +1,43 @@
+#ifndef ITEMCATALOG_H
+#define ITEMCATALOG_H
+
+#include <QString>
+#include <QList>
+#include <QJsonArray>
+
+struct ItemMapping {
+    QString englishId;
+    QString chineseName;
+    int defaultDamage;
+    QString category;  // <== 新增分类字段
+    QString presetJson;  // 新增
+
+    // 以下字段由 finalizeMapping 预先计算，并随编译缓存一起保存
+    bool presetValid = false;   // presetJson 非空且是合法的 JSON 数组
+    QJsonArray presetNodes;     // 预先解析好的预设节点
+    QString searchKey;          // 选择器搜索用的键（已做大小写折叠）
+};
+
+// ==================== 物品库加载 ====================
+// items_config.csv 旁会生成同名的 .cache 编译缓存（字段已拆分、预设 JSON 已校验解析、搜索键已生成），
+// 以 CSV 的大小、修改时间和内容哈希为键，启动时内存映射读取，只有 CSV 变化时才重新解析。
+namespace ItemCatalog {
+
+// 选择器中显示的文本：[矿物] 绿宝石（minecraft:emerald）
+QString displayLabel(const ItemMapping &mapping);
+// 计算 presetValid / presetNodes / searchKey
+void finalizeMapping(ItemMapping &mapping);
+
+// 生成带示例条目的默认配置文件
+void createDefaultConfig(const QString &path);
+
+// 直接解析 CSV（不读写缓存）
+QList<ItemMapping> parseCatalogCsv(const QString &csvPath);
+// 优先读取编译缓存，缓存失效时解析 CSV 并重建缓存
+QList<ItemMapping> loadCatalog(const QString &csvPath);
+
+QString cachePathFor(const QString &csvPath);
+
+} // namespace ItemCatalog
+
+#endif // ITEMCATALOG_H
@@ -0,0 +1,38 @@
+#include "itemidresolver.h"
+
+QString ItemIdResolver::foldKey(const QString &text)
+{
+    return text.trimmed().toCaseFolded();
+}
+
+void ItemIdResolver::build(const QList<ItemMapping> &items)
+{
+    m_aliases.clear();
+    m_ids.clear();
+    m_aliases.reserve(items.size() * 4);
+    m_ids.reserve(items.size());
+
+    // 规范 ID 优先登记，避免被其他物品的中文名等别名抢占
+    for (const ItemMapping &m : items) {
+        if (m.englishId.isEmpty()) continue;
+        m_ids.insert(m.englishId);
+        m_aliases.insert(foldKey(m.englishId), m.englishId);
+    }
+
+    for (const ItemMapping &m : items) {
+        if (m.englishId.isEmpty()) continue;
+        // 同一别名对应多个物品时保留先出现的一个
+        auto addAlias = [&](const QString &alias) {
+            const QString key = foldKey(alias);
+            if (!key.isEmpty() && !m_aliases.contains(key)) m_aliases.insert(key, m.englishId);
+        };
+        addAlias(m.chineseName);
+        addAlias(QString("%1（%2）").arg(m.chineseName, m.englishId));   // 补全列表中的组合写法
+        if (m.englishId.startsWith("minecraft:")) addAlias(m.englishId.mid(10));
+    }
+}
+
+QString ItemIdResolver::resolve(const QString &text) const
+{
+    return m_aliases.value(foldKey(text));
+}
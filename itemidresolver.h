@@ -0,0 +1,29 @@
+#ifndef ITEMIDRESOLVER_H
+#define ITEMIDRESOLVER_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include "itemcatalog.h"
+
+// ==================== 物品 ID 解析 ====================
+// 把输入框里可能出现的各种写法（中文名、英文 ID、不带 minecraft: 的 ID、补全列表里的“中文名（ID）”）
+// 统一映射到物品库中的规范英文 ID。所有查询都是一次哈希查找。
+class ItemIdResolver
+{
+public:
+    void build(const QList<ItemMapping> &items);
+
+    // 返回规范 ID；无法识别时返回空字符串
+    QString resolve(const QString &text) const;
+    bool isKnownId(const QString &id) const { return m_ids.contains(id); }
+    bool isEmpty() const { return m_ids.isEmpty(); }
+
+private:
+    static QString foldKey(const QString &text);
+
+    QHash<QString, QString> m_aliases;   // 大小写折叠后的别名 -> 规范 ID
+    QSet<QString> m_ids;
+};
+
+#endif // ITEMIDRESOLVER_H
@@ -0,0 +1,200 @@
+#include "jsonescape.h"
+#include <QtAlgorithms>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define VTE_JSON_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+namespace {
+
+enum ScanMask {
+    kQuote = 1,       // "
+    kBackslash = 2,   // 反斜杠
+    kControl = 4,     // U+0000 ~ U+001F
+};
+
+inline bool isSpecial(char16_t c, int mask)
+{
+    return ((mask & kQuote) && c == u'"')
+        || ((mask & kBackslash) && c == u'\\')
+        || ((mask & kControl) && c < 0x20);
+}
+
+// 返回 [p, end) 中第一个属于 mask 所选字符类的位置，找不到返回 end。
+// SSE2 下每次比较 8 个 UTF-16 码元，剩余部分逐个检查。
+const char16_t *scan(const char16_t *p, const char16_t *end, int mask)
+{
+#ifdef VTE_JSON_SSE2
+    const __m128i quote = _mm_set1_epi16(u'"');
+    const __m128i backslash = _mm_set1_epi16(u'\\');
+    const __m128i controlMax = _mm_set1_epi16(0x1F);
+    const __m128i zero = _mm_setzero_si128();
+    while (end - p >= 8) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i hit = zero;
+        if (mask & kQuote) hit = _mm_or_si128(hit, _mm_cmpeq_epi16(chunk, quote));
+        if (mask & kBackslash) hit = _mm_or_si128(hit, _mm_cmpeq_epi16(chunk, backslash));
+        // 无符号饱和减法：c <= 0x1F 时结果为 0
+        if (mask & kControl) hit = _mm_or_si128(hit, _mm_cmpeq_epi16(_mm_subs_epu16(chunk, controlMax), zero));
+        const int bits = _mm_movemask_epi8(hit);
+        if (bits) return p + qCountTrailingZeroBits(quint32(bits)) / 2;
+        p += 8;
+    }
+#endif
+    for (; p < end; ++p) {
+        if (isSpecial(*p, mask)) return p;
+    }
+    return end;
+}
+
+inline char16_t *copySpan(char16_t *dst, const char16_t *from, const char16_t *to)
+{
+    const qsizetype n = to - from;
+    if (n > 0) {
+        std::copy(from, to, dst);
+        dst += n;
+    }
+    return dst;
+}
+
+const char16_t kHex[] = u"0123456789abcdef";
+
+// 控制字符在字符串内的转义长度：\n \t \r 为 2，其余写成 \u00XX 为 6
+inline qsizetype escapeLength(char16_t c)
+{
+    return (c == u'\n' || c == u'\t' || c == u'\r') ? 2 : 6;
+}
+
+inline char16_t *writeEscape(char16_t *dst, char16_t c)
+{
+    *dst++ = u'\\';
+    switch (c) {
+    case u'\n': *dst++ = u'n'; break;
+    case u'\t': *dst++ = u't'; break;
+    case u'\r': *dst++ = u'r'; break;
+    default:
+        *dst++ = u'u';
+        *dst++ = u'0';
+        *dst++ = u'0';
+        *dst++ = kHex[(c >> 4) & 0xF];
+        *dst++ = kHex[c & 0xF];
+        break;
+    }
+    return dst;
+}
+
+} // namespace
+
+QString unescapeForDisplay(const QString &jsonText)
+{
+    const char16_t *begin = reinterpret_cast<const char16_t *>(jsonText.constData());
+    const char16_t *end = begin + jsonText.size();
+
+    // 快速路径：没有任何反斜杠就不会有需要转换的转义
+    if (scan(begin, end, kBackslash) == end) return jsonText;
+
+    // 转换只会让文本变短，按输入长度一次分配
+    QString result(jsonText.size(), Qt::Uninitialized);
+    char16_t *out = reinterpret_cast<char16_t *>(result.data());
+    char16_t *const outBegin = out;
+
+    bool inString = false;
+    const char16_t *p = begin;
+    while (p < end) {
+        const char16_t *q = scan(p, end, kQuote | kBackslash);
+        out = copySpan(out, p, q);
+        if (q == end) break;
+
+        if (*q == u'"') {
+            inString = !inString;
+            *out++ = u'"';
+            p = q + 1;
+            continue;
+        }
+
+        // 反斜杠：只在字符串内、且是 \n \t \r 时转换；其余转义（包括 \\）连同下一个字符原样保留
+        if (!inString || q + 1 == end) {
+            *out++ = u'\\';
+            p = q + 1;
+            continue;
+        }
+        switch (q[1]) {
+        case u'n': *out++ = u'\n'; break;
+        case u't': *out++ = u'\t'; break;
+        case u'r': *out++ = u'\r'; break;
+        default:
+            *out++ = u'\\';
+            *out++ = q[1];
+            break;
+        }
+        p = q + 2;
+    }
+
+    result.truncate(out - outBegin);
+    return result;
+}
+
+QString escapeForJson(const QString &displayText)
+{
+    const char16_t *begin = reinterpret_cast<const char16_t *>(displayText.constData());
+    const char16_t *end = begin + displayText.size();
+
+    // 快速路径：没有控制字符就没有需要转义的内容
+    if (scan(begin, end, kControl) == end) return displayText;
+
+    // 第一趟只计算输出长度，保证只分配一次
+    qsizetype extra = 0;
+    {
+        bool inString = false;
+        const char16_t *p = begin;
+        while (p < end) {
+            const char16_t *q = scan(p, end, kQuote | kBackslash | kControl);
+            if (q == end) break;
+            if (*q == u'"') {
+                inString = !inString;
+                p = q + 1;
+            } else if (*q == u'\\') {
+                p = (inString && q + 1 < end) ? q + 2 : q + 1;
+            } else {
+                if (inString) extra += escapeLength(*q) - 1;
+                p = q + 1;
+            }
+        }
+    }
+    if (extra == 0) return displayText;   // 控制字符都在字符串外（缩进换行）
+
+    QString result(displayText.size() + extra, Qt::Uninitialized);
+    char16_t *out = reinterpret_cast<char16_t *>(result.data());
+
+    bool inString = false;
+    const char16_t *p = begin;
+    while (p < end) {
+        const char16_t *q = scan(p, end, kQuote | kBackslash | kControl);
+        out = copySpan(out, p, q);
+        if (q == end) break;
+
+        if (*q == u'"') {
+            inString = !inString;
+            *out++ = u'"';
+            p = q + 1;
+        } else if (*q == u'\\') {
+            // 已有的转义（\\ \" \n 等）连同下一个字符原样保留
+            *out++ = u'\\';
+            if (inString && q + 1 < end) {
+                *out++ = q[1];
+                p = q + 2;
+            } else {
+                p = q + 1;
+            }
+        } else if (inString) {
+            out = writeEscape(out, *q);
+            p = q + 1;
+        } else {
+            *out++ = *q;   // 字符串外的换行、缩进保持原样
+            p = q + 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,15 @@
+#ifndef JSONESCAPE_H
+#define JSONESCAPE_H
+
+#include <QString>
+
+// ==================== JSON 文本与显示文本互转 ====================
+// 两个函数都只处理 JSON 字符串字面量内部的内容，字面量之外（缩进、换行）原样保留：
+//   unescapeForDisplay：把字符串内的 \n \t \r 转成真实字符，其余转义（\\ \" \uXXXX 等）原样保留，
+//                       因此字符串里的字面 \\n 不会被误转；
+//   escapeForJson：把字符串内的真实控制字符转回转义序列，已有的反斜杠转义原样保留。
+// 单趟线性扫描，输出只分配一次；不含需要转换的字符时直接返回输入（不复制）。
+QString unescapeForDisplay(const QString &jsonText);
+QString escapeForJson(const QString &displayText);
+
+#endif // JSONESCAPE_H
@@ -0,0 +1,215 @@
+#include "layeredcatalog.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QTextStream>
+#include <QCryptographicHash>
+#include <QtConcurrent/QtConcurrentMap>
+
+QString LayeredCatalog::declarationPath()
+{
+    return QCoreApplication::applicationDirPath() + "/items_catalogs.txt";
+}
+
+QStringList LayeredCatalog::declaredLayers()
+{
+    const QDir baseDir(QCoreApplication::applicationDirPath());
+    QStringList paths;
+
+    QFile file(declarationPath());
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&file);
+        in.setEncoding(QStringConverter::Utf8);
+        while (!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            if (line.isEmpty() || line.startsWith('#')) continue;
+            paths.append(QDir::cleanPath(baseDir.absoluteFilePath(line)));
+        }
+    }
+
+    if (paths.isEmpty()) {
+        paths.append(baseDir.absoluteFilePath("items_config.csv"));
+    }
+    return paths;
+}
+
+bool LayeredCatalog::refresh(const QStringList &layerPaths)
+{
+    // 1. 层列表本身变化：保留路径相同的已加载层，其他层重新加载，之后全量合并
+    QStringList currentPaths;
+    for (const Layer &layer : m_layers) currentPaths.append(layer.path);
+    const bool structureChanged = (currentPaths != layerPaths);
+    if (structureChanged) {
+        QList<Layer> layers;
+        for (const QString &path : layerPaths) {
+            const int old = currentPaths.indexOf(path);
+            Layer layer = (old >= 0) ? m_layers[old] : Layer();
+            layer.path = path;
+            layers.append(layer);
+        }
+        m_layers = layers;
+    }
+
+    // 2. 找出文件有变化的层（大小或修改时间不同；内容哈希由 ItemCatalog 的编译缓存负责）
+    QList<int> changed;
+    QList<FileFingerprint> stats;
+    for (int i = 0; i < m_layers.size(); ++i) {
+        FileFingerprint fp = FileFingerprint::fromStat(m_layers[i].path);
+        if (!m_layers[i].stat.sameStat(fp)) {
+            changed.append(i);
+            stats.append(fp);
+        }
+    }
+    if (changed.isEmpty() && !structureChanged) return false;
+
+    // 3. 并行加载变化的层
+    QStringList changedPaths;
+    for (int i : changed) changedPaths.append(m_layers[i].path);
+    QFuture<QList<ItemMapping>> future = QtConcurrent::mapped(changedPaths, ItemCatalog::loadCatalog);
+    future.waitForFinished();
+    const QList<QList<ItemMapping>> loaded = future.results();
+
+    QSet<QString> affected;
+    for (int k = 0; k < changed.size(); ++k) {
+        Layer &layer = m_layers[changed[k]];
+        for (auto it = layer.index.cbegin(); it != layer.index.cend(); ++it) affected.insert(it.key());
+        layer.stat = stats[k];
+        layer.items = loaded.value(k);
+        buildIndex(layer);
+        for (auto it = layer.index.cbegin(); it != layer.index.cend(); ++it) affected.insert(it.key());
+    }
+
+    // 4. 合并：层结构变化时全量合并 O(总行数)，否则只重算变化层涉及的 id
+    if (structureChanged || m_merged.isEmpty()) {
+        fullMerge();
+    } else {
+        remergeIds(affected);
+    }
+    return true;
+}
+
+QByteArray LayeredCatalog::version() const
+{
+    QCryptographicHash hasher(QCryptographicHash::Sha1);
+    for (const Layer &layer : m_layers) {
+        hasher.addData(layer.path.toUtf8());
+        hasher.addData(QByteArray::number(layer.stat.size));
+        hasher.addData(QByteArray::number(layer.stat.mtime));
+    }
+    return hasher.result().toHex();
+}
+
+void LayeredCatalog::buildIndex(Layer &layer)
+{
+    layer.index.clear();
+    layer.index.reserve(layer.items.size());
+    for (int i = 0; i < layer.items.size(); ++i) {
+        if (!layer.items[i].englishId.isEmpty()) layer.index.insert(layer.items[i].englishId, i);
+    }
+}
+
+void LayeredCatalog::applyOverride(ItemMapping &dst, const ItemMapping &src)
+{
+    if (!src.chineseName.isEmpty()) dst.chineseName = src.chineseName;
+    if (!src.category.isEmpty()) dst.category = src.category;
+    dst.defaultDamage = src.defaultDamage;
+    if (!src.presetJson.isEmpty()) {
+        // 预设的校验与解析结果随 presetJson 一起取用，不再重复解析
+        dst.presetJson = src.presetJson;
+        dst.presetValid = src.presetValid;
+        dst.presetNodes = src.presetNodes;
+    }
+}
+
+void LayeredCatalog::fullMerge()
+{
+    m_merged.clear();
+    m_mergedIndex.clear();
+
+    qsizetype total = 0;
+    for (const Layer &layer : m_layers) total += layer.items.size();
+    m_merged.reserve(total);
+    m_mergedIndex.reserve(total);
+
+    QList<bool> overridden;
+    overridden.reserve(total);
+    for (const Layer &layer : m_layers) {
+        for (int i = 0; i < layer.items.size(); ++i) {
+            const ItemMapping &row = layer.items[i];
+            // 同一层中重复的 id 只取最后一行，与增量合并（resolve 按 index 取行）一致
+            if (row.englishId.isEmpty() || layer.index.value(row.englishId) != i) continue;
+            auto it = m_mergedIndex.constFind(row.englishId);
+            if (it == m_mergedIndex.cend()) {
+                m_mergedIndex.insert(row.englishId, m_merged.size());
+                m_merged.append(row);
+                overridden.append(false);
+            } else {
+                applyOverride(m_merged[*it], row);
+                overridden[*it] = true;
+            }
+        }
+    }
+
+    // 只有被覆盖过的条目需要重新生成搜索键
+    for (int i = 0; i < m_merged.size(); ++i) {
+        if (overridden[i]) m_merged[i].searchKey = ItemCatalog::displayLabel(m_merged[i]).toCaseFolded();
+    }
+}
+
+void LayeredCatalog::remergeIds(const QSet<QString> &ids)
+{
+    // 新增的 id 在全量合并中按层序与行序排在中间，追加到末尾会得到不同的顺序；
+    // 编辑通常只改已有条目，有新增时直接全量合并
+    for (const QString &id : ids) {
+        if (m_mergedIndex.contains(id)) continue;
+        for (const Layer &layer : std::as_const(m_layers)) {
+            if (layer.index.contains(id)) {
+                fullMerge();
+                return;
+            }
+        }
+    }
+
+    bool removed = false;
+    for (const QString &id : ids) {
+        ItemMapping mapping;
+        const bool exists = resolve(id, mapping);
+        auto it = m_mergedIndex.constFind(id);
+        if (exists) {
+            if (it != m_mergedIndex.cend()) {
+                m_merged[*it] = mapping;
+            } else {
+                m_mergedIndex.insert(id, m_merged.size());
+                m_merged.append(mapping);
+            }
+        } else if (it != m_mergedIndex.cend()) {
+            m_merged[*it].englishId.clear();   // 标记删除，稍后统一压缩
+            removed = true;
+        }
+    }
+
+    if (removed) {
+        m_merged.removeIf([](const ItemMapping &m) { return m.englishId.isEmpty(); });
+        m_mergedIndex.clear();
+        for (int i = 0; i < m_merged.size(); ++i) m_mergedIndex.insert(m_merged[i].englishId, i);
+    }
+}
+
+bool LayeredCatalog::resolve(const QString &id, ItemMapping &out) const
+{
+    bool found = false;
+    for (const Layer &layer : m_layers) {
+        auto it = layer.index.constFind(id);
+        if (it == layer.index.cend()) continue;
+        const ItemMapping &row = layer.items[*it];
+        if (!found) {
+            out = row;
+            found = true;
+        } else {
+            applyOverride(out, row);
+        }
+    }
+    if (found) out.searchKey = ItemCatalog::displayLabel(out).toCaseFolded();
+    return found;
+}
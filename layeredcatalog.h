@@ -0,0 +1,49 @@
+#ifndef LAYEREDCATALOG_H
+#define LAYEREDCATALOG_H
+
+#include <QHash>
+#include <QStringList>
+#include "itemcatalog.h"
+#include "filefingerprint.h"
+
+// ==================== 分层物品库 ====================
+// 多个物品库文件按声明顺序叠加（例如：原版 -> 若干附加包 -> 地图专用覆盖），按 englishId 合并：
+// 后面的层覆盖前面层的 chineseName / defaultDamage / category / presetJson（空字段不覆盖，Damage 总是覆盖）。
+// 同一层中重复的 englishId 只取最后一行（全量合并与增量合并规则相同）。
+// 声明文件为程序目录下的 items_catalogs.txt，每行一个路径；不存在时只使用 items_config.csv。
+class LayeredCatalog
+{
+public:
+    static QString declarationPath();
+    // 读取声明文件，返回按顺序排列的绝对路径
+    static QStringList declaredLayers();
+
+    // 检查各层文件，只并行重新加载发生变化的层并增量合并；返回合并结果是否可能变化
+    bool refresh(const QStringList &layerPaths);
+
+    const QList<ItemMapping> &items() const { return m_merged; }
+    // 各层路径、大小与修改时间的组合（与 refresh 判断变化的依据相同，不读取文件内容）：
+    // 层列表或任何一层的大小、修改时间变化都会改变；只被 touch 过的层同样会改变
+    QByteArray version() const;
+
+private:
+    struct Layer {
+        QString path;
+        FileFingerprint stat;
+        QList<ItemMapping> items;
+        QHash<QString, int> index;   // englishId -> items 下标（同层重复时取最后一个）
+    };
+
+    static void buildIndex(Layer &layer);
+    static void applyOverride(ItemMapping &dst, const ItemMapping &src);
+
+    void fullMerge();
+    void remergeIds(const QSet<QString> &ids);
+    bool resolve(const QString &id, ItemMapping &out) const;
+
+    QList<Layer> m_layers;
+    QList<ItemMapping> m_merged;
+    QHash<QString, int> m_mergedIndex;   // englishId -> m_merged 下标
+};
+
+#endif // LAYEREDCATALOG_H
@@ -1,16 +1,89 @@
-#include "villagereditor.h"
-#include <QApplication>
-#include <QIcon>   // 可能需要包含
-
-int main(int argc, char *argv[])
-{
-    QApplication a(argc, argv);
-
-    // 设置应用程序图标（将影响所有未单独设置图标的窗口）
-    a.setWindowIcon(QIcon(":/icons/app.ico"));   // 如果使用资源文件（见步骤3）
-    // 或者使用相对路径（不推荐，但可以临时测试）：a.setWindowIcon(QIcon("resources/app.ico"));
-
-    VillagerEditor w;
-    w.show();
-    return a.exec();
-}
+#include "commandline.h"
+#include "documenttabs.h"
+#include "guibenchmark.h"
+#include "singleinstance.h"
+#include "startuptiming.h"
+#include "tracer.h"
+#include <QApplication>
+#include <QDebug>
+#include <QIcon>   // 可能需要包含
+#include <QLockFile>
+#include <QTimer>
+#include <memory>
+
+static const int kStartupLockTimeoutMs = 10000;
+
+// 设置了 VTE_TRACE=<文件> 时从启动起就开启追踪，退出时写出 trace
+static int finishTrace(int code)
+{
+    const QString path = qEnvironmentVariable("VTE_TRACE");
+    if (!path.isEmpty()) {
+        QString error;
+        if (!Tracer::writeChromeTrace(path, &error)) qWarning().noquote() << "[追踪] 写入失败：" << error;
+    }
+    return code;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsEmpty("VTE_TRACE")) Tracer::setEnabled(true);
+
+    // 命令行模式（批量导出等）不需要窗口
+    if (CommandLine::isRequested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        return finishTrace(CommandLine::run(app));
+    }
+    // 界面延迟基准测试：使用真实窗口，但不进入正常的交互流程
+    if (GuiBenchmark::isRequested(argc, argv)) {
+        QApplication app(argc, argv);
+        return finishTrace(GuiBenchmark::run(app));
+    }
+
+    // 已有实例在运行时把文件交给它打开，不再初始化界面与物品库。
+    // 从探测到开始监听一直持有启动锁：从文件管理器同时打开多个文件时，只有第一个进程成为实例
+    const bool singleInstance = SingleInstance::isRequested(argc, argv);
+    std::unique_ptr<QLockFile> startupLock;
+    if (singleInstance) {
+        QCoreApplication probe(argc, argv);
+        startupLock = std::make_unique<QLockFile>(SingleInstance::lockFilePath());
+        if (!startupLock->tryLock(kStartupLockTimeoutMs)) {
+            qWarning().noquote() << "[单实例] 等待启动锁超时，继续启动";
+        }
+        if (SingleInstance::forward(SingleInstance::filesFromArguments(probe.arguments()))) return 0;
+    }
+
+    StartupTiming::start();
+    QApplication a(argc, argv);
+    StartupTiming::mark("QApplication 初始化");
+
+    // 设置应用程序图标（将影响所有未单独设置图标的窗口）
+    a.setWindowIcon(QIcon(":/icons/app.ico"));   // 如果使用资源文件（见步骤3）
+    // 或者使用相对路径（不推荐，但可以临时测试）：a.setWindowIcon(QIcon("resources/app.ico"));
+
+    // 先开始监听再构建界面，之后启动的进程立即就能连上；请求在事件循环开始后处理
+    SingleInstance instance;
+    const bool listening = singleInstance && instance.listen();
+    startupLock.reset();
+
+    // 每个文件一个标签页，共用物品库
+    DocumentTabs w;
+    const QStringList files = SingleInstance::filesFromArguments(a.arguments());
+    if (files.isEmpty()) w.newDocument();
+    for (const QString &path : files) w.openDocument(path);
+    StartupTiming::mark("主窗口构建(initUI)");
+    w.show();
+    StartupTiming::mark("show()");
+
+    if (listening) {
+        QObject::connect(&instance, &SingleInstance::openRequested, &w, [&w](const QStringList &files) {
+            if (files.isEmpty()) w.newDocument();
+            for (const QString &path : files) w.openDocument(path);
+            w.raise();
+            w.activateWindow();
+        });
+    }
+
+    // 事件循环处理完第一批事件（窗口已显示）后记录
+    QTimer::singleShot(0, &w, []() { StartupTiming::mark("窗口出现"); });
+    return finishTrace(a.exec());
+}
@@ -0,0 +1,268 @@
+#include "memtrace.h"
+#include <QJsonArray>
+#include <QJsonValue>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#ifdef VTE_MEMTRACE
+#include <malloc.h>
+#endif
+
+namespace {
+
+const char *const kStageNames[] = { "other", "parse", "build", "serialize", "tableRefresh", "catalogLoad" };
+
+// 分配函数里不能再分配内存：计数全部是静态初始化的原子量
+struct Counters {
+    std::atomic<qint64> allocations { 0 };
+    std::atomic<qint64> bytes { 0 };
+    std::atomic<qint64> freed { 0 };
+    std::atomic<qint64> peak { 0 };
+};
+
+Counters g_counters[MemTrace::StageCount];
+std::atomic<qint64> g_live { 0 };
+thread_local int t_stage = MemTrace::Other;
+
+void raisePeak(Counters &c, qint64 live)
+{
+    qint64 peak = c.peak.load(std::memory_order_relaxed);
+    while (live > peak && !c.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+[[maybe_unused]] void noteAlloc(qint64 size)
+{
+    Counters &c = g_counters[t_stage];
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(size, std::memory_order_relaxed);
+    raisePeak(c, g_live.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+[[maybe_unused]] void noteFree(qint64 size)
+{
+    g_counters[t_stage].freed.fetch_add(size, std::memory_order_relaxed);
+    g_live.fetch_sub(size, std::memory_order_relaxed);
+}
+
+#ifdef VTE_MEMTRACE
+// 按分配器实际给出的块大小计数，分配与释放两边一致，不需要在块前附加头部
+qint64 blockSize(void *p)
+{
+    return qint64(malloc_usable_size(p));
+}
+#endif
+
+// QJsonValue 内部（QCborContainerPrivate）的近似大小：每个元素 16 字节，字符串另算
+qint64 jsonBytes(const QJsonValue &v)
+{
+    if (v.isString()) return 16 + v.toString().size() * 2;
+    if (v.isArray()) {
+        const QJsonArray arr = v.toArray();
+        qint64 bytes = 64 + arr.size() * 16;
+        for (const QJsonValue &e : arr) bytes += jsonBytes(e);
+        return bytes;
+    }
+    if (v.isObject()) {
+        const QJsonObject obj = v.toObject();
+        qint64 bytes = 64 + obj.size() * 32;
+        for (auto it = obj.begin(); it != obj.end(); ++it) bytes += it.key().size() * 2 + jsonBytes(it.value());
+        return bytes;
+    }
+    return 0;
+}
+
+qint64 stringBytes(const QString &s)
+{
+    return s.capacity() > 0 ? 16 + (s.capacity() + 1) * 2 : 0;   // 字面量不占堆
+}
+
+qint64 itemBytes(const ItemData &d)
+{
+    qint64 bytes = stringBytes(d.name) + stringBytes(d.displayName) + stringBytes(d.lore);
+    if (!d.customNodes.isEmpty()) bytes += jsonBytes(d.customNodes);
+    if (!d.pendingNodes.isEmpty()) bytes += jsonBytes(d.pendingNodes);   // 与原始文档共享，但同样常驻
+    return bytes;
+}
+
+} // namespace
+
+#ifdef VTE_MEMTRACE
+#if !defined(__GLIBC__)
+#error "VTE_MEMTRACE 只支持 glibc（见 VillagerTradeEditor.pro）"
+#endif
+// glibc：接管 C 分配函数，Qt 容器（QArrayData）与 operator new 都经过这里。
+// 对齐分配也要接管，否则 free 会减去从未计入的块
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void *__libc_valloc(size_t size);
+void *__libc_pvalloc(size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    void *p = __libc_malloc(size);
+    if (p) noteAlloc(blockSize(p));
+    return p;
+}
+
+void *calloc(size_t count, size_t size)
+{
+    void *p = __libc_calloc(count, size);
+    if (p) noteAlloc(blockSize(p));
+    return p;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    const qint64 old = ptr ? blockSize(ptr) : 0;
+    void *p = __libc_realloc(ptr, size);
+    if (p || size == 0) {
+        if (old) noteFree(old);
+        if (p) noteAlloc(blockSize(p));
+    }
+    return p;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *p = __libc_memalign(alignment, size);
+    if (p) noteAlloc(blockSize(p));
+    return p;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    if (alignment == 0 || alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    void *p = memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void *valloc(size_t size)
+{
+    void *p = __libc_valloc(size);
+    if (p) noteAlloc(blockSize(p));
+    return p;
+}
+
+void *pvalloc(size_t size)
+{
+    void *p = __libc_pvalloc(size);
+    if (p) noteAlloc(blockSize(p));
+    return p;
+}
+
+void free(void *ptr)
+{
+    if (ptr) noteFree(blockSize(ptr));
+    __libc_free(ptr);
+}
+} // extern "C"
+#endif // VTE_MEMTRACE
+
+namespace MemTrace {
+
+bool isAvailable()
+{
+#ifdef VTE_MEMTRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+QString hookName()
+{
+#if !defined(VTE_MEMTRACE)
+    return "disabled";
+#else
+    return "malloc";
+#endif
+}
+
+QList<StageStats> snapshot()
+{
+    QList<StageStats> stats;
+    for (int s = 0; s < StageCount; ++s) {
+        const Counters &c = g_counters[s];
+        StageStats st;
+        st.name = QString::fromLatin1(kStageNames[s]);
+        st.allocations = c.allocations.load(std::memory_order_relaxed);
+        st.bytes = c.bytes.load(std::memory_order_relaxed);
+        st.netBytes = st.bytes - c.freed.load(std::memory_order_relaxed);
+        st.peakBytes = c.peak.load(std::memory_order_relaxed);
+        stats.append(st);
+    }
+    return stats;
+}
+
+qint64 liveBytes()
+{
+    // 动态链接器启动时用自己的分配器分配、之后交给 free 的块会多减一些，不让它显示为负数
+    return qMax<qint64>(0, g_live.load(std::memory_order_relaxed));
+}
+
+void reset()
+{
+    const qint64 live = liveBytes();
+    for (Counters &c : g_counters) {
+        c.allocations.store(0, std::memory_order_relaxed);
+        c.bytes.store(0, std::memory_order_relaxed);
+        c.freed.store(0, std::memory_order_relaxed);
+        c.peak.store(live, std::memory_order_relaxed);
+    }
+}
+
+qint64 residentBytes(const TradeOption &trade)
+{
+    return sizeof(TradeOption) + itemBytes(trade.buyA) + itemBytes(trade.buyB) + itemBytes(trade.sell);
+}
+
+QJsonObject toJson(const QJsonObject &extra)
+{
+    QJsonObject build;
+    build["hook"] = hookName();
+    build["qt"] = QString::fromLatin1(qVersion());
+    build["sizeofTradeOption"] = qint64(sizeof(TradeOption));
+    build["sizeofItemData"] = qint64(sizeof(ItemData));
+
+    QJsonArray stages;
+    for (const StageStats &st : snapshot()) {
+        QJsonObject obj;
+        obj["stage"] = st.name;
+        obj["allocations"] = st.allocations;
+        obj["bytes"] = st.bytes;
+        obj["netBytes"] = st.netBytes;
+        obj["peakBytes"] = st.peakBytes;
+        stages.append(obj);
+    }
+
+    QJsonObject result = extra;
+    result["build"] = build;
+    result["liveBytes"] = liveBytes();
+    result["stages"] = stages;
+    return result;
+}
+
+Scope::Scope(Stage stage)
+    : m_previous(t_stage)
+{
+    t_stage = stage;
+    raisePeak(g_counters[stage], g_live.load(std::memory_order_relaxed));
+}
+
+Scope::~Scope()
+{
+    t_stage = m_previous;
+}
+
+} // namespace MemTrace
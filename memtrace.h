@@ -0,0 +1,64 @@
+#ifndef MEMTRACE_H
+#define MEMTRACE_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include "tradedata.h"
+
+// ==================== 内存分配统计（可选构建） ====================
+// qmake CONFIG+=memtrace 时定义 VTE_MEMTRACE，替换进程的分配函数并按流水线阶段统计：
+// 分配次数、分配字节数、阶段内净增字节数，以及阶段执行期间达到的堆峰值。
+// 阶段由 VTE_MEM_SCOPE(MemTrace::Parse) 在作用域内标记（按线程，内层优先），
+// 未标记的分配计入 Other。普通构建中宏展开为空，没有任何开销。
+//
+// 直接接管 glibc 的 malloc / calloc / realloc / free 与各对齐分配函数，Qt 库内部的分配
+// （QArrayData、QJsonObject、QString 的缓冲区）与 operator new 都经过这里。因此只支持 Linux 构建；
+// 其他平台（例如 Windows 上 Qt6Core.dll 使用自己的 C 运行库堆）在 .pro 中不定义 VTE_MEMTRACE。
+namespace MemTrace {
+
+enum Stage { Other, Parse, Build, Serialize, TableRefresh, CatalogLoad, StageCount };
+
+struct StageStats {
+    QString name;
+    qint64 allocations = 0;
+    qint64 bytes = 0;       // 累计分配
+    qint64 netBytes = 0;    // 阶段内分配减去阶段内释放
+    qint64 peakBytes = 0;   // 阶段执行期间进程堆的最大值
+};
+
+bool isAvailable();          // 本构建是否启用了统计
+QString hookName();          // "malloc" 或 "disabled"
+QList<StageStats> snapshot();
+qint64 liveBytes();
+void reset();                // 清零计数（当前堆大小保留）
+
+// 一条交易常驻内存的近似值：结构本身、字符串缓冲区与自定义节点
+qint64 residentBytes(const TradeOption &trade);
+
+// 所有阶段的统计与 extra 合并成一个 JSON 对象，便于在不同构建之间比较
+QJsonObject toJson(const QJsonObject &extra = QJsonObject());
+
+class Scope
+{
+public:
+    explicit Scope(Stage stage);
+    ~Scope();
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    int m_previous;
+};
+
+} // namespace MemTrace
+
+#ifdef VTE_MEMTRACE
+#define VTE_MEM_SCOPE_CAT2(a, b) a##b
+#define VTE_MEM_SCOPE_CAT(a, b) VTE_MEM_SCOPE_CAT2(a, b)
+#define VTE_MEM_SCOPE(stage) MemTrace::Scope VTE_MEM_SCOPE_CAT(vteMemScope, __LINE__)(stage)
+#else
+#define VTE_MEM_SCOPE(stage) do {} while (false)
+#endif
+
+#endif // MEMTRACE_H
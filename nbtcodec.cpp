@@ -0,0 +1,751 @@
+#include "nbtcodec.h"
+#include "tracer.h"
+#include "memtrace.h"
+#include <QJsonDocument>
+#include <QStringList>
+#include <QIODevice>
+#include <QRandomGenerator>
+#include <QtConcurrent/QtConcurrentMap>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+
+namespace {
+
+// 村民职业，下标即实体的 Variant（0 为无业）。职业下拉框中的职业都在这里
+const char *const kProfessions[] = {
+    "", "farmer", "fisherman", "shepherd", "fletcher", "librarian", "cartographer", "cleric",
+    "armorer", "weaponsmith", "toolsmith", "butcher", "leatherworker", "mason", "nitwit",
+};
+
+// 实体的 Variant 是职业编号，必须与 definitions 中的职业一致；未知职业按无业（0）
+int professionVariant(const QString &profession)
+{
+    for (int i = 1; i < int(std::size(kProfessions)); ++i) {
+        if (profession == QLatin1String(kProfessions[i])) return i;
+    }
+    return 0;
+}
+
+// definitions 中的一项是否为职业定义（"+farmer" 等）；皮肤、年龄、日程等其他 + 定义都不是
+bool isProfessionDefinition(const QString &def)
+{
+    return def.startsWith('+') && professionVariant(def.mid(1)) > 0;
+}
+
+// 实体是否为村民：标识符是村民，或者带有交易（例如流浪商人）。僵尸村民不算
+bool isVillagerEntity(const QJsonArray &entity)
+{
+    for (const QJsonValue &v : entity) {
+        const QJsonObject obj = v.toObject();
+        const QString name = obj.value("name").toString();
+        if (name == "Offers") return true;
+        if (name == "identifier") {
+            const QString id = obj.value("value").toString();
+            if (id == "minecraft:villager_v2" || id == "minecraft:villager") return true;
+        }
+    }
+    return false;
+}
+
+// 以下 patch 函数只替换交易、职业与变种，实体的其余节点原样保留
+
+QJsonArray patchOffers(const QJsonArray &offers, const QJsonArray &recipes)
+{
+    QJsonArray out;
+    bool found = false;
+    for (const QJsonValue &v : offers) {
+        QJsonObject obj = v.toObject();
+        if (!found && obj.value("name").toString() == "Recipes") {
+            obj["value"] = recipes;
+            found = true;
+            out.append(obj);
+        } else {
+            out.append(v);
+        }
+    }
+    if (!found) out.prepend(NbtCodec::createNode("Recipes", recipes, 9));
+    return out;
+}
+
+QJsonArray patchDefinitions(const QJsonArray &defs, const QString &profession)
+{
+    QJsonArray out;
+    bool found = false;
+    for (const QJsonValue &v : defs) {
+        QJsonObject obj = v.toObject();
+        const QString val = obj.value("value").toString();
+        if (!found && isProfessionDefinition(val)) {   // 只替换职业定义，其他定义原样保留
+            obj["value"] = "+" + profession;
+            found = true;
+            out.append(obj);
+        } else {
+            out.append(v);
+        }
+    }
+    if (!found) out.append(NbtCodec::createNode("", "+" + profession, 8));
+    return out;
+}
+
+QJsonArray patchEntity(const QJsonArray &entity, const VillagerData &villager, const QJsonArray &recipes)
+{
+    QJsonArray out;
+    bool hasOffers = false;
+    bool hasVariant = false;
+    for (const QJsonValue &v : entity) {
+        QJsonObject obj = v.toObject();
+        const QString name = obj.value("name").toString();
+        if (name == "Offers" && obj.value("value").isArray()) {
+            obj["value"] = patchOffers(obj.value("value").toArray(), recipes);
+            hasOffers = true;
+        } else if (name == "MarkVariant") {
+            obj["value"] = villager.markVariant;
+            hasVariant = true;
+        } else if (name == "definitions" && obj.value("value").isArray()) {
+            obj["value"] = patchDefinitions(obj.value("value").toArray(), villager.profession);
+        } else if (name == "Variant") {
+            obj["value"] = professionVariant(villager.profession);   // 与 definitions 中的职业一致
+        } else if (name == "PreferredProfession") {
+            obj["value"] = villager.profession;
+        } else {
+            out.append(v);
+            continue;
+        }
+        out.append(obj);
+    }
+    if (!hasOffers && !recipes.isEmpty()) out.append(NbtCodec::buildOffersNbt(recipes));
+    if (!hasVariant) out.append(NbtCodec::createNode("MarkVariant", villager.markVariant, 3));
+    return out;
+}
+
+// 把第一个名为 name 的数组节点（查找顺序与 findArray 相同）的值替换为 value，沿途重建父节点
+bool replaceArray(QJsonArray &arr, const QString &name, const QJsonArray &value)
+{
+    for (qsizetype i = 0; i < arr.size(); ++i) {
+        QJsonObject obj = arr[i].toObject();
+        if (!obj.value("value").isArray()) continue;
+        if (obj.value("name").toString() == name) {
+            obj["value"] = value;
+            arr[i] = obj;
+            return true;
+        }
+        QJsonArray child = obj.value("value").toArray();
+        if (replaceArray(child, name, value)) {
+            obj["value"] = child;
+            arr[i] = obj;
+            return true;
+        }
+    }
+    return false;
+}
+
+QJsonDocument withRootArray(const QJsonDocument &source, const QJsonArray &root)
+{
+    if (source.isObject()) {
+        QJsonObject obj = source.object();
+        obj["value"] = root;
+        return QJsonDocument(obj);
+    }
+    return QJsonDocument(root);
+}
+
+// ---------- 结构模板 ----------
+// 头尾硬编码保护格式绝对正确；村民实体拆成 Offers 之前与之后两段，
+// 单村民保存与多村民打包共用。占位符在 entityText / structureFoot 中替换。
+const char kEntityHead[] = "{\"name\":\"\",\"value\":[{\"name\":\"Air\",\"value\":300,\"type\":2},{\"name\":\"Armor\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10}],\"type\":9},{\"name\":\"Attributes\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":20.0,\"type\":5},{\"name\":\"Current\",\"value\":20.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":20.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":20.0,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:health\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":128.0,\"type\":5},{\"name\":\"Current\",\"value\":128.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":2048.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":2048.0,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:follow_range\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.0,\"type\":5},{\"name\":\"Current\",\"value\":0.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":1.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":1.0,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:knockback_resistance\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.5,\"type\":5},{\"name\":\"Current\",\"value\":0.5,\"type\":5},{\"name\":\"DefaultMax\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:movement\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.02,\"type\":5},{\"name\":\"Current\",\"value\":0.02,\"type\":5},{\"name\":\"DefaultMax\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:underwater_movement\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.02,\"type\":5},{\"name\":\"Current\",\"value\":0.02,\"type\":5},{\"name\":\"DefaultMax\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:lava_movement\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.0,\"type\":5},{\"name\":\"Current\",\"value\":0.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":16.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":16.0,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:absorption\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.0,\"type\":5},{\"name\":\"Current\",\"value\":0.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":1024.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":-1024.0,\"type\":5},{\"name\":\"Max\",\"value\":1024.0,\"type\":5},{\"name\":\"Min\",\"value\":-1024.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:luck\",\"type\":8}],\"type\":10}],\"type\":9},{\"name\":\"ChestItems\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":0,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":1,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":2,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":3,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":4,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":5,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":6,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":7,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10}],\"type\":9},{\"name\":\"Chested\",\"value\":0,\"type\":1},{\"name\":\"Color\",\"value\":0,\"type\":1},{\"name\":\"Color2\",\"value\":0,\"type\":1},{\"name\":\"Dead\",\"value\":0,\"type\":1},{\"name\":\"DeathTime\",\"value\":0,\"type\":2},{\"name\":\"DwellingUniqueID\",\"value\":\"00000000-0000-0000-0000-000000000000\",\"type\":8},{\"name\":\"FallDistance\",\"value\":0.0,\"type\":5},{\"name\":\"HighTierCuredDiscount\",\"value\":0,\"type\":3},{\"name\":\"HurtTime\",\"value\":0,\"type\":2},{\"name\":\"InventoryVersion\",\"value\":\"1.21.132\",\"type\":8},{\"name\":\"Invulnerable\",\"value\":0,\"type\":1},{\"name\":\"IsAngry\",\"value\":0,\"type\":1},{\"name\":\"IsAutonomous\",\"value\":0,\"type\":1},{\"name\":\"IsBaby\",\"value\":0,\"type\":1},{\"name\":\"IsEating\",\"value\":0,\"type\":1},{\"name\":\"IsGliding\",\"value\":0,\"type\":1},{\"name\":\"IsGlobal\",\"value\":0,\"type\":1},{\"name\":\"IsIllagerCaptain\",\"value\":0,\"type\":1},{\"name\":\"IsInRaid\",\"value\":0,\"type\":1},{\"name\":\"IsOrphaned\",\"value\":0,\"type\":1},{\"name\":\"IsOutOfControl\",\"value\":0,\"type\":1},{\"name\":\"IsPregnant\",\"value\":0,\"type\":1},{\"name\":\"IsRoaring\",\"value\":0,\"type\":1},{\"name\":\"IsScared\",\"value\":0,\"type\":1},{\"name\":\"IsStunned\",\"value\":0,\"type\":1},{\"name\":\"IsSwimming\",\"value\":0,\"type\":1},{\"name\":\"IsTamed\",\"value\":0,\"type\":1},{\"name\":\"IsTrusting\",\"value\":0,\"type\":1},{\"name\":\"LeasherID\",\"value\":\"-1\",\"type\":4},{\"name\":\"LootDropped\",\"value\":0,\"type\":1},{\"name\":\"LowTierCuredDiscount\",\"value\":0,\"type\":3},{\"name\":\"Mainhand\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10}],\"type\":9},{\"name\":\"MarkVariant\",\"value\":__MARKVARIANT__,\"type\":3},{\"name\":\"NaturalSpawn\",\"value\":0,\"type\":1},{\"name\":\"NearbyCuredDiscount\",\"value\":0,\"type\":3},{\"name\":\"NearbyCuredDiscountTimeStamp\",\"value\":0,\"type\":3},";
+const char kEntityFoot[] = ",{\"name\":\"Offhand\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10}],\"type\":9},{\"name\":\"OnGround\",\"value\":1,\"type\":1},{\"name\":\"OwnerNew\",\"value\":\"-1\",\"type\":4},{\"name\":\"Persistent\",\"value\":1,\"type\":1},{\"name\":\"PortalCooldown\",\"value\":0,\"type\":3},{\"name\":\"Pos\",\"value\":__POS__,\"type\":9},{\"name\":\"PreferredProfession\",\"value\":\"__PREFERRED__\",\"type\":8},{\"name\":\"ReactToBell\",\"value\":0,\"type\":1},{\"name\":\"RewardPlayersOnFirstFounding\",\"value\":1,\"type\":1},{\"name\":\"Riches\",\"value\":0,\"type\":3},{\"name\":\"Rotation\",\"value\":[{\"name\":\"\",\"value\":97.6936,\"type\":5},{\"name\":\"\",\"value\":39.88098,\"type\":5}],\"type\":9},{\"name\":\"Saddled\",\"value\":0,\"type\":1},{\"name\":\"Sheared\",\"value\":0,\"type\":1},{\"name\":\"ShowBottom\",\"value\":0,\"type\":1},{\"name\":\"Sitting\",\"value\":0,\"type\":1},{\"name\":\"SkinID\",\"value\":2,\"type\":3},{\"name\":\"SlotDropChances\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"DropChance\",\"value\":0.0,\"type\":5},{\"name\":\"Slot\",\"value\":\"mainhand\",\"type\":8}],\"type\":10}],\"type\":9},{\"name\":\"Strength\",\"value\":0,\"type\":3},{\"name\":\"StrengthMax\",\"value\":0,\"type\":3},{\"name\":\"Surface\",\"value\":0,\"type\":1},{\"name\":\"Tags\",\"value\":[],\"type\":9},{\"name\":\"TargetID\",\"value\":\"-1\",\"type\":4},{\"name\":\"TradeExperience\",\"value\":0,\"type\":3},{\"name\":\"TradeTier\",\"value\":0,\"type\":3},{\"name\":\"UniqueID\",\"value\":\"__UNIQUEID__\",\"type\":4},{\"name\":\"Variant\",\"value\":__VARIANT__,\"type\":3},{\"name\":\"Willing\",\"value\":0,\"type\":1},{\"name\":\"boundX\",\"value\":0,\"type\":3},{\"name\":\"boundY\",\"value\":0,\"type\":3},{\"name\":\"boundZ\",\"value\":0,\"type\":3},{\"name\":\"canPickupItems\",\"value\":0,\"type\":1},{\"name\":\"definitions\",\"value\":[{\"name\":\"\",\"value\":\"+minecraft:villager_v2\",\"type\":8},{\"name\":\"\",\"value\":\"+villager_skin_2\",\"type\":8},{\"name\":\"\",\"value\":\"+adult\",\"type\":8},{\"name\":\"\",\"value\":\"__PROFESSION__\",\"type\":8},{\"name\":\"\",\"value\":\"+basic_schedule\",\"type\":8},{\"name\":\"\",\"value\":\"-job_specific_goals\",\"type\":8}],\"type\":9},{\"name\":\"hasBoundOrigin\",\"value\":0,\"type\":1},{\"name\":\"hasSetCanPickupItems\",\"value\":1,\"type\":1},{\"name\":\"identifier\",\"value\":\"minecraft:villager_v2\",\"type\":8},{\"name\":\"internalComponents\",\"value\":[],\"type\":10}],\"type\":10}";
+const char kStructureFoot[] = "],\"type\":9},{\"name\":\"palette\",\"value\":[{\"name\":\"default\",\"value\":[{\"name\":\"block_palette\",\"value\":[],\"type\":9},{\"name\":\"block_position_data\",\"value\":[],\"type\":10}],\"type\":10}],\"type\":10}],\"type\":10},{\"name\":\"structure_world_origin\",\"value\":__ORIGIN__,\"type\":9}],\"type\":10}";
+
+const char kLayerOpen[] = "{\"name\":\"\",\"value\":[";
+const char kLayerClose[] = "],\"type\":9}";
+const char kVoidIndex[] = "{\"name\":\"\",\"value\":-1,\"type\":3}";   // 结构空位：放置时保留原有方块
+const char kEntitiesOpen[] = "],\"type\":9},{\"name\":\"entities\",\"value\":[";
+
+const int kTemplateOrigin[3] = { -59, -59, -224 };
+const qint64 kTemplateUniqueId = -317827579897;
+
+QString intNode(qint64 value)
+{
+    return QString("{\"name\":\"\",\"value\":%1,\"type\":3}").arg(value);
+}
+
+QString floatNode(double value)
+{
+    return QString("{\"name\":\"\",\"value\":%1,\"type\":5}").arg(value, 0, 'f', 1);
+}
+
+// size 与 block_indices 开头
+QString structureHead(int sizeX, int sizeY, int sizeZ)
+{
+    return QString("{\"name\":\"\",\"value\":[{\"name\":\"format_version\",\"value\":1,\"type\":3},{\"name\":\"size\",\"value\":[")
+        + intNode(sizeX) + "," + intNode(sizeY) + "," + intNode(sizeZ)
+        + "],\"type\":9},{\"name\":\"structure\",\"value\":[{\"name\":\"block_indices\",\"value\":[";
+}
+
+QString entityText(const QString &offersJson, const QString &profession, int markVariant, const double pos[3], qint64 uniqueId)
+{
+    QString text = QString(kEntityHead) + offersJson + kEntityFoot;
+    text.replace("__PROFESSION__", "+" + profession);   // profession 不带 +
+    text.replace("__PREFERRED__", profession);
+    text.replace("__VARIANT__", QString::number(professionVariant(profession)));
+    text.replace("__MARKVARIANT__", QString::number(markVariant));
+    text.replace("__POS__", "[" + floatNode(pos[0]) + "," + floatNode(pos[1]) + "," + floatNode(pos[2]) + "]");
+    text.replace("__UNIQUEID__", QString::number(uniqueId));
+    return text;
+}
+
+QString structureFoot()
+{
+    QString text(kStructureFoot);
+    text.replace("__ORIGIN__", "[" + intNode(kTemplateOrigin[0]) + "," + intNode(kTemplateOrigin[1]) + "," + intNode(kTemplateOrigin[2]) + "]");
+    return text;
+}
+
+} // namespace
+
+namespace NbtCodec {
+
+// 递归查找指定 name 的 NBT 数组节点，无视嵌套深度
+QJsonArray findArray(const QJsonArray &arr, const QString &targetName) {
+    for (const QJsonValue &v : arr) {
+        if (!v.isObject()) continue;
+        QJsonObject obj = v.toObject();
+
+        // 找到了目标节点，并且它的 value 是个数组
+        if (obj.value("name").toString() == targetName && obj.value("value").isArray()) {
+            return obj.value("value").toArray();
+        }
+
+        // 没找到，但当前节点的 value 是数组，则递归往深处继续找
+        if (obj.value("value").isArray()) {
+            QJsonArray res = findArray(obj.value("value").toArray(), targetName);
+            if (!res.isEmpty()) return res;
+        }
+    }
+    return QJsonArray(); // 没找到则返回空
+}
+
+QJsonObject createNode(const QString &name, const QJsonValue &value, int type)
+{
+    return QJsonObject{{"name", name}, {"value", value}, {"type", type}};
+}
+
+QJsonObject buildTagNbt(const ItemData &data)
+{
+    QJsonArray tagArr;
+
+    if (data.enableName || data.enableLore) {
+        QJsonArray displayArr;
+        if (data.enableName) displayArr.append(createNode("Name", data.displayName, 8));
+
+        if (data.enableLore && !data.lore.isEmpty()) {
+            QJsonArray loreArr;
+            QStringList lines = data.lore.split('\n', Qt::SkipEmptyParts);
+            for (const QString &line : lines) {
+                loreArr.append(createNode("", line, 8));
+            }
+            if (!loreArr.isEmpty()) {
+                displayArr.append(createNode("Lore", loreArr, 9));
+            }
+        }
+        tagArr.append(createNode("display", displayArr, 10));
+    }
+
+    if (data.enableEnch) {
+        QJsonArray enchInner;
+        enchInner.append(createNode("id", data.enchId, 2));
+        enchInner.append(createNode("lvl", data.enchLevel, 2));
+        QJsonArray enchList; enchList.append(createNode("", enchInner, 10));
+        tagArr.append(createNode("ench", enchList, 9));
+    }
+
+    return tagArr.isEmpty() ? QJsonObject() : createNode("tag", tagArr, 10);
+}
+
+QJsonObject buildItemNbt(const QString &key, const ItemData &data)
+{
+    if (!data.pendingNodes.isEmpty()) return buildItemNbt(key, materialized(data));
+
+    QJsonArray arr;
+    arr.append(createNode("Count", data.count, 1));
+    arr.append(createNode("Damage", data.damage, 2));
+    arr.append(createNode("Name", data.name, 8));
+    arr.append(createNode("WasPickedUp", 0, 1));
+
+    QJsonObject tag = buildTagNbt(data);
+    if (!tag.isEmpty()) arr.append(tag);
+
+    // 追加自定义节点
+    if (data.enableCustom) {
+        for (const QJsonValue &cv : data.customNodes) {
+            if (cv.isObject()) {
+                arr.append(cv.toObject());
+            }
+        }
+    }
+
+    return createNode(key, arr, 10);
+}
+
+QJsonObject buildTradeNbt(const TradeOption &trade)
+{
+    QJsonArray tradeValueArr;
+    tradeValueArr.append(buildItemNbt("buyA", trade.buyA));
+    tradeValueArr.append(buildItemNbt("buyB", trade.buyB));
+    tradeValueArr.append(createNode("buyCountA", trade.buyA.count, 3));
+    tradeValueArr.append(createNode("buyCountB", trade.buyB.count, 3));
+    tradeValueArr.append(createNode("demand", 0, 3));
+    tradeValueArr.append(createNode("maxUses", trade.maxUses, 3));
+    tradeValueArr.append(createNode("priceMultiplierA", 0.05, 5));
+    tradeValueArr.append(createNode("priceMultiplierB", 0.0, 5));
+    tradeValueArr.append(createNode("rewardExp", 1, 1));
+    tradeValueArr.append(buildItemNbt("sell", trade.sell));
+    tradeValueArr.append(createNode("tier", trade.tier, 3));
+    tradeValueArr.append(createNode("traderExp", 5, 3));
+    tradeValueArr.append(createNode("uses", trade.uses, 3));
+
+    return createNode("", tradeValueArr, 10);
+}
+
+QJsonObject buildOffersNbt(const QJsonArray &recipesArr)
+{
+    QJsonObject recipesObj = createNode("Recipes", recipesArr, 9);
+
+    // 构建 TierExpRequirements (硬编码以适配格式)
+    QJsonArray tierExpArr;
+    tierExpArr.append(createNode("", QJsonArray{createNode("0", 0, 3)}, 10));
+    tierExpArr.append(createNode("", QJsonArray{createNode("1", 10, 3)}, 10));
+    tierExpArr.append(createNode("", QJsonArray{createNode("2", 70, 3)}, 10));
+    tierExpArr.append(createNode("", QJsonArray{createNode("3", 150, 3)}, 10));
+    tierExpArr.append(createNode("", QJsonArray{createNode("4", 250, 3)}, 10));
+    QJsonObject tierExpObj = createNode("TierExpRequirements", tierExpArr, 9);
+
+    QJsonArray offersArr;
+    offersArr.append(recipesObj);
+    offersArr.append(tierExpObj);
+    return createNode("Offers", offersArr, 10);
+}
+
+QString serialize(const QList<TradeOption> &trades, const QString &profession, int markVariant,
+                  const std::function<bool(qsizetype)> &progress)
+{
+    VTE_TRACE("NbtCodec::serializeTrades");
+    VTE_MEM_SCOPE(MemTrace::Serialize);
+    QJsonObject offersObj;
+    {
+        VTE_MEM_SCOPE(MemTrace::Build);
+        QJsonArray recipesArr;
+        for (qsizetype i = 0; i < trades.size(); ++i) {
+            if (progress && i % 256 == 0 && !progress(i)) return QString();
+            recipesArr.append(buildTradeNbt(trades[i]));
+        }
+        offersObj = buildOffersNbt(recipesArr);
+    }
+    QJsonDocument doc;
+    doc.setObject(offersObj);
+    QString middle = doc.toJson(QJsonDocument::Compact);
+
+    // 1×1×1 的结构，唯一的村民站在格子中央
+    QString full = structureHead(1, 1, 1);
+    full += QString(kLayerOpen) + kVoidIndex + kLayerClose + "," + kLayerOpen + kVoidIndex + kLayerClose;
+    full += kEntitiesOpen;
+    const double pos[3] = { kTemplateOrigin[0] + 0.5, double(kTemplateOrigin[1]), kTemplateOrigin[2] + 0.5 };
+    full += entityText(middle, profession, markVariant, pos, kTemplateUniqueId);
+    full += structureFoot();
+    return full;
+}
+
+bool writeSingle(QIODevice *out, qsizetype count, const std::function<TradeOption(qsizetype)> &trade,
+                 const QString &profession, int markVariant)
+{
+    VTE_TRACE("NbtCodec::writeSingle");
+    VTE_MEM_SCOPE(MemTrace::Serialize);
+    // 以一个占位的交易生成完整文本，在占位处拆成交易之前与之后两段
+    const QString marker = "\"__RECIPES__\"";
+    const QString offers = QString::fromUtf8(QJsonDocument(buildOffersNbt(QJsonArray{ QString("__RECIPES__") })).toJson(QJsonDocument::Compact));
+    QString full = structureHead(1, 1, 1);
+    full += QString(kLayerOpen) + kVoidIndex + kLayerClose + "," + kLayerOpen + kVoidIndex + kLayerClose;
+    full += kEntitiesOpen;
+    const double pos[3] = { kTemplateOrigin[0] + 0.5, double(kTemplateOrigin[1]), kTemplateOrigin[2] + 0.5 };
+    full += entityText(offers, profession, markVariant, pos, kTemplateUniqueId);
+    full += structureFoot();
+    const qsizetype at = full.indexOf(marker);
+
+    QByteArray chunk = full.left(at).toUtf8();
+    for (qsizetype i = 0; i < count; ++i) {
+        if (i > 0) chunk += ',';
+        chunk += QJsonDocument(buildTradeNbt(trade(i))).toJson(QJsonDocument::Compact);
+        if (chunk.size() >= 64 * 1024) {
+            if (out->write(chunk) != chunk.size()) return false;
+            chunk.clear();
+        }
+    }
+    chunk += full.mid(at + marker.size()).toUtf8();
+    return out->write(chunk) == chunk.size();
+}
+
+ItemData parseItem(const QJsonArray &arr)
+{
+    ItemData item;
+    QJsonArray customNodes; // 临时收集自定义节点
+    for (const QJsonValue &v : arr) {
+        if (!v.isObject()) continue;
+        QJsonObject obj = v.toObject();
+        QString n = obj.value("name").toString();
+        QJsonValue val = obj.value("value");
+
+        if (n == "Count") item.count = val.toInt();
+        else if (n == "Damage") item.damage = val.toInt();
+        else if (n == "Name") item.name = val.toString();
+        else if (n == "WasPickedUp") {
+            // 忽略，保持默认值
+        }
+        else if (n == "tag" && val.isArray()) {
+            // 原有 tag 解析保持不变
+            QJsonArray tagArr = val.toArray();
+            for (const QJsonValue &tv : tagArr) {
+                QJsonObject tobj = tv.toObject();
+                QString tn = tobj.value("name").toString();
+
+                if (tn == "display" && tobj.value("value").isArray()) {
+                    for (const QJsonValue &dv : tobj.value("value").toArray()) {
+                        QJsonObject dobj = dv.toObject();
+                        if (dobj.value("name").toString() == "Name") {
+                            item.enableName = true;
+                            item.displayName = dobj.value("value").toString();
+                        } else if (dobj.value("name").toString() == "Lore") {
+                            item.enableLore = true;
+                            QJsonArray loreArr = dobj.value("value").toArray();
+                            QStringList lines;
+                            for (const QJsonValue &lv : loreArr) {
+                                if (lv.isObject()) {
+                                    lines.append(lv.toObject().value("value").toString());
+                                }
+                            }
+                            item.lore = lines.join('\n');   // 用换行符拼接，用于 UI 显示
+                        }
+                    }
+                } else if (tn == "ench" && tobj.value("value").isArray()) {
+                    item.enableEnch = true;
+                    QJsonArray enchArr = tobj.value("value").toArray();
+                    if (!enchArr.isEmpty()) {
+                        QJsonArray innerArr = enchArr[0].toObject().value("value").toArray();
+                        for (const QJsonValue &iv : innerArr) {
+                            QJsonObject iobj = iv.toObject();
+                            if (iobj.value("name").toString() == "id") item.enchId = iobj.value("value").toInt();
+                            if (iobj.value("name").toString() == "lvl") item.enchLevel = iobj.value("value").toInt();
+                        }
+                    }
+                }
+                // 注意：tag 内部的其他节点不会单独处理，它们将保留在原有的 tag 节点中，不会丢失
+            }
+        }
+        else {
+            // 不是标准字段，则视为自定义节点，保留原样
+            customNodes.append(obj);
+        }
+    }
+
+    if (!customNodes.isEmpty()) {
+        item.enableCustom = true;
+        item.customNodes = customNodes;
+    }
+    return item;
+}
+
+ItemData parseItemSummary(const QJsonArray &arr)
+{
+    ItemData item;
+    bool hasDetail = false;
+    for (const QJsonValue &v : arr) {
+        const QJsonObject obj = v.toObject();
+        const QString n = obj.value("name").toString();
+        if (n == "Count") item.count = obj.value("value").toInt();
+        else if (n == "Damage") item.damage = obj.value("value").toInt();
+        else if (n == "Name") item.name = obj.value("value").toString();
+        else if (n != "WasPickedUp" && v.isObject()) hasDetail = true;
+    }
+    // 大多数物品只有这几个字段，不需要保留原始节点
+    if (hasDetail) item.pendingNodes = arr;
+    return item;
+}
+
+ItemData materialized(const ItemData &item)
+{
+    if (item.pendingNodes.isEmpty()) return item;
+    ItemData full = parseItem(item.pendingNodes);
+    full.name = item.name;
+    full.count = item.count;
+    full.damage = item.damage;
+    return full;
+}
+
+void materialize(TradeOption &trade)
+{
+    for (ItemData *item : { &trade.buyA, &trade.buyB, &trade.sell }) {
+        if (!item->pendingNodes.isEmpty()) *item = materialized(*item);
+    }
+}
+
+bool sameContent(const ItemData &a, const ItemData &b)
+{
+    const bool pendingA = !a.pendingNodes.isEmpty();
+    const bool pendingB = !b.pendingNodes.isEmpty();
+    if (pendingA == pendingB) return a == b;
+    return pendingA ? materialized(a) == b : a == materialized(b);
+}
+
+bool sameContent(const TradeOption &a, const TradeOption &b)
+{
+    return sameContent(a.buyA, b.buyA) && sameContent(a.buyB, b.buyB) && sameContent(a.sell, b.sell)
+        && a.uses == b.uses && a.maxUses == b.maxUses && a.tier == b.tier;
+}
+
+QJsonArray rootArray(const QJsonDocument &doc)
+{
+    // 获取最外层根数组
+    if (doc.isObject() && doc.object().contains("value")) {
+        return doc.object().value("value").toArray();
+    } else if (doc.isArray()) {
+        return doc.array();
+    }
+    return QJsonArray();
+}
+
+QJsonArray findRecipes(const QJsonArray &root)
+{
+    // 核心修复：使用递归函数，无视固定头尾的层层嵌套，直接提取 Offers 和 Recipes
+    QJsonArray offersArr = findArray(root, "Offers");
+    return findArray(offersArr, "Recipes");
+}
+
+TradeOption parseTrade(const QJsonValue &recipe)
+{
+    TradeOption trade;
+    for (const QJsonValue &f : recipe.toObject().value("value").toArray()) {
+        QJsonObject fObj = f.toObject();
+        QString name = fObj.value("name").toString();
+
+        if (name == "buyA") trade.buyA = parseItemSummary(fObj.value("value").toArray());
+        else if (name == "buyB") trade.buyB = parseItemSummary(fObj.value("value").toArray());
+        else if (name == "sell") trade.sell = parseItemSummary(fObj.value("value").toArray());
+        else if (name == "uses") trade.uses = fObj.value("value").toInt();
+        else if (name == "maxUses") trade.maxUses = fObj.value("value").toInt();
+        else if (name == "tier") trade.tier = fObj.value("value").toInt();
+    }
+    return trade;
+}
+
+QList<TradeOption> parseTrades(const QJsonArray &root)
+{
+    QList<TradeOption> trades;
+    const QJsonArray recipesArr = findRecipes(root);
+    trades.reserve(recipesArr.size());
+    for (const QJsonValue &r : recipesArr) {
+        trades.append(parseTrade(r));
+    }
+    return trades;
+}
+
+void extractGlobals(const QJsonArray &rootArr, QString &profession, int &markVariant)
+{
+    // 查找 MarkVariant
+    markVariant = 0;
+    for (const QJsonValue &v : rootArr) {
+        if (v.isObject()) {
+            QJsonObject obj = v.toObject();
+            if (obj.value("name").toString() == "MarkVariant") {
+                markVariant = obj.value("value").toInt();
+                break;
+            }
+        }
+    }
+
+    // 查找 definitions 数组
+    QJsonArray defArr = findArray(rootArr, "definitions");
+    profession = "cartographer"; // 默认
+    if (!defArr.isEmpty()) {
+        for (const QJsonValue &v : defArr) {
+            if (!v.isObject()) continue;
+            QJsonObject obj = v.toObject();
+            const QString val = obj.value("value").toString();
+            if (isProfessionDefinition(val)) {
+                profession = val.mid(1);
+                break;
+            }
+        }
+    }
+}
+
+// ==================== 多实体结构 ====================
+
+VillagerDocument scanDocument(const QString &nbtText, QList<QJsonArray> *recipes, QString *error)
+{
+    VTE_TRACE("NbtCodec::scanDocument");
+    VTE_MEM_SCOPE(MemTrace::Parse);
+    VillagerDocument document;
+    QJsonParseError err;
+    const QJsonDocument doc = QJsonDocument::fromJson(nbtText.toUtf8(), &err);
+    if (error) {
+        *error = err.error == QJsonParseError::NoError
+            ? QString()
+            : QString("JSON 解析失败（偏移 %1）：%2").arg(err.offset).arg(err.errorString());
+    }
+    const QJsonArray root = (err.error == QJsonParseError::NoError) ? rootArray(doc) : QJsonArray();
+
+    const QJsonArray entities = findArray(root, "entities");
+    for (qsizetype i = 0; i < entities.size(); ++i) {
+        const QJsonArray entity = entities[i].toObject().value("value").toArray();
+        if (!isVillagerEntity(entity)) continue;
+        VillagerData villager;
+        villager.entityIndex = int(i);
+        extractGlobals(entity, villager.profession, villager.markVariant);
+        document.villagers.append(villager);
+        if (recipes) recipes->append(findRecipes(entity));
+    }
+    if (!document.villagers.isEmpty()) {
+        document.source = doc;
+        return document;
+    }
+
+    // 没有村民实体：整个文件视为一个村民，保存时使用内置模板
+    VillagerData villager;
+    extractGlobals(root, villager.profession, villager.markVariant);
+    document.villagers.append(villager);
+    if (recipes) recipes->append(findRecipes(root));
+    return document;
+}
+
+VillagerDocument parseDocument(const QString &nbtText, QString *error)
+{
+    VTE_TRACE("NbtCodec::parseDocument");
+    VTE_MEM_SCOPE(MemTrace::Parse);
+    QList<QJsonArray> recipes;
+    VillagerDocument document = scanDocument(nbtText, &recipes, error);
+
+    // 各村民的交易互不相关，按村民并行解析
+    VillagerData *villagers = document.villagers.data();
+    QList<int> indices(document.villagers.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    QtConcurrent::blockingMap(indices, [villagers, &recipes](int i) {
+        VTE_MEM_SCOPE(MemTrace::Parse);
+        villagers[i].trades.reserve(recipes[i].size());
+        for (const QJsonValue &r : recipes[i]) villagers[i].trades.append(parseTrade(r));
+    });
+    return document;
+}
+
+QString serialize(const VillagerDocument &document, const std::function<bool(qsizetype)> &progress)
+{
+    VTE_TRACE("NbtCodec::serialize");
+    VTE_MEM_SCOPE(MemTrace::Serialize);
+    if (document.source.isNull() || document.villagers.isEmpty()) {
+        const VillagerData villager = document.villagers.value(0);
+        return serialize(villager.trades, villager.profession, villager.markVariant, progress);
+    }
+
+    QJsonArray root = rootArray(document.source);
+    QJsonArray entities = findArray(root, "entities");
+    qsizetype done = 0;
+    for (const VillagerData &villager : document.villagers) {
+        if (villager.entityIndex < 0 || villager.entityIndex >= entities.size()) continue;
+        VTE_MEM_SCOPE(MemTrace::Build);
+        QJsonArray recipes;
+        for (const TradeOption &trade : villager.trades) {
+            if (progress && done % 256 == 0 && !progress(done)) return QString();
+            recipes.append(buildTradeNbt(trade));
+            ++done;
+        }
+        QJsonObject entityObj = entities[villager.entityIndex].toObject();
+        entityObj["value"] = patchEntity(entityObj.value("value").toArray(), villager, recipes);
+        entities[villager.entityIndex] = entityObj;
+    }
+    replaceArray(root, "entities", entities);
+    return QString::fromUtf8(withRootArray(document.source, root).toJson(QJsonDocument::Compact));
+}
+
+QJsonDocument skeleton(const VillagerDocument &document)
+{
+    if (document.source.isNull()) return QJsonDocument();
+    QJsonArray root = rootArray(document.source);
+    QJsonArray entities = findArray(root, "entities");
+    for (const VillagerData &villager : document.villagers) {
+        if (villager.entityIndex < 0 || villager.entityIndex >= entities.size()) continue;
+        QJsonObject entityObj = entities[villager.entityIndex].toObject();
+        QJsonArray entity = entityObj.value("value").toArray();
+        for (qsizetype i = 0; i < entity.size(); ++i) {
+            QJsonObject node = entity[i].toObject();
+            if (node.value("name").toString() != "Offers" || !node.value("value").isArray()) continue;
+            node["value"] = patchOffers(node.value("value").toArray(), QJsonArray());
+            entity[i] = node;
+        }
+        entityObj["value"] = entity;
+        entities[villager.entityIndex] = entityObj;
+    }
+    replaceArray(root, "entities", entities);
+    return withRootArray(document.source, root);
+}
+
+// ==================== 多村民打包 ====================
+
+bool writePacked(QIODevice *out, const QList<VillagerData> &villagers, const PackLayout &layout,
+                 const std::function<bool(qsizetype)> &progress)
+{
+    // 村民排在 y = 0 的一层网格上，相邻村民之间空出 spacing 格
+    const int count = qMax(1, int(villagers.size()));
+    const int columns = layout.columns > 0 ? qMin(layout.columns, count) : int(std::ceil(std::sqrt(double(count))));
+    const int rows = (count + columns - 1) / columns;
+    const int pitch = 1 + qMax(0, layout.spacing);
+    const int sizeX = (columns - 1) * pitch + 1;
+    const int sizeZ = (rows - 1) * pitch + 1;
+    const qint64 volume = qint64(sizeX) * sizeZ;
+
+    auto write = [out](const QString &text) {
+        const QByteArray data = text.toUtf8();
+        return out->write(data) == data.size();
+    };
+
+    if (!write(structureHead(sizeX, 1, sizeZ))) return false;
+
+    // 两层 block_indices（方块层与含水层）全部是结构空位，按 64 KiB 分块写出
+    QByteArray chunk;
+    for (int layer = 0; layer < 2; ++layer) {
+        if (layer > 0) chunk += ',';
+        chunk += kLayerOpen;
+        for (qint64 i = 0; i < volume; ++i) {
+            if (i > 0) chunk += ',';
+            chunk += kVoidIndex;
+            if (chunk.size() >= 64 * 1024) {
+                if (out->write(chunk) != chunk.size()) return false;
+                chunk.clear();
+            }
+        }
+        chunk += kLayerClose;
+    }
+    chunk += kEntitiesOpen;
+    if (out->write(chunk) != chunk.size()) return false;
+
+    // 同一世界中放置多个打包结构时实体 ID 不能重复：每次导出从随机的负数开始依次减一
+    const qint64 firstUniqueId = layout.firstUniqueId != 0
+        ? layout.firstUniqueId
+        : -1 - qint64(QRandomGenerator::global()->generate64() >> 2);
+
+    // 每个实体编码后立即写出，内存占用与村民数量无关
+    for (qsizetype i = 0; i < villagers.size(); ++i) {
+        if (progress && !progress(i)) return false;
+        const VillagerData &villager = villagers[i];
+        QJsonArray recipes;
+        for (const TradeOption &trade : villager.trades) recipes.append(buildTradeNbt(trade));
+        const QString offers = QString::fromUtf8(QJsonDocument(buildOffersNbt(recipes)).toJson(QJsonDocument::Compact));
+
+        const int x = int(i % columns) * pitch;
+        const int z = int(i / columns) * pitch;
+        const double pos[3] = { kTemplateOrigin[0] + x + 0.5, double(kTemplateOrigin[1]), kTemplateOrigin[2] + z + 0.5 };
+        const QString entity = entityText(offers, villager.profession, villager.markVariant, pos, firstUniqueId - i);
+        if (!write(i > 0 ? "," + entity : entity)) return false;
+    }
+    if (progress && !progress(villagers.size())) return false;
+    return write(structureFoot());
+}
+
+} // namespace NbtCodec
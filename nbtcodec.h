@@ -0,0 +1,85 @@
+#ifndef NBTCODEC_H
+#define NBTCODEC_H
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <functional>
+#include "tradedata.h"
+
+class QIODevice;
+
+// ==================== 村民结构 NBT-JSON 编解码 ====================
+// 交易列表与 Mojang NBT-JSON（{name, value, type} 节点）之间的转换。
+// 全部是无状态的自由函数，可以在工作线程中调用。
+namespace NbtCodec {
+
+// 输出格式的版本：生成的文本有任何变化时递增（批量导出的缓存键包含它）
+const int kSerializerVersion = 3;
+
+// ---------- 构建 ----------
+QJsonObject createNode(const QString &name, const QJsonValue &value, int type);
+QJsonObject buildTagNbt(const ItemData &data);
+QJsonObject buildItemNbt(const QString &key, const ItemData &data);
+QJsonObject buildTradeNbt(const TradeOption &trade);
+QJsonObject buildOffersNbt(const QJsonArray &recipes);   // Recipes + TierExpRequirements
+// 按内置模板生成单个村民的结构文件文本；profession 不带 '+'。
+// progress 每构建一批交易调用一次（参数为已完成的条数），返回 false 时中止并返回空字符串
+QString serialize(const QList<TradeOption> &trades, const QString &profession, int markVariant,
+                  const std::function<bool(qsizetype)> &progress = nullptr);
+// 与 serialize 输出相同的文本，但流式写入 out：trade(i) 依次给出第 i 条交易（0 <= i < count），
+// 编码后立即写出，内存中既没有整个交易列表也没有完整的文本。写入失败时返回 false
+bool writeSingle(QIODevice *out, qsizetype count, const std::function<TradeOption(qsizetype)> &trade,
+                 const QString &profession, int markVariant);
+
+// ---------- 解析 ----------
+// 最外层根数组（{name, value, type} 根节点的 value，或文档本身就是数组）
+QJsonArray rootArray(const QJsonDocument &doc);
+// 递归查找指定 name 的 NBT 数组节点，无视嵌套深度
+QJsonArray findArray(const QJsonArray &arr, const QString &targetName);
+QJsonArray findRecipes(const QJsonArray &root);   // Offers / Recipes
+ItemData parseItem(const QJsonArray &arr);
+// 只读 Name / Count / Damage；物品还有其他节点（tag、自定义节点）时把原始数组留在 pendingNodes 中
+ItemData parseItemSummary(const QJsonArray &arr);
+// 展开 pendingNodes 得到完整的物品；摘要字段以 item 中的值为准（载入后可能已被修改）
+ItemData materialized(const ItemData &item);
+void materialize(TradeOption &trade);   // 就地展开三个物品
+// 按内容比较（撤销栈用它判断一次界面事件是否真的改变了数据）：两方都未展开时比较原始节点与摘要字段，
+// 只有一方未展开时才展开它
+bool sameContent(const ItemData &a, const ItemData &b);
+bool sameContent(const TradeOption &a, const TradeOption &b);
+TradeOption parseTrade(const QJsonValue &recipe);   // 物品只解析摘要
+QList<TradeOption> parseTrades(const QJsonArray &root);
+// 提取职业（不带 '+'）与变种；找不到时为 "cartographer" 与 0
+void extractGlobals(const QJsonArray &root, QString &profession, int &markVariant);
+
+// ---------- 多实体结构 ----------
+// 枚举 entities 列表中的每个村民实体：得到各自的职业、变种与实体位置（交易留空），
+// recipes 非空时按同样顺序输出各村民的 Recipes 数组。没有村民实体的文件视为单个村民（source 为空）。
+// 文本不是有效的 JSON 时同样得到一个没有交易的村民，error 非空时写入解析错误（成功时清空）
+VillagerDocument scanDocument(const QString &nbtText, QList<QJsonArray> *recipes = nullptr, QString *error = nullptr);
+// 完整解析：scanDocument 之后按村民并行解析交易
+VillagerDocument parseDocument(const QString &nbtText, QString *error = nullptr);
+// 在原始文档上替换每个村民的交易、职业与变种后输出；没有原始文档时按内置模板输出第一个村民
+QString serialize(const VillagerDocument &document, const std::function<bool(qsizetype)> &progress = nullptr);
+// 清空各村民 Recipes 之后的原始文档；serialize 会重新填入交易，因此可以代替 source 保存到缓存中
+QJsonDocument skeleton(const VillagerDocument &document);
+
+// ---------- 多村民打包 ----------
+// 把多个村民（各自的交易、职业与变种）按网格排进同一个结构，每个村民一格。
+// 尺寸与 block_indices 按网格计算，每个实体有自己的 Pos 与 UniqueID。
+struct PackLayout {
+    int columns = 0;   // 每行村民数，0 表示自动（接近正方形）
+    int spacing = 1;   // 相邻村民之间的空格数
+    qint64 firstUniqueId = 0;   // 第一个村民的 UniqueID，之后依次减一；0 表示每次导出随机选取
+};
+// 流式写出：每编码一个实体就写入 out。progress 在每个村民之前调用（参数为已写出的村民数），
+// 返回 false 时中止；写入失败同样返回 false
+bool writePacked(QIODevice *out, const QList<VillagerData> &villagers, const PackLayout &layout,
+                 const std::function<bool(qsizetype)> &progress = nullptr);
+
+} // namespace NbtCodec
+
+#endif // NBTCODEC_H
@@ -0,0 +1,231 @@
+#include "nbtvalidator.h"
+#include <QJsonObject>
+#include <cmath>
+
+namespace {
+
+enum class Shape { Integer, LongInteger, Number, String, IntegerArray, LongArray, List, Compound };
+
+struct TypeRule {
+    const char *name;
+    Shape shape;
+    double min;
+    double max;
+};
+
+// 按类型码索引的校验规则表；0（TAG_End）不允许出现在节点中
+const TypeRule kRules[] = {
+    { nullptr,     Shape::Integer,      0, 0 },
+    { "Byte",      Shape::Integer,      -128, 255 },
+    { "Short",     Shape::Integer,      -32768, 65535 },
+    { "Int",       Shape::Integer,      -2147483648.0, 4294967295.0 },
+    { "Long",      Shape::LongInteger,  0, 0 },
+    { "Float",     Shape::Number,       0, 0 },
+    { "Double",    Shape::Number,       0, 0 },
+    { "ByteArray", Shape::IntegerArray, -128, 255 },
+    { "String",    Shape::String,       0, 0 },
+    { "List",      Shape::List,         0, 0 },
+    { "Compound",  Shape::Compound,     0, 0 },
+    { "IntArray",  Shape::IntegerArray, -2147483648.0, 4294967295.0 },
+    { "LongArray", Shape::LongArray,    0, 0 },
+};
+const int kMaxType = 12;
+const int kMaxDepth = 512;
+
+QString jsonKindName(const QJsonValue &v)
+{
+    switch (v.type()) {
+    case QJsonValue::Null: return "null";
+    case QJsonValue::Bool: return "布尔值";
+    case QJsonValue::Double: return "数字";
+    case QJsonValue::String: return "字符串";
+    case QJsonValue::Array: return "数组";
+    case QJsonValue::Object: return "对象";
+    default: return "未定义";
+    }
+}
+
+bool isIntegerIn(const QJsonValue &v, double min, double max)
+{
+    if (!v.isDouble()) return false;
+    const double d = v.toDouble();
+    return std::floor(d) == d && d >= min && d <= max;
+}
+
+bool isLongValue(const QJsonValue &v)
+{
+    // Long 在 Mojang 的 JSON 中通常写成字符串（例如 "-1"），也接受整数
+    if (v.isString()) {
+        bool ok = false;
+        v.toString().toLongLong(&ok);
+        return ok;
+    }
+    return isIntegerIn(v, -9223372036854775808.0, 9223372036854775807.0);
+}
+
+class Checker
+{
+public:
+    explicit Checker(int maxIssues) : m_maxIssues(maxIssues) {}
+
+    QList<NbtValidator::Issue> issues;
+
+    bool full() const { return issues.size() >= m_maxIssues; }
+
+    void report(const QString &path, const QString &message)
+    {
+        if (!full()) issues.append(NbtValidator::Issue{ path, message });
+    }
+
+    static QString child(const QString &path, const QString &segment)
+    {
+        return path.isEmpty() ? segment : path + " / " + segment;
+    }
+
+    void checkCompoundChildren(const QJsonArray &nodes, const QString &path, int depth)
+    {
+        for (int i = 0; i < nodes.size() && !full(); ++i) {
+            const QString name = nodes[i].toObject().value("name").toString();
+            checkNode(nodes[i], child(path, name.isEmpty() ? QString("[%1]").arg(i) : name), -1, depth);
+        }
+    }
+
+    // expectedType >= 0 时要求节点类型与之相同（列表元素）
+    void checkNode(const QJsonValue &node, const QString &path, int expectedType, int depth)
+    {
+        if (!node.isObject()) {
+            report(path, QString("节点必须是 {name, value, type} 对象，实际是%1").arg(jsonKindName(node)));
+            return;
+        }
+        const QJsonObject obj = node.toObject();
+
+        if (!obj.value("name").isString()) {
+            report(path, "缺少字符串类型的 name 字段");
+        }
+
+        const QJsonValue typeValue = obj.value("type");
+        if (!isIntegerIn(typeValue, 1, kMaxType)) {
+            report(path, QString("type 必须是 1~%1 的整数，实际是 %2")
+                             .arg(kMaxType)
+                             .arg(typeValue.isDouble() ? QString::number(typeValue.toDouble()) : jsonKindName(typeValue)));
+            return;
+        }
+        const int type = typeValue.toInt();
+        if (expectedType >= 0 && type != expectedType) {
+            report(path, QString("列表元素类型不一致：应为 %1，实际是 %2")
+                             .arg(QString::fromLatin1(kRules[expectedType].name), QString::fromLatin1(kRules[type].name)));
+            return;
+        }
+
+        if (!obj.contains("value")) {
+            report(path, "缺少 value 字段");
+            return;
+        }
+        checkValue(obj.value("value"), type, path, depth);
+    }
+
+    void checkValue(const QJsonValue &value, int type, const QString &path, int depth)
+    {
+        if (depth > kMaxDepth) {
+            report(path, "嵌套层数过深");
+            return;
+        }
+        const TypeRule &rule = kRules[type];
+        const QString expect = QString("%1(%2)").arg(QString::fromLatin1(rule.name)).arg(type);
+
+        switch (rule.shape) {
+        case Shape::Integer:
+            if (!isIntegerIn(value, rule.min, rule.max))
+                report(path, QString("%1 需要 %2~%3 之间的整数，实际是 %4")
+                                 .arg(expect).arg(rule.min, 0, 'f', 0).arg(rule.max, 0, 'f', 0)
+                                 .arg(value.isDouble() ? QString::number(value.toDouble()) : jsonKindName(value)));
+            break;
+        case Shape::LongInteger:
+            if (!isLongValue(value))
+                report(path, QString("%1 需要整数或整数字符串，实际是%2").arg(expect, jsonKindName(value)));
+            break;
+        case Shape::Number:
+            if (!value.isDouble())
+                report(path, QString("%1 需要数字，实际是%2").arg(expect, jsonKindName(value)));
+            break;
+        case Shape::String:
+            if (!value.isString())
+                report(path, QString("%1 需要字符串，实际是%2").arg(expect, jsonKindName(value)));
+            break;
+        case Shape::IntegerArray:
+        case Shape::LongArray: {
+            if (!value.isArray()) {
+                report(path, QString("%1 需要数组，实际是%2").arg(expect, jsonKindName(value)));
+                break;
+            }
+            const QJsonArray arr = value.toArray();
+            for (int i = 0; i < arr.size() && !full(); ++i) {
+                const bool ok = (rule.shape == Shape::LongArray) ? isLongValue(arr[i])
+                                                                 : isIntegerIn(arr[i], rule.min, rule.max);
+                if (!ok) report(child(path, QString("[%1]").arg(i)), QString("%1 的元素不是合法的整数").arg(expect));
+            }
+            break;
+        }
+        case Shape::List:
+            if (!value.isArray()) {
+                report(path, QString("%1 需要数组，实际是%2").arg(expect, jsonKindName(value)));
+                break;
+            }
+            checkList(value.toArray(), path, depth);
+            break;
+        case Shape::Compound:
+            if (!value.isArray()) {
+                report(path, QString("%1 需要子节点数组，实际是%2").arg(expect, jsonKindName(value)));
+                break;
+            }
+            checkCompoundChildren(value.toArray(), path, depth + 1);
+            break;
+        }
+    }
+
+    void checkList(const QJsonArray &arr, const QString &path, int depth)
+    {
+        if (arr.isEmpty()) return;
+
+        // 列表元素通常是 {name:"", value, type} 节点，所有元素类型必须一致；
+        // 也兼容直接写标量值的简写（如 ["minecraft:grass"]），此时要求 JSON 类型一致
+        if (arr.first().isObject()) {
+            const QJsonValue firstType = arr.first().toObject().value("type");
+            const int expected = isIntegerIn(firstType, 1, kMaxType) ? firstType.toInt() : -1;
+            for (int i = 0; i < arr.size() && !full(); ++i) {
+                checkNode(arr[i], child(path, QString("[%1]").arg(i)), expected, depth + 1);
+            }
+            return;
+        }
+
+        const QJsonValue::Type kind = arr.first().type();
+        for (int i = 0; i < arr.size() && !full(); ++i) {
+            if (arr[i].type() != kind || arr[i].isObject() || arr[i].isArray()) {
+                report(child(path, QString("[%1]").arg(i)),
+                       QString("列表元素形状不一致：第一个元素是%1，这里是%2")
+                           .arg(jsonKindName(arr.first()), jsonKindName(arr[i])));
+            }
+        }
+    }
+
+private:
+    int m_maxIssues;
+};
+
+} // namespace
+
+namespace NbtValidator {
+
+QList<Issue> validateNodes(const QJsonArray &nodes, const QString &rootPath, int maxIssues)
+{
+    Checker checker(maxIssues);
+    checker.checkCompoundChildren(nodes, rootPath, 0);
+    return checker.issues;
+}
+
+QString formatIssue(const Issue &issue)
+{
+    return issue.path.isEmpty() ? issue.message : QString("%1：%2").arg(issue.path, issue.message);
+}
+
+} // namespace NbtValidator
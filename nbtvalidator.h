@@ -0,0 +1,28 @@
+#ifndef NBTVALIDATOR_H
+#define NBTVALIDATOR_H
+
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QList>
+#include <QString>
+
+// ==================== NBT-JSON 结构校验 ====================
+// 校验 {name, value, type} 节点模型：类型码是否合法、value 的形状是否与类型匹配
+// （标量类型、数值范围、列表元素类型一致、复合标签的子节点结构），递归检查并报告节点路径。
+// 类型码：1 Byte, 2 Short, 3 Int, 4 Long, 5 Float, 6 Double, 7 ByteArray,
+//        8 String, 9 List, 10 Compound, 11 IntArray, 12 LongArray
+namespace NbtValidator {
+
+struct Issue {
+    QString path;      // 例如：buyA / CanPlaceOn / [1]
+    QString message;
+};
+
+// 校验一组复合标签子节点（例如物品的自定义节点数组）；最多返回 maxIssues 条问题
+QList<Issue> validateNodes(const QJsonArray &nodes, const QString &rootPath = QString(), int maxIssues = 20);
+
+QString formatIssue(const Issue &issue);
+
+} // namespace NbtValidator
+
+#endif // NBTVALIDATOR_H
@@ -0,0 +1,171 @@
+#ifndef PERSISTENTLIST_H
+#define PERSISTENTLIST_H
+
+#include <QList>
+#include <memory>
+#include <utility>
+
+// ==================== 持久化（结构共享）列表 ====================
+// 不可变的按下标访问的序列，内部是隐式键 treap。set / insert / removeAt 只复制从根到目标的
+// O(log n) 个节点并返回新列表，其余节点与元素在新旧版本之间共享，因此保存一个历史版本
+// 的代价是 O(log n) 个节点加上真正改变的那一个元素。
+template <typename T>
+class PersistentList
+{
+public:
+    PersistentList() = default;
+
+    static PersistentList fromList(const QList<T> &list)
+    {
+        PersistentList result;
+        result.m_root = build(list, 0, list.size(), 0);
+        return result;
+    }
+
+    qsizetype size() const { return sizeOf(m_root); }
+    bool isEmpty() const { return !m_root; }
+
+    const T &at(qsizetype i) const
+    {
+        const Node *n = m_root.get();
+        while (true) {
+            const qsizetype leftSize = sizeOf(n->left);
+            if (i < leftSize) {
+                n = n->left.get();
+            } else if (i == leftSize) {
+                return *n->value;
+            } else {
+                i -= leftSize + 1;
+                n = n->right.get();
+            }
+        }
+    }
+
+    PersistentList set(qsizetype i, const T &value) const
+    {
+        PersistentList result;
+        result.m_root = setAt(m_root, i, std::make_shared<const T>(value));
+        return result;
+    }
+
+    PersistentList insert(qsizetype i, const T &value) const
+    {
+        NodePtr left, right;
+        split(m_root, i, left, right);
+        NodePtr single = makeNode(nullptr, nullptr, std::make_shared<const T>(value), nextPriority());
+        PersistentList result;
+        result.m_root = merge(merge(left, single), right);
+        return result;
+    }
+
+    PersistentList append(const T &value) const { return insert(size(), value); }
+
+    PersistentList removeAt(qsizetype i) const
+    {
+        NodePtr left, right, removed, rest;
+        split(m_root, i, left, right);
+        split(right, 1, removed, rest);
+        PersistentList result;
+        result.m_root = merge(left, rest);
+        return result;
+    }
+
+    QList<T> toList() const
+    {
+        QList<T> list;
+        list.reserve(size());
+        appendTo(m_root.get(), list);
+        return list;
+    }
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+    using ValuePtr = std::shared_ptr<const T>;
+
+    struct Node {
+        NodePtr left;
+        NodePtr right;
+        ValuePtr value;
+        quint32 priority;
+        qsizetype size;
+    };
+
+    static qsizetype sizeOf(const NodePtr &n) { return n ? n->size : 0; }
+
+    static NodePtr makeNode(NodePtr left, NodePtr right, ValuePtr value, quint32 priority)
+    {
+        const qsizetype size = sizeOf(left) + sizeOf(right) + 1;
+        return std::make_shared<const Node>(Node{ std::move(left), std::move(right), std::move(value), priority, size });
+    }
+
+    // 确定性的伪随机优先级（splitmix32），保证 treap 的期望深度为 O(log n)
+    static quint32 nextPriority()
+    {
+        static thread_local quint32 state = 0x9E3779B9u;
+        quint32 z = (state += 0x9E3779B9u);
+        z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+        z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+        return z ^ (z >> 16);
+    }
+
+    // 从有序列表直接建出完全平衡的树；优先级随深度递减，满足堆性质
+    static NodePtr build(const QList<T> &list, qsizetype begin, qsizetype end, int depth)
+    {
+        if (begin >= end) return nullptr;
+        const qsizetype mid = begin + (end - begin) / 2;
+        const quint32 priority = 0xFFFFFFFFu - quint32(depth) * 0x01000000u;
+        NodePtr left = build(list, begin, mid, depth + 1);
+        NodePtr right = build(list, mid + 1, end, depth + 1);
+        return makeNode(std::move(left), std::move(right), std::make_shared<const T>(list[mid]), priority);
+    }
+
+    static NodePtr setAt(const NodePtr &n, qsizetype i, ValuePtr value)
+    {
+        const qsizetype leftSize = sizeOf(n->left);
+        if (i < leftSize) return makeNode(setAt(n->left, i, std::move(value)), n->right, n->value, n->priority);
+        if (i == leftSize) return makeNode(n->left, n->right, std::move(value), n->priority);
+        return makeNode(n->left, setAt(n->right, i - leftSize - 1, std::move(value)), n->value, n->priority);
+    }
+
+    // 前 k 个元素放入 left，其余放入 right
+    static void split(const NodePtr &n, qsizetype k, NodePtr &left, NodePtr &right)
+    {
+        if (!n) {
+            left = right = nullptr;
+            return;
+        }
+        const qsizetype leftSize = sizeOf(n->left);
+        if (k <= leftSize) {
+            NodePtr l, r;
+            split(n->left, k, l, r);
+            left = l;
+            right = makeNode(r, n->right, n->value, n->priority);
+        } else {
+            NodePtr l, r;
+            split(n->right, k - leftSize - 1, l, r);
+            left = makeNode(n->left, l, n->value, n->priority);
+            right = r;
+        }
+    }
+
+    static NodePtr merge(const NodePtr &a, const NodePtr &b)
+    {
+        if (!a) return b;
+        if (!b) return a;
+        if (a->priority >= b->priority) return makeNode(a->left, merge(a->right, b), a->value, a->priority);
+        return makeNode(merge(a, b->left), b->right, b->value, b->priority);
+    }
+
+    static void appendTo(const Node *n, QList<T> &list)
+    {
+        if (!n) return;
+        appendTo(n->left.get(), list);
+        list.append(*n->value);
+        appendTo(n->right.get(), list);
+    }
+
+    NodePtr m_root;
+};
+
+#endif // PERSISTENTLIST_H
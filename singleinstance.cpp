@@ -0,0 +1,120 @@
+#include "singleinstance.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <cstring>
+
+namespace {
+
+const int kConnectTimeoutMs = 500;
+const int kWriteTimeoutMs = 2000;
+const QDataStream::Version kStreamVersion = QDataStream::Qt_6_0;
+
+} // namespace
+
+bool SingleInstance::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--new-instance") == 0) return false;
+    }
+    return true;
+}
+
+QStringList SingleInstance::filesFromArguments(const QStringList &arguments)
+{
+    QStringList files;
+    for (const QString &argument : arguments.mid(1)) {
+        if (argument.startsWith('-')) continue;
+        files.append(QFileInfo(argument).absoluteFilePath());
+    }
+    return files;
+}
+
+QString SingleInstance::serverName()
+{
+    QString user = qEnvironmentVariable("USER");
+    if (user.isEmpty()) user = qEnvironmentVariable("USERNAME");
+    const QByteArray key = (user + '\n' + QCoreApplication::applicationFilePath()).toUtf8();
+    return "VillagerTradeEditor-" + QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex().left(16));
+}
+
+QString SingleInstance::lockFilePath()
+{
+    return QDir(QDir::tempPath()).filePath(serverName() + ".lock");
+}
+
+bool SingleInstance::forward(const QStringList &files)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(kConnectTimeoutMs)) return false;
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << files;
+    socket.write(data);
+    // 只等数据写出，不等对方处理：运行中的实例可能正忙于加载，请求会在它空闲后被读取
+    if (!socket.waitForBytesWritten(kWriteTimeoutMs)) {
+        qWarning().noquote() << "[单实例] 无法把文件交给运行中的实例：" << socket.errorString();
+        return false;
+    }
+    socket.disconnectFromServer();
+    if (socket.state() != QLocalSocket::UnconnectedState) socket.waitForDisconnected(kWriteTimeoutMs);
+    return true;
+}
+
+SingleInstance::SingleInstance(QObject *parent)
+    : QObject(parent)
+    , m_server(new QLocalServer(this))
+{
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &SingleInstance::onNewConnection);
+}
+
+bool SingleInstance::listen()
+{
+    const QString name = serverName();
+    if (m_server->listen(name)) return true;
+    // 名字被占用时重新连接一次：连得上说明另一个实例正在运行，不能删除它的套接字；
+    // 连不上才是上次异常退出留下的套接字文件。持有启动锁，期间不会有新实例开始监听
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(kConnectTimeoutMs)) {
+            probe.abort();
+            qWarning().noquote() << "[单实例] 已有实例在运行，本进程不再监听";
+            return false;
+        }
+        QLocalServer::removeServer(name);
+        if (m_server->listen(name)) return true;
+    }
+    qWarning().noquote() << "[单实例] 无法监听：" << m_server->errorString();
+    return false;
+}
+
+void SingleInstance::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readRequest(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        if (socket->bytesAvailable() > 0) readRequest(socket);
+    }
+}
+
+void SingleInstance::readRequest(QLocalSocket *socket)
+{
+    // 请求可能分几次到达，读不完整时等下一次 readyRead
+    QDataStream in(socket);
+    in.setVersion(kStreamVersion);
+    in.startTransaction();
+    QStringList files;
+    in >> files;
+    if (!in.commitTransaction()) return;
+    emit openRequested(files);
+}
@@ -0,0 +1,42 @@
+#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+class QLocalSocket;
+
+// ==================== 单实例 ====================
+// 第一个启动的进程在本地套接字（Windows 上是命名管道）上监听；之后的启动只把要打开的文件
+// 路径交给它就退出，由已运行的实例在同一进程的新窗口中打开，共用已加载的物品库。
+// 套接字名按用户与可执行文件区分，不同用户、不同安装的编辑器互不干扰。
+// 启动参数带 --new-instance 时不使用单实例（独立进程，便于对比或调试）。
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+
+public:
+    static bool isRequested(int argc, char *argv[]);
+    // 命令行中的文件参数，转换为绝对路径（运行中的实例工作目录不同）
+    static QStringList filesFromArguments(const QStringList &arguments);
+    // 交给运行中的实例；没有实例在运行时返回 false。files 为空表示只打开一个新窗口
+    static bool forward(const QStringList &files);
+    // 启动锁：调用方从 forward() 之前一直持有到 listen() 之后，同时启动的进程依次判断
+    static QString lockFilePath();
+
+    explicit SingleInstance(QObject *parent = nullptr);
+    bool listen();   // 须持有启动锁；已有实例在运行时返回 false
+
+signals:
+    void openRequested(const QStringList &files);
+
+private:
+    static QString serverName();
+    void onNewConnection();
+    void readRequest(QLocalSocket *socket);
+
+    QLocalServer *m_server;
+};
+
+#endif // SINGLEINSTANCE_H
@@ -0,0 +1,185 @@
+#include "stallwatchdog.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <algorithm>
+
+namespace {
+
+const qint64 kDefaultThresholdMs = 500;
+const qint64 kLogMaxSize = 256 * 1024;   // 超过后轮转
+const int kLogKeep = 2;                  // 保留 stalls.log.1、stalls.log.2
+
+QMutex g_logMutex;
+QElapsedTimer g_clock;   // 在构造时启动，之后只读
+
+QJsonObject toJson(const StallWatchdog::Entry &e)
+{
+    QJsonObject obj;
+    obj["start"] = e.start.toString(Qt::ISODateWithMs);
+    obj["durationMs"] = e.durationMs;
+    obj["stage"] = e.stage;
+    obj["villagers"] = e.villagers;
+    obj["trades"] = e.trades;
+    obj["ongoing"] = e.ongoing;
+    return obj;
+}
+
+StallWatchdog::Entry fromJson(const QJsonObject &obj)
+{
+    StallWatchdog::Entry e;
+    e.start = QDateTime::fromString(obj.value("start").toString(), Qt::ISODateWithMs);
+    e.durationMs = obj.value("durationMs").toInteger();
+    e.stage = obj.value("stage").toString();
+    e.villagers = obj.value("villagers").toInt();
+    e.trades = obj.value("trades").toInteger();
+    e.ongoing = obj.value("ongoing").toBool();
+    return e;
+}
+
+} // namespace
+
+std::atomic<const char *> StallWatchdog::s_stage { nullptr };
+std::atomic<int> StallWatchdog::s_villagers { 0 };
+std::atomic<qint64> StallWatchdog::s_trades { 0 };
+
+StallWatchdog::StallWatchdog(qint64 thresholdMs, QObject *parent)
+    : QObject(parent)
+    , m_thresholdMs(thresholdMs)
+{
+    if (m_thresholdMs <= 0) return;
+    if (!g_clock.isValid()) g_clock.start();
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("卡顿监视");
+    m_thread->start(QThread::LowPriority);
+}
+
+StallWatchdog::~StallWatchdog()
+{
+    if (!m_thread) return;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stop = true;
+        m_wake.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+}
+
+qint64 StallWatchdog::defaultThresholdMs()
+{
+    bool ok = false;
+    const qint64 ms = qEnvironmentVariable("VTE_STALL_MS").toLongLong(&ok);
+    return ok ? ms : kDefaultThresholdMs;
+}
+
+void StallWatchdog::setDocumentSize(int villagers, qint64 trades)
+{
+    s_villagers.store(villagers, std::memory_order_relaxed);
+    s_trades.store(trades, std::memory_order_relaxed);
+}
+
+QString StallWatchdog::logPath()
+{
+    return QCoreApplication::applicationDirPath() + "/diagnostics/stalls.log";
+}
+
+// 在主线程中执行：心跳被处理说明事件循环是通的
+void StallWatchdog::ping(quint64 seq)
+{
+    m_answeredAt.store(g_clock.elapsed(), std::memory_order_relaxed);
+    m_answered.store(seq, std::memory_order_release);
+}
+
+void StallWatchdog::run()
+{
+    // 检查间隔取阈值的四分之一，卡顿时长的误差不超过一个间隔
+    const unsigned long interval = qBound<qint64>(20, m_thresholdMs / 4, 250);
+    quint64 seq = 0;
+    qint64 sentAt = 0;
+    bool stalled = false;
+    Entry current;
+
+    while (true) {
+        {
+            QMutexLocker lock(&m_mutex);
+            if (!m_stop) m_wake.wait(&m_mutex, interval);
+            if (m_stop) break;
+        }
+
+        if (m_answered.load(std::memory_order_acquire) == seq) {
+            if (stalled) {
+                stalled = false;
+                current.durationMs = m_answeredAt.load(std::memory_order_relaxed) - sentAt;
+                current.ongoing = false;
+                append(current);
+                emit stallRecorded(current.stage, current.durationMs);
+            }
+            // 发出下一个心跳
+            ++seq;
+            sentAt = g_clock.elapsed();
+            QMetaObject::invokeMethod(this, [this, seq]() { ping(seq); }, Qt::QueuedConnection);
+            continue;
+        }
+
+        const qint64 waited = g_clock.elapsed() - sentAt;
+        if (!stalled && waited > m_thresholdMs) {
+            stalled = true;
+            const char *stage = s_stage.load(std::memory_order_relaxed);
+            current = Entry();
+            current.start = QDateTime::currentDateTime().addMSecs(-waited);
+            current.durationMs = waited;
+            current.stage = stage ? QString::fromUtf8(stage) : QString();
+            current.villagers = s_villagers.load(std::memory_order_relaxed);
+            current.trades = s_trades.load(std::memory_order_relaxed);
+            current.ongoing = true;
+            append(current);
+        }
+    }
+}
+
+void StallWatchdog::append(const Entry &entry)
+{
+    QMutexLocker lock(&g_logMutex);
+    const QString path = logPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    if (QFileInfo(path).size() > kLogMaxSize) {
+        QFile::remove(QString("%1.%2").arg(path).arg(kLogKeep));
+        for (int i = kLogKeep - 1; i >= 1; --i) {
+            QFile::rename(QString("%1.%2").arg(path).arg(i), QString("%1.%2").arg(path).arg(i + 1));
+        }
+        QFile::rename(path, path + ".1");
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) return;   // 写不了日志不影响使用
+    file.write(QJsonDocument(toJson(entry)).toJson(QJsonDocument::Compact) + '\n');
+}
+
+QList<StallWatchdog::Entry> StallWatchdog::readLog()
+{
+    QMutexLocker lock(&g_logMutex);
+    const QString path = logPath();
+    QHash<qint64, Entry> byStart;   // 开始记录与最终记录的 start 相同，后写的覆盖先写的
+    for (int i = kLogKeep; i >= 0; --i) {
+        QFile file(i == 0 ? path : QString("%1.%2").arg(path).arg(i));
+        if (!file.open(QIODevice::ReadOnly)) continue;
+        while (!file.atEnd()) {
+            const QJsonObject obj = QJsonDocument::fromJson(file.readLine()).object();
+            if (obj.isEmpty()) continue;
+            const Entry entry = fromJson(obj);
+            if (entry.start.isValid()) byStart.insert(entry.start.toMSecsSinceEpoch(), entry);
+        }
+    }
+
+    QList<Entry> entries = byStart.values();
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.start < b.start; });
+    return entries;
+}
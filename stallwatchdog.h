@@ -0,0 +1,87 @@
+#ifndef STALLWATCHDOG_H
+#define STALLWATCHDOG_H
+
+#include <QDateTime>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+
+class QThread;
+
+// ==================== 界面卡顿监视 ====================
+// 后台线程定期向主线程事件循环投递一个“心跳”，心跳超过阈值仍未被处理即视为卡顿。
+// 卡顿时记录主线程正在执行的阶段（由 StallWatchdog::Stage 标记）与当前文档大小，
+// 写入 applicationDirPath()/diagnostics/stalls.log（每行一个 JSON，超过大小后轮转）。
+// 卡顿开始时先写一条“进行中”的记录，这样即使最后被强制结束也能留下线索。
+class StallWatchdog : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        QDateTime start;
+        qint64 durationMs = 0;
+        QString stage;        // 卡顿时主线程所在的阶段；未标记的代码为空
+        int villagers = 0;
+        qint64 trades = 0;
+        bool ongoing = false;   // 只写了开始记录（卡顿尚未结束或进程被结束）
+    };
+
+    // 主线程上的阶段标记：构造时设为当前阶段，析构时恢复外层阶段。name 必须是字符串字面量。
+    // 进入模态对话框（exec）之前调用 end() 提前结束，否则对话框期间的卡顿都会记在这个阶段上
+    class Stage
+    {
+    public:
+        explicit Stage(const char *name) : m_previous(s_stage.exchange(name, std::memory_order_relaxed)) {}
+        ~Stage() { end(); }
+        Stage(const Stage &) = delete;
+        Stage &operator=(const Stage &) = delete;
+
+        void end()
+        {
+            if (m_ended) return;
+            m_ended = true;
+            s_stage.store(m_previous, std::memory_order_relaxed);
+        }
+
+    private:
+        const char *m_previous;
+        bool m_ended = false;
+    };
+
+    // thresholdMs 为 0 时不启动；默认阈值可用环境变量 VTE_STALL_MS 覆盖
+    explicit StallWatchdog(qint64 thresholdMs = defaultThresholdMs(), QObject *parent = nullptr);
+    ~StallWatchdog();
+
+    static qint64 defaultThresholdMs();
+    static void setDocumentSize(int villagers, qint64 trades);
+
+    static QString logPath();
+    // 读取日志（含轮转出的旧文件），按开始时间排序；同一次卡顿只保留最终记录
+    static QList<Entry> readLog();
+
+signals:
+    void stallRecorded(const QString &stage, qint64 durationMs);   // 在监视线程中发出，连接到界面时是排队连接
+
+private:
+    void run();
+    void ping(quint64 seq);
+    static void append(const Entry &entry);
+
+    qint64 m_thresholdMs;
+    QThread *m_thread = nullptr;
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+    bool m_stop = false;
+    std::atomic<quint64> m_answered { 0 };   // 主线程最近处理的心跳序号
+    std::atomic<qint64> m_answeredAt { 0 };  // 以及处理它的时间
+
+    static std::atomic<const char *> s_stage;
+    static std::atomic<int> s_villagers;
+    static std::atomic<qint64> s_trades;
+};
+
+#endif // STALLWATCHDOG_H
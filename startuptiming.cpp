@@ -0,0 +1,43 @@
+#include "startuptiming.h"
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QDebug>
+
+namespace {
+
+QElapsedTimer g_timer;
+qint64 g_lastNs = 0;
+bool g_enabled = false;
+QMutex g_mutex;   // 物品库就绪可能由工作线程完成后标记
+
+} // namespace
+
+namespace StartupTiming {
+
+void start()
+{
+    QMutexLocker lock(&g_mutex);
+    g_timer.start();
+    g_lastNs = 0;
+    g_enabled = qEnvironmentVariableIsSet("VTE_STARTUP_TIMING");
+}
+
+void mark(const char *phase)
+{
+    QMutexLocker lock(&g_mutex);
+    if (!g_enabled || !g_timer.isValid()) return;
+    const qint64 now = g_timer.nsecsElapsed();
+    qInfo().noquote() << QString("[启动] %1: 累计 %2 ms，本阶段 %3 ms")
+                             .arg(QString::fromUtf8(phase))
+                             .arg(now / 1e6, 0, 'f', 1)
+                             .arg((now - g_lastNs) / 1e6, 0, 'f', 1);
+    g_lastNs = now;
+}
+
+qint64 elapsedMs()
+{
+    QMutexLocker lock(&g_mutex);
+    return g_timer.isValid() ? g_timer.elapsed() : 0;
+}
+
+} // namespace StartupTiming
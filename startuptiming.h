@@ -0,0 +1,18 @@
+#ifndef STARTUPTIMING_H
+#define STARTUPTIMING_H
+
+#include <QtGlobal>
+
+// ==================== 启动阶段计时 ====================
+// 在 main() 开始时调用 start()，之后每个阶段调用 mark()，输出距启动的累计时间和本阶段耗时，
+// 用于确认窗口出现时间不受物品库大小影响。只有设置了环境变量 VTE_STARTUP_TIMING 时才输出，
+// 物品库只在第一次加载完成时标记，之后的重新加载不再输出。
+namespace StartupTiming {
+
+void start();
+void mark(const char *phase);
+qint64 elapsedMs();
+
+} // namespace StartupTiming
+
+#endif // STARTUPTIMING_H
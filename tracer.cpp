@@ -0,0 +1,178 @@
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace {
+
+const int kRingCapacity = 1 << 16;   // 每个线程保留最近的 65536 段
+
+struct Event {
+    const char *name;
+    qint64 begin;
+    qint64 duration;
+};
+
+const size_t kRetiredKept = 4;   // 保留最近退出的几个线程的记录，更早的缓冲区给新线程复用
+
+// 每个线程一个环形缓冲区。锁只在本线程写入与导出 / 清空时竞争，平时没有争用
+struct Ring {
+    QMutex mutex;
+    std::vector<Event> events;
+    quint64 written = 0;   // 累计写入数；超过容量后从头覆盖
+    int tid = 0;
+    QString threadName;
+};
+
+std::atomic<bool> g_enabled { false };
+QMutex g_ringsMutex;
+std::vector<std::shared_ptr<Ring>> g_rings;      // 线程退出后缓冲区仍保留，导出时可见
+std::deque<std::shared_ptr<Ring>> g_retired;     // 线程已退出的缓冲区，按退出顺序
+int g_nextTid = 1;
+
+// 线程池的线程空闲 30 秒后退出、需要时再创建，每个文档还有自己的预览线程池。
+// 线程退出时把缓冲区放回 g_retired，新线程优先复用最早退出的那个，总数不随线程的更替增长
+struct RingOwner {
+    std::shared_ptr<Ring> ring;
+    ~RingOwner()
+    {
+        if (!ring) return;
+        QMutexLocker lock(&g_ringsMutex);
+        g_retired.push_back(ring);
+    }
+};
+
+const QElapsedTimer &clock()
+{
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+    return timer;
+}
+
+Ring &threadRing()
+{
+    thread_local RingOwner owner;
+    if (!owner.ring) {
+        QThread *thread = QThread::currentThread();
+        const bool isMain = QCoreApplication::instance() && thread == QCoreApplication::instance()->thread();
+        QMutexLocker lock(&g_ringsMutex);
+        if (g_retired.size() > kRetiredKept) {
+            owner.ring = g_retired.front();   // 丢弃最早退出的线程的记录
+            g_retired.pop_front();
+        } else {
+            owner.ring = std::make_shared<Ring>();
+            owner.ring->events.resize(kRingCapacity);
+            g_rings.push_back(owner.ring);
+        }
+        Ring &ring = *owner.ring;
+        QMutexLocker ringLock(&ring.mutex);
+        ring.written = 0;
+        ring.tid = g_nextTid++;
+        ring.threadName = isMain ? QString("主线程")
+                        : !thread->objectName().isEmpty() ? thread->objectName()
+                        : QString("工作线程 %1").arg(ring.tid);
+    }
+    return *owner.ring;
+}
+
+// 名称都是源码中的字面量，只需处理引号与反斜杠
+QByteArray jsonString(const QString &s)
+{
+    QByteArray out = s.toUtf8();
+    out.replace('\\', "\\\\").replace('"', "\\\"");
+    return '"' + out + '"';
+}
+
+} // namespace
+
+namespace Tracer {
+
+void setEnabled(bool on)
+{
+    if (on) {
+        QMutexLocker lock(&g_ringsMutex);
+        for (const std::shared_ptr<Ring> &ring : g_rings) {
+            QMutexLocker ringLock(&ring->mutex);
+            ring->written = 0;
+        }
+    }
+    g_enabled.store(on, std::memory_order_relaxed);
+}
+
+bool isEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+qint64 now()
+{
+    return clock().nsecsElapsed();
+}
+
+void record(const char *name, qint64 beginNs)
+{
+    const qint64 end = now();
+    Ring &ring = threadRing();
+    QMutexLocker lock(&ring.mutex);
+    ring.events[ring.written % kRingCapacity] = Event{ name, beginNs, end - beginNs };
+    ++ring.written;
+}
+
+bool writeChromeTrace(const QString &path, QString *error)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        QMutexLocker lock(&g_ringsMutex);
+        rings = g_rings;
+    }
+
+    // 时间单位为微秒；"X" 为带时长的完整事件，"M" 给线程命名
+    file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const std::shared_ptr<Ring> &ring : rings) {
+        QMutexLocker lock(&ring->mutex);
+        QByteArray chunk;
+        chunk += first ? "" : ",\n";
+        first = false;
+        chunk += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + QByteArray::number(ring->tid)
+               + ",\"args\":{\"name\":" + jsonString(ring->threadName) + "}}";
+
+        const quint64 count = qMin<quint64>(ring->written, kRingCapacity);
+        for (quint64 i = ring->written - count; i < ring->written; ++i) {
+            const Event &e = ring->events[i % kRingCapacity];
+            chunk += ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(ring->tid)
+                   + ",\"name\":" + jsonString(QString::fromUtf8(e.name))
+                   + ",\"ts\":" + QByteArray::number(e.begin / 1000.0, 'f', 3)
+                   + ",\"dur\":" + QByteArray::number(e.duration / 1000.0, 'f', 3) + "}";
+            if (chunk.size() > (1 << 16)) {
+                file.write(chunk);
+                chunk.clear();
+            }
+        }
+        file.write(chunk);
+    }
+    file.write("\n]}\n");
+
+    if (!file.commit()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace Tracer
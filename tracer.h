@@ -0,0 +1,46 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QtGlobal>
+
+// ==================== 热路径追踪 ====================
+// 作用域计时：在函数开头写 VTE_TRACE("名称")，离开作用域时记录一段 [开始, 结束]。
+// 运行时开关；关闭时每个作用域只多一次原子读取。记录写入每个线程自己的环形缓冲区
+// （写满后覆盖最早的记录；已退出线程的缓冲区只保留最近几个，其余由新线程复用），导出为 Chrome / Perfetto 可以打开的 trace JSON，
+// 用来在时间线上查看一次输入到预览刷新的完整过程。
+namespace Tracer {
+
+void setEnabled(bool on);   // 开启时清空之前的记录
+bool isEnabled();
+
+// 把所有线程的记录写成 Chrome trace 事件格式（chrome://tracing、ui.perfetto.dev）
+bool writeChromeTrace(const QString &path, QString *error = nullptr);
+
+qint64 now();   // 距进程内追踪时钟起点的纳秒数
+void record(const char *name, qint64 beginNs);
+
+class Span
+{
+public:
+    // name 必须是字符串字面量（只保存指针，导出时才读取）
+    explicit Span(const char *name) : m_name(name), m_begin(isEnabled() ? now() : -1) {}
+    ~Span()
+    {
+        if (m_begin >= 0) record(m_name, m_begin);
+    }
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+private:
+    const char *m_name;
+    qint64 m_begin;
+};
+
+} // namespace Tracer
+
+#define VTE_TRACE_CAT2(a, b) a##b
+#define VTE_TRACE_CAT(a, b) VTE_TRACE_CAT2(a, b)
+#define VTE_TRACE(name) Tracer::Span VTE_TRACE_CAT(vteTraceSpan, __LINE__)(name)
+
+#endif // TRACER_H
@@ -0,0 +1,76 @@
+#ifndef TRADEDATA_H
+#define TRADEDATA_H
+
+#include <QString>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QList>
+
+// ==================== 数据模型 ====================
+struct ItemData {
+    QString name = "minecraft:air";
+    int count = 1;
+    int damage = 0;
+
+    // Tag 字段
+    bool enableName = false;
+    QString displayName = "自定义名称";
+    bool enableLore = false;
+    QString lore = "自定义注释";
+    bool enableEnch = false;
+    int enchId = 9;
+    int enchLevel = 5;
+
+    // 新增：自定义 NBT 节点
+    bool enableCustom = false;
+    QJsonArray customNodes;   // 存储自定义节点数组，每个元素是完整的 {name,value,type}
+
+    // 懒解析：载入时只读出 name / count / damage，其余内容保留为原始物品节点（与文档共享，不复制）。
+    // 非空时 Tag 与自定义节点字段尚未展开，读取它们之前先用 NbtCodec::materialized 展开
+    QJsonArray pendingNodes;
+};
+
+struct TradeOption {
+    ItemData buyA;
+    ItemData buyB;
+    ItemData sell;
+    int uses = 0;
+    int maxUses = 12;
+    int tier = 0;
+};
+
+// 结构中的一个村民实体
+struct VillagerData {
+    QList<TradeOption> trades;
+    QString profession = "cartographer";   // 不带 '+'
+    int markVariant = 0;
+    int entityIndex = -1;   // 在原文件 entities 列表中的位置；-1 表示没有原始实体，保存时使用内置模板
+};
+
+// 一个结构文件：原始文档（保存时只替换各村民的交易、职业与变种，其余内容原样保留）与其中的村民
+struct VillagerDocument {
+    QJsonDocument source;   // 为空时按内置模板生成单个村民
+    QList<VillagerData> villagers;
+};
+
+// 逐字段比较，未展开的物品直接比较原始节点（不展开）。同样的内容一方已展开、一方未展开时不相等；
+// 需要按内容判断时用 NbtCodec::sameContent
+inline bool operator==(const ItemData &a, const ItemData &b)
+{
+    return a.name == b.name && a.count == b.count && a.damage == b.damage
+        && a.enableName == b.enableName && a.displayName == b.displayName
+        && a.enableLore == b.enableLore && a.lore == b.lore
+        && a.enableEnch == b.enableEnch && a.enchId == b.enchId && a.enchLevel == b.enchLevel
+        && a.enableCustom == b.enableCustom && a.customNodes == b.customNodes
+        && a.pendingNodes == b.pendingNodes;
+}
+inline bool operator!=(const ItemData &a, const ItemData &b) { return !(a == b); }
+
+inline bool operator==(const TradeOption &a, const TradeOption &b)
+{
+    return a.buyA == b.buyA && a.buyB == b.buyB && a.sell == b.sell
+        && a.uses == b.uses && a.maxUses == b.maxUses && a.tier == b.tier;
+}
+inline bool operator!=(const TradeOption &a, const TradeOption &b) { return !(a == b); }
+
+#endif // TRADEDATA_H
@@ -0,0 +1,170 @@
+#include "tradefields.h"
+#include "nbtcodec.h"
+#include <QJsonValue>
+
+namespace {
+
+const char *const kSlotNames[] = { "buyA", "buyB", "sell" };
+const char *const kItemFieldNames[] = {
+    "name", "count", "damage",
+    "enableName", "displayName", "enableLore", "lore",
+    "enableEnch", "enchId", "enchLevel",
+    "enableCustom", "customNodes",
+};
+const char *const kTradeFieldNames[] = { "uses", "maxUses", "tier" };
+
+ItemData &itemOf(TradeOption &t, int slot)
+{
+    return slot == TradeFields::BuyA ? t.buyA : slot == TradeFields::BuyB ? t.buyB : t.sell;
+}
+
+const ItemData &itemOf(const TradeOption &t, int slot)
+{
+    return slot == TradeFields::BuyA ? t.buyA : slot == TradeFields::BuyB ? t.buyB : t.sell;
+}
+
+// 载入时就已解析的字段，读写它们不需要展开物品
+bool isSummary(int f)
+{
+    return f == TradeFields::Name || f == TradeFields::Count || f == TradeFields::Damage;
+}
+
+QVariant itemValue(const ItemData &d, int f)
+{
+    using namespace TradeFields;
+    switch (f) {
+    case Name: return d.name;
+    case Count: return d.count;
+    case Damage: return d.damage;
+    case EnableName: return d.enableName;
+    case DisplayName: return d.displayName;
+    case EnableLore: return d.enableLore;
+    case Lore: return d.lore;
+    case EnableEnch: return d.enableEnch;
+    case EnchId: return d.enchId;
+    case EnchLevel: return d.enchLevel;
+    case EnableCustom: return d.enableCustom;
+    case CustomNodes: return QVariant::fromValue(d.customNodes);
+    }
+    return QVariant();
+}
+
+bool toInt(const QVariant &v, int &out)
+{
+    bool ok = false;
+    const int i = v.toInt(&ok);
+    if (ok) out = i;
+    return ok;
+}
+
+} // namespace
+
+namespace TradeFields {
+
+QString path(int field)
+{
+    if (field >= 0 && field < Uses) {
+        return QString::fromLatin1(kSlotNames[field / ItemFieldCount]) + '.'
+             + QString::fromLatin1(kItemFieldNames[field % ItemFieldCount]);
+    }
+    if (field >= Uses && field < FieldCount) return QString::fromLatin1(kTradeFieldNames[field - Uses]);
+    return QString();
+}
+
+int fieldByPath(const QString &p)
+{
+    for (int f = 0; f < FieldCount; ++f) {
+        if (path(f).compare(p, Qt::CaseInsensitive) == 0) return f;
+    }
+    return -1;
+}
+
+bool isNumeric(int field)
+{
+    if (field >= Uses) return field < FieldCount;
+    switch (field % ItemFieldCount) {
+    case Count: case Damage: case EnchId: case EnchLevel: return true;
+    default: return false;
+    }
+}
+
+bool isText(int field)
+{
+    if (field < 0 || field >= Uses) return false;
+    switch (field % ItemFieldCount) {
+    case Name: case DisplayName: case Lore: return true;
+    default: return false;
+    }
+}
+
+QVariant value(const TradeOption &trade, int field)
+{
+    switch (field) {
+    case Uses: return trade.uses;
+    case MaxUses: return trade.maxUses;
+    case Tier: return trade.tier;
+    default: break;
+    }
+    if (field < 0 || field >= Uses) return QVariant();
+
+    const ItemData &item = itemOf(trade, field / ItemFieldCount);
+    const int f = field % ItemFieldCount;
+    // 摘要字段之外的值可能还在未展开的原始节点里
+    if (isSummary(f) || item.pendingNodes.isEmpty()) return itemValue(item, f);
+    return itemValue(NbtCodec::materialized(item), f);
+}
+
+bool setValue(TradeOption &trade, int field, const QVariant &v)
+{
+    switch (field) {
+    case Uses: return toInt(v, trade.uses);
+    case MaxUses: return toInt(v, trade.maxUses);
+    case Tier: return toInt(v, trade.tier);
+    default: break;
+    }
+    if (field < 0 || field >= Uses) return false;
+
+    ItemData &d = itemOf(trade, field / ItemFieldCount);
+    const int f = field % ItemFieldCount;
+    if (!isSummary(f) && !d.pendingNodes.isEmpty()) d = NbtCodec::materialized(d);
+    switch (f) {
+    case Name: d.name = v.toString(); return true;
+    case Count: return toInt(v, d.count);
+    case Damage: return toInt(v, d.damage);
+    case EnableName: d.enableName = v.toBool(); return true;
+    case DisplayName: d.displayName = v.toString(); return true;
+    case EnableLore: d.enableLore = v.toBool(); return true;
+    case Lore: d.lore = v.toString(); return true;
+    case EnableEnch: d.enableEnch = v.toBool(); return true;
+    case EnchId: return toInt(v, d.enchId);
+    case EnchLevel: return toInt(v, d.enchLevel);
+    case EnableCustom: d.enableCustom = v.toBool(); return true;
+    case CustomNodes: {
+        const QJsonValue json = QJsonValue::fromVariant(v);
+        if (!json.isArray()) return false;
+        d.customNodes = json.toArray();
+        return true;
+    }
+    }
+    return false;
+}
+
+QList<int> changedFields(const TradeOption &a, const TradeOption &b)
+{
+    QList<int> fields;
+    for (int slot = 0; slot < SlotCount; ++slot) {
+        if (itemOf(a, slot) == itemOf(b, slot)) continue;   // 大多数修改只涉及一个物品
+        // 每个物品只展开一次，而不是每个字段各展开一次
+        const ItemData ia = NbtCodec::materialized(itemOf(a, slot));
+        const ItemData ib = NbtCodec::materialized(itemOf(b, slot));
+        for (int f = 0; f < ItemFieldCount; ++f) {
+            if (itemValue(ia, f) != itemValue(ib, f)) fields.append(slot * ItemFieldCount + f);
+        }
+    }
+    for (int f = Uses; f < FieldCount; ++f) {
+        if (value(a, f) != value(b, f)) fields.append(f);
+    }
+    return fields;
+}
+
+} // namespace TradeFields
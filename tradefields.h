@@ -0,0 +1,49 @@
+#ifndef TRADEFIELDS_H
+#define TRADEFIELDS_H
+
+#include <QList>
+#include <QString>
+#include <QVariant>
+#include "tradedata.h"
+
+// ==================== 交易字段寻址 ====================
+// 给 TradeOption 的每个可编辑字段一个稳定的编号和路径名（例如 "buyA.count"、"tier"），
+// 以便按字段读写、比较差异。编号写入编辑日志，只能追加，不能调整已有的值。
+namespace TradeFields {
+
+enum ItemField {
+    Name, Count, Damage,
+    EnableName, DisplayName, EnableLore, Lore,
+    EnableEnch, EnchId, EnchLevel,
+    EnableCustom, CustomNodes,
+    ItemFieldCount
+};
+
+enum Slot { BuyA, BuyB, Sell, SlotCount };
+
+// 物品字段编号 = slot * ItemFieldCount + ItemField，之后是交易本身的字段
+enum Field {
+    Uses = SlotCount * ItemFieldCount,
+    MaxUses,
+    Tier,
+    FieldCount
+};
+
+inline int itemField(Slot slot, ItemField f) { return slot * ItemFieldCount + f; }
+
+QString path(int field);              // "buyA.count"、"uses"……
+int fieldByPath(const QString &path);  // 不区分大小写；未知路径返回 -1
+bool isNumeric(int field);             // 整数字段（数量、Damage、附魔、次数、Tier）
+bool isText(int field);                // 字符串字段（物品名、显示名、Lore）
+
+// 字段值：整数字段为 int，布尔为 bool，字符串为 QString，自定义节点为 QJsonArray
+QVariant value(const TradeOption &trade, int field);
+// 写入字段；值无法转换时返回 false。自定义节点也接受 QVariantList（例如从 CBOR 读回）
+bool setValue(TradeOption &trade, int field, const QVariant &v);
+
+// 两条交易中值不同的字段
+QList<int> changedFields(const TradeOption &a, const TradeOption &b);
+
+} // namespace TradeFields
+
+#endif // TRADEFIELDS_H
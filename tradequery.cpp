@@ -0,0 +1,396 @@
+#include "tradequery.h"
+#include "nbtcodec.h"
+#include "tracer.h"
+#include "tradefields.h"
+#include <QJsonObject>
+#include <QtConcurrent/QtConcurrentMap>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+const qsizetype kParallelThreshold = 512;   // 交易数达到这个值时按交易并行求值
+
+using Value = std::function<QVariant(const TradeOption &)>;
+using Predicate = std::function<bool(const TradeOption &)>;
+
+struct Token {
+    enum Kind { End, Ident, Number, String, Op, LParen, RParen };
+    Kind kind = End;
+    QString text;
+    int pos = 0;
+};
+
+bool isIdentStart(QChar c) { return c.isLetter() || c == '_'; }
+bool isIdentChar(QChar c) { return c.isLetterOrNumber() || c == '_' || c == '.' || c == ':'; }
+
+bool tokenize(const QString &s, QList<Token> &tokens, QString &error)
+{
+    static const char *const kOps[] = { "==", "!=", "<=", ">=", "!~", "&&", "||", "=", "<", ">", "~", "!" };
+    int i = 0;
+    while (i < s.size()) {
+        const QChar c = s[i];
+        if (c.isSpace()) { ++i; continue; }
+        Token t;
+        t.pos = i;
+        // 负号紧跟数字、且前面不是操作数时是数值的一部分
+        const bool afterOperand = !tokens.isEmpty()
+            && (tokens.last().kind == Token::Ident || tokens.last().kind == Token::Number
+                || tokens.last().kind == Token::String || tokens.last().kind == Token::RParen);
+        if (c.isDigit() || (c == '-' && !afterOperand && i + 1 < s.size() && s[i + 1].isDigit())) {
+            int j = i + 1;
+            while (j < s.size() && (s[j].isDigit() || s[j] == '.')) ++j;
+            t.kind = Token::Number;
+            t.text = s.mid(i, j - i);
+            i = j;
+        } else if (isIdentStart(c)) {
+            int j = i + 1;
+            while (j < s.size() && isIdentChar(s[j])) ++j;
+            t.text = s.mid(i, j - i);
+            i = j;
+            const QString lower = t.text.toLower();
+            if (lower == "and") { t.kind = Token::Op; t.text = "&&"; }
+            else if (lower == "or") { t.kind = Token::Op; t.text = "||"; }
+            else if (lower == "not") { t.kind = Token::Op; t.text = "!"; }
+            else t.kind = Token::Ident;
+        } else if (c == '"' || c == '\'') {
+            int j = i + 1;
+            while (j < s.size() && s[j] != c) {
+                if (s[j] == '\\' && j + 1 < s.size()) ++j;
+                t.text += s[j++];
+            }
+            if (j >= s.size()) {
+                error = QString("位置 %1：字符串没有结束").arg(i + 1);
+                return false;
+            }
+            t.kind = Token::String;
+            i = j + 1;
+        } else if (c == '(' || c == ')') {
+            t.kind = c == '(' ? Token::LParen : Token::RParen;
+            t.text = c;
+            ++i;
+        } else {
+            for (const char *op : kOps) {
+                const QLatin1String candidate(op);
+                if (QStringView(s).mid(i).startsWith(candidate)) {
+                    t.kind = Token::Op;
+                    t.text = candidate;
+                    i += candidate.size();
+                    break;
+                }
+            }
+            if (t.kind != Token::Op) {
+                error = QString("位置 %1：无法识别的字符“%2”").arg(i + 1).arg(c);
+                return false;
+            }
+        }
+        tokens.append(t);
+    }
+    Token end;
+    end.pos = s.size();
+    tokens.append(end);
+    return true;
+}
+
+bool toNumber(const QVariant &v, double &out)
+{
+    switch (v.metaType().id()) {
+    case QMetaType::Bool: out = v.toBool() ? 1 : 0; return true;
+    case QMetaType::Int: case QMetaType::UInt: case QMetaType::LongLong:
+    case QMetaType::ULongLong: case QMetaType::Double: out = v.toDouble(); return true;
+    case QMetaType::QString: {
+        bool ok = false;
+        out = v.toString().toDouble(&ok);
+        return ok;
+    }
+    default: return false;
+    }
+}
+
+bool truthy(const QVariant &v)
+{
+    if (!v.isValid()) return false;
+    double n = 0;
+    if (v.metaType().id() != QMetaType::QString && toNumber(v, n)) return n != 0;
+    if (v.metaType().id() == QMetaType::QVariantList) return !v.toList().isEmpty();
+    if (v.metaType().id() == QMetaType::QVariantMap) return !v.toMap().isEmpty();
+    return !v.toString().isEmpty();
+}
+
+bool compare(const QString &op, const QVariant &a, const QVariant &b)
+{
+    if (op == "~") return a.toString().contains(b.toString(), Qt::CaseInsensitive);
+    if (op == "!~") return !a.toString().contains(b.toString(), Qt::CaseInsensitive);
+    int c = 0;
+    double x = 0, y = 0;
+    if (toNumber(a, x) && toNumber(b, y)) {
+        c = x < y ? -1 : x > y ? 1 : 0;
+    } else {
+        c = QString::compare(a.toString(), b.toString(), Qt::CaseInsensitive);
+    }
+    if (op == "==" || op == "=") return c == 0;
+    if (op == "!=") return c != 0;
+    if (op == "<") return c < 0;
+    if (op == "<=") return c <= 0;
+    if (op == ">") return c > 0;
+    return c >= 0;   // ">="
+}
+
+bool isComparison(const Token &t)
+{
+    static const QStringList kComparisons = { "==", "=", "!=", "<", "<=", ">", ">=", "~", "!~" };
+    return t.kind == Token::Op && kComparisons.contains(t.text);
+}
+
+int slotByName(const QString &name)
+{
+    static const char *const kSlots[] = { "buyA", "buyB", "sell" };
+    for (int slot = 0; slot < TradeFields::SlotCount; ++slot) {
+        if (name.compare(QLatin1String(kSlots[slot]), Qt::CaseInsensitive) == 0) return slot;
+    }
+    return -1;
+}
+
+const ItemData &itemOf(const TradeOption &t, int slot)
+{
+    return slot == TradeFields::BuyA ? t.buyA : slot == TradeFields::BuyB ? t.buyB : t.sell;
+}
+
+// 物品中名为 name 的自定义节点的值；没有这个节点时返回无效值
+QVariant customValue(const ItemData &item, const QString &name)
+{
+    const QJsonArray nodes = item.pendingNodes.isEmpty() ? item.customNodes : NbtCodec::materialized(item).customNodes;
+    for (const QJsonValue &node : nodes) {
+        const QJsonObject obj = node.toObject();
+        if (obj.value("name").toString() == name) {
+            const QVariant value = obj.value("value").toVariant();
+            return value.isValid() ? value : QVariant(true);   // 没有值的节点按“存在”处理
+        }
+    }
+    return QVariant();
+}
+
+class Parser
+{
+public:
+    explicit Parser(const QList<Token> &tokens) : m_tokens(tokens) {}
+
+    Predicate parse(QString &error)
+    {
+        Predicate result = orExpr();
+        if (m_error.isEmpty() && peek().kind != Token::End) fail(QString("多余的“%1”").arg(peek().text));
+        error = m_error;
+        return m_error.isEmpty() ? result : Predicate();
+    }
+
+private:
+    // 操作数：字段、自定义节点或字面量；bareword 表示没有加引号、也不是字段的单词
+    struct Operand {
+        Value value;
+        bool field = false;
+        bool bareword = false;
+        QString text;
+        int pos = 0;
+    };
+
+    const Token &peek() const { return m_tokens[m_index]; }
+    Token next()
+    {
+        const Token t = peek();
+        if (t.kind != Token::End) ++m_index;
+        return t;
+    }
+    bool acceptOp(const char *op)
+    {
+        if (peek().kind != Token::Op || peek().text != QLatin1String(op)) return false;
+        ++m_index;
+        return true;
+    }
+    // pos 为 -1 时指向下一个记号
+    void fail(const QString &message, int pos = -1)
+    {
+        if (m_error.isEmpty()) m_error = QString("位置 %1：%2").arg((pos < 0 ? peek().pos : pos) + 1).arg(message);
+    }
+
+    Predicate orExpr()
+    {
+        Predicate left = andExpr();
+        while (m_error.isEmpty() && acceptOp("||")) {
+            Predicate right = andExpr();
+            left = [left, right](const TradeOption &t) { return left(t) || right(t); };
+        }
+        return left;
+    }
+
+    Predicate andExpr()
+    {
+        Predicate left = notExpr();
+        while (m_error.isEmpty() && acceptOp("&&")) {
+            Predicate right = notExpr();
+            left = [left, right](const TradeOption &t) { return left(t) && right(t); };
+        }
+        return left;
+    }
+
+    Predicate notExpr()
+    {
+        if (acceptOp("!")) {
+            Predicate inner = notExpr();
+            return [inner](const TradeOption &t) { return !inner(t); };
+        }
+        return primary();
+    }
+
+    Predicate primary()
+    {
+        if (peek().kind == Token::LParen) {
+            next();
+            Predicate inner = orExpr();
+            if (peek().kind != Token::RParen) {
+                fail("缺少“)”");
+                return Predicate();
+            }
+            next();
+            return inner;
+        }
+
+        Operand left;
+        if (!operand(left)) return Predicate();
+        if (isComparison(peek())) {
+            const QString op = next().text;
+            Operand right;
+            if (!operand(right)) return Predicate();
+            const Value a = left.value, b = right.value;
+            return [op, a, b](const TradeOption &t) { return compare(op, a(t), b(t)); };
+        }
+        if (!left.field) {
+            fail(left.bareword ? QString("未知的字段“%1”").arg(left.text) : QString("“%1”之后缺少比较运算符").arg(left.text),
+                 left.bareword ? left.pos : -1);
+            return Predicate();
+        }
+        const Value value = left.value;
+        return [value](const TradeOption &t) { return truthy(value(t)); };
+    }
+
+    bool operand(Operand &out)
+    {
+        const Token t = peek();
+        out.text = t.text;
+        out.pos = t.pos;
+        if (t.kind == Token::Number) {
+            next();
+            bool ok = false;
+            const double n = t.text.toDouble(&ok);
+            if (!ok) {
+                fail(QString("无效的数值“%1”").arg(t.text), t.pos);
+                return false;
+            }
+            out.value = [n](const TradeOption &) { return QVariant(n); };
+            return true;
+        }
+        if (t.kind == Token::String) {
+            next();
+            const QString text = t.text;
+            out.value = [text](const TradeOption &) { return QVariant(text); };
+            return true;
+        }
+        if (t.kind != Token::Ident) {
+            fail(t.kind == Token::End ? QString("表达式不完整") : QString("这里需要字段或值，而不是“%1”").arg(t.text));
+            return false;
+        }
+        next();
+
+        const QString lower = t.text.toLower();
+        if (lower == "true" || lower == "false") {
+            const bool b = lower == "true";
+            out.value = [b](const TradeOption &) { return QVariant(b); };
+            return true;
+        }
+        const int field = TradeFields::fieldByPath(t.text);
+        if (field >= 0) {
+            out.field = true;
+            out.value = [field](const TradeOption &trade) { return TradeFields::value(trade, field); };
+            return true;
+        }
+
+        // 自定义节点：<物品>.custom.<名称> 或 custom.<名称>（任一物品）
+        const QStringList parts = t.text.split('.');
+        const int slot = slotByName(parts.first());
+        if (parts.size() >= 3 && slot >= 0 && parts[1].compare("custom", Qt::CaseInsensitive) == 0) {
+            const QString name = parts.mid(2).join('.');
+            out.field = true;
+            out.value = [slot, name](const TradeOption &trade) { return customValue(itemOf(trade, slot), name); };
+            return true;
+        }
+        if (parts.size() >= 2 && parts.first().compare("custom", Qt::CaseInsensitive) == 0) {
+            const QString name = parts.mid(1).join('.');
+            out.field = true;
+            out.value = [name](const TradeOption &trade) {
+                for (int s = 0; s < TradeFields::SlotCount; ++s) {
+                    const QVariant v = customValue(itemOf(trade, s), name);
+                    if (v.isValid()) return v;
+                }
+                return QVariant();
+            };
+            return true;
+        }
+        // 看起来像字段路径却对不上时报错，避免拼错的字段被当成文本而悄悄不匹配
+        if (parts.size() >= 2 && slot >= 0) {
+            fail(QString("未知的字段“%1”").arg(t.text), t.pos);
+            return false;
+        }
+
+        // 其余的单词当作文本，例如 minecraft:diamond
+        out.bareword = true;
+        const QString text = t.text;
+        out.value = [text](const TradeOption &) { return QVariant(text); };
+        return true;
+    }
+
+    const QList<Token> &m_tokens;
+    qsizetype m_index = 0;
+    QString m_error;
+};
+
+} // namespace
+
+TradeQuery TradeQuery::compile(const QString &text, QString *error)
+{
+    TradeQuery query;
+    query.m_text = text.trimmed();
+    if (query.m_text.isEmpty()) return query;
+
+    QList<Token> tokens;
+    QString message;
+    if (tokenize(query.m_text, tokens, message)) {
+        query.m_predicate = Parser(tokens).parse(message);
+    }
+    if (!message.isEmpty()) {
+        query.m_valid = false;
+        query.m_predicate = nullptr;
+        if (error) *error = message;
+    }
+    return query;
+}
+
+QList<bool> TradeQuery::matchAll(const QList<TradeOption> &trades, qsizetype from) const
+{
+    VTE_TRACE("TradeQuery::matchAll");
+    const qsizetype count = qMax<qsizetype>(0, trades.size() - from);
+    std::vector<char> flags(count, 1);
+    if (m_predicate && count > 0) {
+        const TradeOption *data = trades.constData() + from;
+        auto run = [&](qsizetype i) { flags[i] = m_predicate(data[i]); };
+        if (count < kParallelThreshold) {
+            for (qsizetype i = 0; i < count; ++i) run(i);
+        } else {
+            std::vector<qsizetype> indices(count);
+            std::iota(indices.begin(), indices.end(), 0);
+            QtConcurrent::blockingMap(indices, run);
+        }
+    }
+    QList<bool> result;
+    result.reserve(count);
+    for (char flag : flags) result.append(flag != 0);
+    return result;
+}
@@ -0,0 +1,39 @@
+#ifndef TRADEQUERY_H
+#define TRADEQUERY_H
+
+#include <QList>
+#include <QString>
+#include <functional>
+#include "tradedata.h"
+
+// ==================== 交易筛选表达式 ====================
+// 一个小型表达式语言，编译一次得到谓词，之后对每条交易求值：
+//   字段      TradeFields 的路径，如 sell.name、buyA.count、tier、sell.enableEnch
+//   自定义节点 sell.custom.CanPlaceOn（该物品的同名节点的值）、custom.Unbreakable（任一物品）
+//   字面量    123、1.5、"文本"、'文本'、true、false；比较的右侧也可以直接写 minecraft:diamond
+//   比较      == (=)  !=  <  <=  >  >=  ~（包含，不区分大小写）  !~（不包含）
+//   逻辑      && (and)  || (or)  ! (not)  以及括号
+// 两侧都能转换成数值时按数值比较，否则按字符串比较（不区分大小写）。
+// 单独出现的字段或节点按“真值”判断：布尔为真、数值非零、文本或列表非空、节点存在。
+// 例：sell.enableEnch && tier > 2 && (buyA.name ~ diamond || buyB.name ~ diamond)
+class TradeQuery
+{
+public:
+    // 语法错误时返回无效的查询，error 中给出位置与原因；空白文本得到匹配所有交易的空查询
+    static TradeQuery compile(const QString &text, QString *error = nullptr);
+
+    bool isValid() const { return m_valid; }
+    bool isEmpty() const { return !m_predicate; }
+    QString text() const { return m_text; }
+
+    bool matches(const TradeOption &trade) const { return !m_predicate || m_predicate(trade); }
+    // trades 中从 from 开始的每一条是否匹配；交易较多时并行求值
+    QList<bool> matchAll(const QList<TradeOption> &trades, qsizetype from = 0) const;
+
+private:
+    std::function<bool(const TradeOption &)> m_predicate;   // 只读取交易，可在多个线程中同时调用
+    QString m_text;
+    bool m_valid = true;
+};
+
+#endif // TRADEQUERY_H
@@ -0,0 +1,87 @@
+#include "undostack.h"
+#include <QJsonDocument>
+#include <QtMath>
+#include <cmath>
+
+void UndoStack::reset(const State &state)
+{
+    m_undo.clear();
+    m_redo.clear();
+    m_current = state;
+    m_totalBytes = 0;
+    m_focusRow = -1;
+    m_currentId = ++m_nextId;
+    m_cleanId = m_currentId;
+    m_lastKey.clear();
+    m_lastCommit.invalidate();
+}
+
+void UndoStack::commit(const State &state, const QString &mergeKey, qint64 changedBytes)
+{
+    // 同一输入目标的连续修改：直接替换当前状态，不产生新的撤销步骤
+    const bool merge = !mergeKey.isEmpty() && mergeKey == m_lastKey && !m_undo.isEmpty() && m_redo.isEmpty()
+                    && m_lastCommit.isValid() && m_lastCommit.elapsed() < kMergeWindowMs;
+    if (merge) {
+        m_current = state;
+        m_currentId = ++m_nextId;   // 内容变了：合并到已保存的那一步之后也算修改
+        m_lastCommit.start();
+        return;
+    }
+
+    for (const Step &step : std::as_const(m_redo)) m_totalBytes -= step.bytes;
+    m_redo.clear();
+
+    m_undo.append(Step{ m_current, changedBytes, m_currentId });
+    m_totalBytes += changedBytes;
+    m_current = state;
+    m_currentId = ++m_nextId;
+    m_lastKey = mergeKey;
+    m_lastCommit.start();
+    trim();
+}
+
+bool UndoStack::undo()
+{
+    if (m_undo.isEmpty()) return false;
+    Step previous = m_undo.takeLast();
+    m_focusRow = m_current.focusRow;
+    m_redo.append(Step{ m_current, previous.bytes, m_currentId });
+    m_current = previous.state;
+    m_currentId = previous.id;
+    m_lastKey.clear();   // 撤销之后的输入不再与之前的步骤合并
+    return true;
+}
+
+bool UndoStack::redo()
+{
+    if (m_redo.isEmpty()) return false;
+    Step next = m_redo.takeLast();
+    m_undo.append(Step{ m_current, next.bytes, m_currentId });
+    m_current = next.state;
+    m_currentId = next.id;
+    m_focusRow = m_current.focusRow;
+    m_lastKey.clear();
+    return true;
+}
+
+void UndoStack::trim()
+{
+    // 最早的步骤最先丢弃；被丢弃的状态中仍与新状态共享的节点不会真正释放，这里按新增量估算
+    while (!m_undo.isEmpty() && (m_undo.size() > kMaxSteps || m_totalBytes > kMaxBytes)) {
+        m_totalBytes -= m_undo.first().bytes;
+        m_undo.removeFirst();
+    }
+}
+
+qint64 UndoStack::estimateBytes(const TradeOption &trade, qsizetype listSize)
+{
+    auto itemBytes = [](const ItemData &d) {
+        qint64 bytes = sizeof(ItemData) + (d.name.size() + d.displayName.size() + d.lore.size()) * qint64(sizeof(QChar));
+        if (!d.customNodes.isEmpty()) bytes += QJsonDocument(d.customNodes).toJson(QJsonDocument::Compact).size();
+        return bytes;
+    };
+    // treap 的期望路径长度约为 2·log2(n)，每个节点是两个 shared_ptr 加优先级与大小
+    const qint64 pathNodes = 2 * (qCeil(std::log2(double(listSize) + 1.0)) + 1);
+    return sizeof(TradeOption) + itemBytes(trade.buyA) + itemBytes(trade.buyB) + itemBytes(trade.sell)
+         + pathNodes * 64;
+}
@@ -0,0 +1,76 @@
+#ifndef UNDOSTACK_H
+#define UNDOSTACK_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include "persistentlist.h"
+#include "tradedata.h"
+
+// ==================== 撤销 / 重做 ====================
+// 每一步保存一份完整的编辑器状态，但交易列表是结构共享的 PersistentList：
+// 修改一条交易只新建 O(log n) 个树节点和这一条交易，其余部分与上一步共用。
+// 同一个 mergeKey 的连续提交（例如在同一个输入框里打字）在 kMergeWindowMs 内合并为一步。
+// 步数与估算内存都有上限，超出时丢弃最早的步骤。
+// 每个状态有一个编号（合并的提交也换新编号），与保存或加载时标记的编号比较即可知道文档是否有未保存的修改。
+class UndoStack
+{
+public:
+    struct State {
+        PersistentList<TradeOption> trades;
+        QString profession;
+        int markVariant = 0;
+        int focusRow = -1;   // 产生该状态的修改所在的行，撤销 / 重做后选中这一行
+    };
+
+    static const int kMaxSteps = 500;
+    static const qint64 kMaxBytes = 64ll * 1024 * 1024;
+    static const int kMergeWindowMs = 1000;
+
+    // 清空历史，以 state 作为初始状态（加载文件后调用）；初始状态视为已保存
+    void reset(const State &state);
+
+    // 提交新状态；changedBytes 是这一步新增数据的估算大小（见 estimateBytes）
+    void commit(const State &state, const QString &mergeKey, qint64 changedBytes);
+
+    bool canUndo() const { return !m_undo.isEmpty(); }
+    bool canRedo() const { return !m_redo.isEmpty(); }
+
+    // 撤销 / 重做一步；成功时 current() 是需要恢复的状态，focusRow() 是被撤销或重做的修改所在的行
+    bool undo();
+    bool redo();
+
+    const State &current() const { return m_current; }
+    int focusRow() const { return m_focusRow; }
+
+    // 保存后把当前状态标记为已保存；撤销或重做回到这一步时 isClean() 重新为真。
+    // 标记的步骤被 trim 丢弃后不会再回到已保存的状态
+    void markClean() { m_cleanId = m_currentId; }
+    bool isClean() const { return m_currentId == m_cleanId; }
+
+    // 一条交易占用内存的粗略估算，加上修改时新建的树节点
+    static qint64 estimateBytes(const TradeOption &trade, qsizetype listSize);
+
+private:
+    struct Step {
+        State state;
+        qint64 bytes = 0;   // 从这一步到下一步新增的数据量
+        quint64 id = 0;     // state 的编号
+    };
+
+    void trim();
+
+    QList<Step> m_undo;
+    QList<Step> m_redo;
+    State m_current;
+    qint64 m_totalBytes = 0;
+    int m_focusRow = -1;
+    quint64 m_currentId = 0;
+    quint64 m_cleanId = 0;
+    quint64 m_nextId = 0;
+
+    QString m_lastKey;
+    QElapsedTimer m_lastCommit;
+};
+
+#endif // UNDOSTACK_H
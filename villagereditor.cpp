@@ -1,1201 +1,1987 @@
-#include "villagereditor.h"
-#include <QFileDialog>
-#include <QMessageBox>
-#include <QJsonDocument>
-#include <QVBoxLayout>
-#include <QHBoxLayout>
-#include <QGridLayout>
-#include <QLabel>
-#include <QListWidget>
-#include <QCompleter>
-#include <QFile>
-#include <QHeaderView>
-
-// 将JSON文本中的转义序列转换为实际控制字符，用于显示
-static QString unescapeForDisplay(const QString &jsonText) {
-    QString result = jsonText;
-    result.replace("\\n", "\n");
-    result.replace("\\t", "\t");
-    result.replace("\\r", "\r");
-    // 注意：不处理 \\ 和 \"，以免破坏JSON结构
-    return result;
-}
-
-// 将实际控制字符转义为JSON标准转义序列，用于保存
-static QString escapeForJson(const QString &displayText) {
-    QString result = displayText;
-    result.replace("\n", "\\n");
-    result.replace("\t", "\\t");
-    result.replace("\r", "\\r");
-    return result;
-}
-
-// 解析 CSV 行，正确处理引号包围的字段
-static QList<QString> parseCsvLine(const QString &line) {
-    QList<QString> fields;
-    QString field;
-    bool inQuote = false;
-    int i = 0;
-    while (i < line.length()) {
-        QChar c = line[i];
-        if (c == '"' && !inQuote) {
-            // 进入引号模式
-            inQuote = true;
-        } else if (c == '"' && inQuote) {
-            // 可能是双引号转义或结束引号
-            if (i + 1 < line.length() && line[i + 1] == '"') {
-                // 连续两个双引号表示一个转义的双引号
-                field.append('"');
-                i++; // 跳过下一个双引号
-            } else {
-                // 结束引号
-                inQuote = false;
-            }
-        } else if (c == ',' && !inQuote) {
-            // 字段结束
-            fields.append(field);
-            field.clear();
-        } else {
-            field.append(c);
-        }
-        i++;
-    }
-    fields.append(field); // 添加最后一个字段
-    return fields;
-}
-
-// 递归查找指定 name 的 NBT 数组节点，无视嵌套深度
-static QJsonArray findNbtArray(const QJsonArray &arr, const QString &targetName) {
-    for (const QJsonValue &v : arr) {
-        if (!v.isObject()) continue;
-        QJsonObject obj = v.toObject();
-
-        // 找到了目标节点，并且它的 value 是个数组
-        if (obj.value("name").toString() == targetName && obj.value("value").isArray()) {
-            return obj.value("value").toArray();
-        }
-
-        // 没找到，但当前节点的 value 是数组，则递归往深处继续找
-        if (obj.value("value").isArray()) {
-            QJsonArray res = findNbtArray(obj.value("value").toArray(), targetName);
-            if (!res.isEmpty()) return res;
-        }
-    }
-    return QJsonArray(); // 没找到则返回空
-}
-
-VillagerEditor::VillagerEditor(QWidget *parent)
-    : QMainWindow(parent)
-    , m_profession("cartographer")   // <== 默认职业
-    , m_markVariant(0)               // <== 默认变种
-{
-    initUI();
-}
-
-VillagerEditor::~VillagerEditor() {}
-
-void VillagerEditor::initUI()
-{
-    setWindowTitle("村民交易编辑器");
-    resize(1300, 900);
-
-    QWidget *centralWidget = new QWidget(this);
-    QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);
-    setCentralWidget(centralWidget);
-
-    // 工具栏
-    QHBoxLayout *toolLayout = new QHBoxLayout();
-    QPushButton *btnLoad = new QPushButton("加载源文件", this);
-    QPushButton *btnSave = new QPushButton("保存文件", this);
-    QPushButton *btnAdd = new QPushButton("添加交易项", this);
-    QPushButton *btnDelete = new QPushButton("删除选中项", this);
-    QPushButton *btnEditItems = new QPushButton("⚙️ 编辑物品库", this); // <== 新增按钮
-    toolLayout->addWidget(btnLoad);
-    toolLayout->addWidget(btnSave);
-    toolLayout->addWidget(btnAdd);
-    toolLayout->addWidget(btnDelete);
-    toolLayout->addWidget(btnEditItems); // <== 添加到布局
-    mainLayout->addLayout(toolLayout);
-
-    // 交易表格
-    m_tradeTable = new QTableWidget(this);
-    m_tradeTable->setColumnCount(9);
-    QStringList headers = {"BuyA物品名", "BuyA数量", "BuyB物品名", "BuyB数量", "Sell物品名", "Sell数量", "已用次数", "最大次数", "Tier"};
-    m_tradeTable->setHorizontalHeaderLabels(headers);
-    m_tradeTable->setSelectionBehavior(QAbstractItemView::SelectRows);
-    m_tradeTable->setEditTriggers(QTableWidget::NoEditTriggers);
-    m_tradeTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-    mainLayout->addWidget(m_tradeTable, 1);
-
-    // 交易项参数编辑区
-    QGroupBox *editGroup = new QGroupBox("当前交易项编辑", this);
-    QHBoxLayout *editLayout = new QHBoxLayout(editGroup);
-
-    // 抽象出三个相同的编辑面板
-    editLayout->addWidget(createItemSection("Buy A (主输入)", wBuyA));
-    editLayout->addWidget(createItemSection("Buy B (副输入)", wBuyB));
-    editLayout->addWidget(createItemSection("Sell (输出)", wSell));
-
-    mainLayout->addWidget(editGroup);
-
-    // 基础属性区 (Uses, Tier)
-    QGroupBox *baseAttrGroup = new QGroupBox("基础属性", this);
-    QHBoxLayout *baseAttrLayout = new QHBoxLayout(baseAttrGroup);
-    baseAttrLayout->addWidget(new QLabel("已用次数(uses):"));
-    m_sbUses = new QSpinBox(this); m_sbUses->setRange(-32767, 32767);
-    baseAttrLayout->addWidget(m_sbUses);
-    baseAttrLayout->addWidget(new QLabel("最大次数(maxUses):"));
-    m_sbMaxUses = new QSpinBox(this); m_sbMaxUses->setRange(-32767, 32767);
-    baseAttrLayout->addWidget(m_sbMaxUses);
-    baseAttrLayout->addWidget(new QLabel("购买等级(Tier):"));
-    m_sbTier = new QSpinBox(this); m_sbTier->setRange(0, 5); m_sbTier->setValue(0);
-    baseAttrLayout->addWidget(m_sbTier);
-    baseAttrLayout->addStretch();
-    mainLayout->addWidget(baseAttrGroup);
-
-    // <== 新增：村民属性组（职业与变种）
-    QGroupBox *villagerGroup = new QGroupBox("村民属性", this);
-    QHBoxLayout *villagerLayout = new QHBoxLayout(villagerGroup);
-    villagerLayout->addWidget(new QLabel("职业:"));
-    m_cbProfession = new QComboBox(this);
-    // 职业列表：显示名 -> 数据（职业字符串，不带+）
-    m_cbProfession->addItem("制图师", "cartographer");
-    m_cbProfession->addItem("盔甲商", "armorer");
-    m_cbProfession->addItem("武器商", "weaponsmith");
-    m_cbProfession->addItem("石匠", "mason");
-    m_cbProfession->addItem("制箭师", "fletcher");
-    m_cbProfession->addItem("工具匠", "toolsmith");
-    m_cbProfession->addItem("屠夫", "butcher");
-    m_cbProfession->addItem("牧师", "cleric");
-    m_cbProfession->addItem("牧羊人", "shepherd");
-    m_cbProfession->addItem("农民", "farmer");
-    m_cbProfession->addItem("渔夫", "fisherman");
-    m_cbProfession->addItem("图书管理员", "librarian");
-    m_cbProfession->addItem("皮匠", "leatherworker");
-    villagerLayout->addWidget(m_cbProfession);
-
-    villagerLayout->addWidget(new QLabel("变种:"));
-    m_cbMarkVariant = new QComboBox(this);
-    m_cbMarkVariant->addItem("平原(0)", 0);
-    m_cbMarkVariant->addItem("沙漠(1)", 1);
-    m_cbMarkVariant->addItem("丛林(2)", 2);
-    m_cbMarkVariant->addItem("热带草原(3)", 3);
-    m_cbMarkVariant->addItem("雪原(4)", 4);
-    m_cbMarkVariant->addItem("沼泽(5)", 5);
-    m_cbMarkVariant->addItem("针叶林(6)", 6);
-    villagerLayout->addWidget(m_cbMarkVariant);
-    villagerLayout->addStretch();
-
-    mainLayout->addWidget(villagerGroup);
-
-    // 预览区
-    QGroupBox *previewGroup = new QGroupBox("文件预览", this);
-    QVBoxLayout *previewLayout = new QVBoxLayout(previewGroup);
-    m_tePreview = new QTextEdit(this);
-    m_tePreview->setReadOnly(true);
-    m_tePreview->setLineWrapMode(QTextEdit::NoWrap);
-    previewLayout->addWidget(m_tePreview);
-    mainLayout->addWidget(previewGroup, 1);
-
-    // 信号连接
-    connect(btnLoad, &QPushButton::clicked, this, &VillagerEditor::loadFile);
-    connect(btnSave, &QPushButton::clicked, this, &VillagerEditor::saveFile);
-    connect(btnAdd, &QPushButton::clicked, this, &VillagerEditor::addTradeOption);
-    connect(btnDelete, &QPushButton::clicked, this, &VillagerEditor::deleteTradeOption);
-    connect(btnEditItems, &QPushButton::clicked, this, &VillagerEditor::openItemConfigEditor); // <== 绑定点击事件
-    connect(m_tradeTable, &QTableWidget::cellClicked, this, &VillagerEditor::onTableItemSelected);
-    connect(m_cbProfession, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &VillagerEditor::onGlobalAttributeChanged);
-    connect(m_cbMarkVariant, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &VillagerEditor::onGlobalAttributeChanged);
-
-    // 绑定基础属性的同步槽
-    connect(m_sbUses, &QSpinBox::valueChanged, this, &VillagerEditor::onDataChanged);
-    connect(m_sbMaxUses, &QSpinBox::valueChanged, this, &VillagerEditor::onDataChanged);
-    connect(m_sbTier, &QSpinBox::valueChanged, this, &VillagerEditor::onDataChanged);
-
-    // 自动补全
-    updateCompleters();
-}
-
-// 核心重构：高度抽象的 UI 生成器
-QGroupBox* VillagerEditor::createItemSection(const QString &title, ItemWidgets &w)
-{
-    QGroupBox *group = new QGroupBox(title, this);
-    QGridLayout *layout = new QGridLayout(group);
-
-    // 基础物品信息
-    layout->addWidget(new QLabel("物品名:"), 0, 0);
-    w.leName = new QLineEdit(this);
-    layout->addWidget(w.leName, 0, 1, 1, 2);
-    w.btnSelect = new QPushButton("选择", this);
-    layout->addWidget(w.btnSelect, 0, 3);
-
-    layout->addWidget(new QLabel("数量:"), 1, 0);
-    w.sbCount = new QSpinBox(this); w.sbCount->setRange(0, 999);
-    layout->addWidget(w.sbCount, 1, 1);
-
-    layout->addWidget(new QLabel("Damage:"), 1, 2);
-    w.sbDamage = new QSpinBox(this); w.sbDamage->setRange(0, 32767);
-    layout->addWidget(w.sbDamage, 1, 3);
-
-    // Tag 信息
-    w.cbEnableName = new QCheckBox("启用自定义名称", this);
-    layout->addWidget(w.cbEnableName, 2, 0, 1, 2);
-    w.leDisp = new QTextEdit(this);
-    w.leDisp->setMaximumHeight(60);
-    w.leDisp->setAcceptRichText(false);
-    layout->addWidget(w.leDisp, 3, 0, 1, 4);  // 独占一行
-
-    w.cbEnableLore = new QCheckBox("启用注释(Lore)", this);
-    layout->addWidget(w.cbEnableLore, 4, 0, 1, 2);
-    w.leLore = new QTextEdit(this);
-    w.leLore->setMaximumHeight(60);
-    w.leLore->setAcceptRichText(false);
-    layout->addWidget(w.leLore, 5, 0, 1, 4);  // 独占一行
-
-    // 附魔部分（原第4行改为第6行，依此类推）
-    w.cbEnableEnch = new QCheckBox("启用附魔", this);
-    layout->addWidget(w.cbEnableEnch, 6, 0, 1, 2);
-    QHBoxLayout *enchLayout = new QHBoxLayout();
-    enchLayout->addWidget(new QLabel("ID:"));
-    w.sbEnchId = new QSpinBox(this); w.sbEnchId->setRange(0, 255);
-    enchLayout->addWidget(w.sbEnchId);
-    enchLayout->addWidget(new QLabel("Lvl:"));
-    w.sbEnchLvl = new QSpinBox(this); w.sbEnchLvl->setRange(1, 255);
-    enchLayout->addWidget(w.sbEnchLvl);
-    layout->addLayout(enchLayout, 6, 2, 1, 2);
-    // 新增：自定义 NBT 节点
-    w.cbEnableCustom = new QCheckBox("启用自定义NBT节点", this);
-    layout->addWidget(w.cbEnableCustom, 7, 0, 1, 4); // 占用整行
-    w.teCustom = new QTextEdit(this);
-    w.teCustom->setPlaceholderText("输入JSON数组，例如：\n[{\"name\":\"CanPlaceOn\",\"value\":[\"minecraft:grass\"],\"type\":9}]");
-    w.teCustom->setMaximumHeight(100);
-    layout->addWidget(w.teCustom, 8, 0, 1, 4);
-    w.teCustom->setVisible(false); // 默认隐藏
-
-    // 绑定所有的统一更新事件
-    auto syncSlot = &VillagerEditor::onDataChanged;
-    connect(w.leName, &QLineEdit::textChanged, this, syncSlot);
-    connect(w.sbCount, &QSpinBox::valueChanged, this, syncSlot);
-    connect(w.sbDamage, &QSpinBox::valueChanged, this, syncSlot);
-    connect(w.leDisp, &QTextEdit::textChanged, this, syncSlot);
-    connect(w.leLore, &QTextEdit::textChanged, this, syncSlot);
-    connect(w.sbEnchId, &QSpinBox::valueChanged, this, syncSlot);
-    connect(w.sbEnchLvl, &QSpinBox::valueChanged, this, syncSlot);
-
-    // 绑定复选框状态显示/隐藏事件
-    connect(w.cbEnableName, &QCheckBox::stateChanged, this, &VillagerEditor::onTagCheckboxToggled);
-    connect(w.cbEnableLore, &QCheckBox::stateChanged, this, &VillagerEditor::onTagCheckboxToggled);
-    connect(w.cbEnableEnch, &QCheckBox::stateChanged, this, &VillagerEditor::onTagCheckboxToggled);
-
-    // 绑定物品选择按钮
-    connect(w.btnSelect, &QPushButton::clicked, this, [this, &w]() { openItemSelector(&w); });
-    // 连接自定义节点复选框的切换事件
-    connect(w.cbEnableCustom, &QCheckBox::toggled, this, [this, &w](bool checked) {
-        // 当自定义节点启用时，禁用并取消勾选其他三个复选框
-        w.cbEnableName->setEnabled(!checked);
-        w.cbEnableLore->setEnabled(!checked);
-        w.cbEnableEnch->setEnabled(!checked);
-
-        if (checked) {
-            w.cbEnableName->setChecked(false);
-            w.cbEnableLore->setChecked(false);
-            w.cbEnableEnch->setChecked(false);
-        }
-
-        // 显示/隐藏自定义编辑框
-        w.teCustom->setVisible(checked);
-        onDataChanged();   // 触发数据更新
-    });
-    // 连接文本变化
-    connect(w.teCustom, &QTextEdit::textChanged, this, &VillagerEditor::onDataChanged);
-
-    return group;
-}
-
-// 核心重构：统一的 UI 状态切换
-void VillagerEditor::onTagCheckboxToggled()
-{
-    if (m_isUpdatingUI) return;
-
-    auto toggle = [](ItemWidgets &w) {
-        w.leDisp->setVisible(w.cbEnableName->isChecked());
-        w.leLore->setVisible(w.cbEnableLore->isChecked());
-        w.sbEnchId->setVisible(w.cbEnableEnch->isChecked());
-        w.sbEnchLvl->setVisible(w.cbEnableEnch->isChecked());
-    };
-    toggle(wBuyA); toggle(wBuyB); toggle(wSell);
-
-    onDataChanged(); // 触发保存
-}
-
-// 核心重构：单向数据流 - 数据推送到 UI
-void VillagerEditor::populateUIFromData(const TradeOption &trade)
-{
-    m_isUpdatingUI = true; // 锁定，防止触发 onChange
-
-    auto fillItem = [this](ItemWidgets &w, const ItemData &d) {
-        w.leName->setText(d.name);
-        w.sbCount->setValue(d.count);
-        w.sbDamage->setValue(d.damage);
-
-        // 如果启用了自定义节点，则强制禁用并取消勾选内置 Tag 复选框
-        if (d.enableCustom) {
-            w.cbEnableName->setChecked(false);
-            w.cbEnableLore->setChecked(false);
-            w.cbEnableEnch->setChecked(false);
-            w.cbEnableName->setEnabled(false);
-            w.cbEnableLore->setEnabled(false);
-            w.cbEnableEnch->setEnabled(false);
-        } else {
-            w.cbEnableName->setChecked(d.enableName);
-            w.cbEnableLore->setChecked(d.enableLore);
-            w.cbEnableEnch->setChecked(d.enableEnch);
-            w.cbEnableName->setEnabled(true);
-            w.cbEnableLore->setEnabled(true);
-            w.cbEnableEnch->setEnabled(true);
-        }
-
-        // 设置显示文本（即使被禁用也保留内容）
-        w.leDisp->setPlainText(d.displayName);
-        w.leLore->setPlainText(d.lore);
-        w.sbEnchId->setValue(d.enchId);
-        w.sbEnchLvl->setValue(d.enchLevel);
-
-        // 根据复选框状态控制输入框可见性
-        w.leDisp->setVisible(w.cbEnableName->isChecked());
-        w.leLore->setVisible(w.cbEnableLore->isChecked());
-        w.sbEnchId->setVisible(w.cbEnableEnch->isChecked());
-        w.sbEnchLvl->setVisible(w.cbEnableEnch->isChecked());
-
-        // 自定义节点本身
-        w.cbEnableCustom->setChecked(d.enableCustom);
-        if (d.enableCustom) {
-            QJsonDocument doc(d.customNodes);
-            QString jsonText = doc.toJson(QJsonDocument::Indented);
-            w.teCustom->setPlainText(unescapeForDisplay(jsonText));  // 转换显示
-        } else {
-            w.teCustom->clear();
-        }
-        w.teCustom->setVisible(d.enableCustom);
-    };
-
-    fillItem(wBuyA, trade.buyA);
-    fillItem(wBuyB, trade.buyB);
-    fillItem(wSell, trade.sell);
-
-    m_sbUses->setValue(trade.uses);
-    m_sbMaxUses->setValue(trade.maxUses);
-    m_sbTier->setValue(trade.tier);
-
-    m_isUpdatingUI = false; // 解锁
-}
-
-// 核心重构：单向数据流 - UI 更新到数据模型
-void VillagerEditor::syncDataFromUI()
-{
-    if (m_selectedTradeRow < 0 || m_selectedTradeRow >= m_tradeOptions.size()) return;
-
-    TradeOption &trade = m_tradeOptions[m_selectedTradeRow];
-
-    auto readItem = [](const ItemWidgets &w, ItemData &d) {
-        d.name = w.leName->text().trimmed();
-        d.count = w.sbCount->value();
-        d.damage = w.sbDamage->value();
-        d.enableName = w.cbEnableName->isChecked();
-        d.displayName = w.leDisp->toPlainText();
-        d.lore = w.leLore->toPlainText();
-        d.enableLore = w.cbEnableLore->isChecked();
-        d.enableEnch = w.cbEnableEnch->isChecked();
-        d.enchId = w.sbEnchId->value();
-        d.enchLevel = w.sbEnchLvl->value();
-        // 新增：自定义节点
-        d.enableCustom = w.cbEnableCustom->isChecked();
-        if (d.enableCustom) {
-            QString customText = w.teCustom->toPlainText().trimmed();
-            if (!customText.isEmpty()) {
-                // 将显示用的实际换行符等转义回JSON标准形式
-                QString escaped = escapeForJson(customText);
-                QJsonParseError err;
-                QJsonDocument doc = QJsonDocument::fromJson(escaped.toUtf8(), &err);
-                if (err.error == QJsonParseError::NoError && doc.isArray()) {
-                    d.customNodes = doc.array();
-                } else {
-                    d.customNodes = QJsonArray();
-                }
-            } else {
-                d.customNodes = QJsonArray();
-            }
-        } else {
-            d.customNodes = QJsonArray();
-        }
-    };
-
-    readItem(wBuyA, trade.buyA);
-    readItem(wBuyB, trade.buyB);
-    readItem(wSell, trade.sell);
-
-    trade.uses = m_sbUses->value();
-    trade.maxUses = m_sbMaxUses->value();
-    trade.tier = m_sbTier->value();
-}
-
-void VillagerEditor::onDataChanged()
-{
-    if (m_isUpdatingUI) return; // 如果正在填充界面，则不响应更改
-
-    syncDataFromUI();
-    updateTradeTable();
-    m_tePreview->setText(serializeNbtData(m_tradeOptions));
-}
-
-// ==================== 原有的其他逻辑封装 ====================
-
-void VillagerEditor::onTableItemSelected(int row, int /*column*/)
-{
-    if (row < 0 || row >= m_tradeOptions.size()) {
-        m_selectedTradeRow = -1;
-        TradeOption emptyTrade; // 加载默认空项
-        populateUIFromData(emptyTrade);
-        return;
-    }
-    m_selectedTradeRow = row;
-    populateUIFromData(m_tradeOptions[row]);
-}
-
-void VillagerEditor::addTradeOption()
-{
-    TradeOption newTrade;
-    newTrade.buyB.count = 0; // 默认 BuyB 不启用
-    m_tradeOptions.append(newTrade);
-
-    updateTradeTable();
-    m_tradeTable->selectRow(m_tradeOptions.size() - 1);
-    onTableItemSelected(m_tradeOptions.size() - 1, 0);
-
-    m_tePreview->setText(serializeNbtData(m_tradeOptions));
-}
-
-void VillagerEditor::deleteTradeOption()
-{
-    if (m_selectedTradeRow < 0 || m_selectedTradeRow >= m_tradeOptions.size()) return;
-
-    m_tradeOptions.removeAt(m_selectedTradeRow);
-    m_selectedTradeRow = -1;
-    TradeOption emptyTrade;
-    populateUIFromData(emptyTrade);
-    updateTradeTable();
-    m_tePreview->setText(serializeNbtData(m_tradeOptions));
-}
-
-void VillagerEditor::updateTradeTable()
-{
-    m_isUpdatingUI = true; // 防止触发表格变动带来的副作用
-    m_tradeTable->setRowCount(0);
-
-    for (int i = 0; i < m_tradeOptions.size(); ++i) {
-        const TradeOption &t = m_tradeOptions[i];
-        m_tradeTable->insertRow(i);
-        m_tradeTable->setItem(i, 0, new QTableWidgetItem(t.buyA.name));
-        m_tradeTable->setItem(i, 1, new QTableWidgetItem(QString::number(t.buyA.count)));
-        m_tradeTable->setItem(i, 2, new QTableWidgetItem(t.buyB.name));
-        m_tradeTable->setItem(i, 3, new QTableWidgetItem(QString::number(t.buyB.count)));
-        m_tradeTable->setItem(i, 4, new QTableWidgetItem(t.sell.name));
-        m_tradeTable->setItem(i, 5, new QTableWidgetItem(QString::number(t.sell.count)));
-        m_tradeTable->setItem(i, 6, new QTableWidgetItem(QString::number(t.uses)));
-        m_tradeTable->setItem(i, 7, new QTableWidgetItem(QString::number(t.maxUses)));
-        m_tradeTable->setItem(i, 8, new QTableWidgetItem(QString::number(t.tier)));
-    }
-
-    if (m_selectedTradeRow >= 0 && m_selectedTradeRow < m_tradeOptions.size()) {
-        m_tradeTable->selectRow(m_selectedTradeRow);
-    }
-    m_isUpdatingUI = false;
-}
-
-// 物品选择器
-void VillagerEditor::openItemSelector(ItemWidgets *widgets)
-{
-    int damage = 0;
-    QString presetJson;
-    QString itemName = selectItemFromDialog(damage, presetJson);
-    if (!itemName.isEmpty()) {
-        widgets->leName->setText(itemName);
-        widgets->sbDamage->setValue(damage);
-        if (widgets->sbCount->value() == 0) widgets->sbCount->setValue(1);
-
-        if (!presetJson.isEmpty()) {
-            widgets->cbEnableCustom->setChecked(true);
-            // 将预设JSON中的转义序列转换为实际换行符显示
-            QString displayText = unescapeForDisplay(presetJson);
-            widgets->teCustom->setPlainText(displayText);
-        }
-    }
-}
-
-QString VillagerEditor::selectItemFromDialog(int &outDamage, QString &outPresetJson)
-{
-    QDialog dialog(this);
-    dialog.setWindowTitle("选择物品");
-    dialog.setModal(true);
-    dialog.resize(500, 550); // 稍微加宽一点以显示分类
-
-    QVBoxLayout vLayout(&dialog);
-
-    // ========== 1. 顶部搜索与分类区 ==========
-    QHBoxLayout hLayout;
-
-    QComboBox *categoryCombo = new QComboBox(&dialog);
-    categoryCombo->addItem("全部"); // 默认选项
-
-    QLineEdit searchEdit(&dialog);
-    searchEdit.setPlaceholderText("搜索物品(中/英文)...");
-
-    // 设置下拉框和搜索框比例为 1:2
-    hLayout.addWidget(categoryCombo, 1);
-    hLayout.addWidget(&searchEdit, 2);
-    vLayout.addLayout(&hLayout);
-
-    // ========== 2. 物品列表加载 ==========
-    QListWidget itemList(&dialog);
-    QList<ItemMapping> items = loadItemMappings();
-
-    QStringList categories;
-    for (const auto &mapping : items) {
-        // 收集不重复的分类用于填充下拉框
-        if (!categories.contains(mapping.category)) {
-            categories.append(mapping.category);
-        }
-
-        // UI 显示格式：[矿物] 绿宝石（minecraft:emerald）
-        QListWidgetItem *item = new QListWidgetItem(QString("[%1] %2（%3）")
-                                                        .arg(mapping.category, mapping.chineseName, mapping.englishId));
-
-        // 绑定隐藏数据
-        item->setData(Qt::UserRole, mapping.englishId);
-        item->setData(Qt::UserRole + 1, mapping.defaultDamage);
-        item->setData(Qt::UserRole + 2, mapping.category); // 存入分类名，用于过滤
-        item->setData(Qt::UserRole + 3, mapping.presetJson);   // <-- 新增：预设 JSON
-
-        itemList.addItem(item);
-    }
-
-    categoryCombo->addItems(categories);
-    vLayout.addWidget(&itemList);
-
-    // ========== 3. 双重过滤逻辑 (分类 + 搜索) ==========
-    auto filterItems = [&]() {
-        QString searchText = searchEdit.text();
-        QString selectedCategory = categoryCombo->currentText();
-
-        for (int i = 0; i < itemList.count(); ++i) {
-            QListWidgetItem *item = itemList.item(i);
-            QString itemCategory = item->data(Qt::UserRole + 2).toString();
-            QString itemText = item->text();
-
-            // 条件1：分类匹配（或是选择了"全部"）
-            bool categoryMatch = (selectedCategory == "全部" || selectedCategory == itemCategory);
-            // 条件2：搜索文本匹配
-            bool textMatch = itemText.contains(searchText, Qt::CaseInsensitive);
-
-            // 只有同时满足分类和搜索词才显示
-            item->setHidden(!(categoryMatch && textMatch));
-        }
-    };
-
-    // 搜索框输入和下拉框选择改变时，都触发过滤
-    connect(&searchEdit, &QLineEdit::textChanged, filterItems);
-    connect(categoryCombo, &QComboBox::currentTextChanged, filterItems);
-
-    // ========== 4. 确认与取消逻辑 ==========
-    QString selectedId;
-    auto onSelect = [&]() {
-        if (QListWidgetItem *item = itemList.currentItem()) {
-            selectedId = item->data(Qt::UserRole).toString();
-            outDamage = item->data(Qt::UserRole + 1).toInt();
-            outPresetJson = item->data(Qt::UserRole + 3).toString();   // <-- 获取预设 JSON
-            dialog.accept();
-        }
-    };
-
-    QPushButton btnConfirm("确认");
-    QPushButton btnCancel("取消");
-    QHBoxLayout btnLayout;
-    btnLayout.addStretch();
-    btnLayout.addWidget(&btnConfirm);
-    btnLayout.addWidget(&btnCancel);
-    vLayout.addLayout(&btnLayout);
-
-    connect(&btnConfirm, &QPushButton::clicked, onSelect);
-    connect(&btnCancel, &QPushButton::clicked, &dialog, &QDialog::reject);
-    connect(&itemList, &QListWidget::itemDoubleClicked, onSelect); // 双击直接选择
-
-    dialog.exec();
-    return selectedId;
-}
-
-// ==================== NBT 序列化与解析重构 ====================
-
-QJsonObject VillagerEditor::createNode(const QString &name, const QJsonValue &value, int type) {
-    return QJsonObject{{"name", name}, {"value", value}, {"type", type}};
-}
-
-QJsonObject VillagerEditor::buildTagNbt(const ItemData &data)
-{
-    QJsonArray tagArr;
-
-    if (data.enableName || data.enableLore) {
-        QJsonArray displayArr;
-        if (data.enableName) displayArr.append(createNode("Name", data.displayName, 8));
-
-        if (data.enableLore && !data.lore.isEmpty()) {
-            QJsonArray loreArr;
-            QStringList lines = data.lore.split('\n', Qt::SkipEmptyParts);
-            for (const QString &line : lines) {
-                loreArr.append(createNode("", line, 8));
-            }
-            if (!loreArr.isEmpty()) {
-                displayArr.append(createNode("Lore", loreArr, 9));
-            }
-        }
-        tagArr.append(createNode("display", displayArr, 10));
-    }
-
-    if (data.enableEnch) {
-        QJsonArray enchInner;
-        enchInner.append(createNode("id", data.enchId, 2));
-        enchInner.append(createNode("lvl", data.enchLevel, 2));
-        QJsonArray enchList; enchList.append(createNode("", enchInner, 10));
-        tagArr.append(createNode("ench", enchList, 9));
-    }
-
-    return tagArr.isEmpty() ? QJsonObject() : createNode("tag", tagArr, 10);
-}
-
-QJsonObject VillagerEditor::buildItemNbt(const QString &key, const ItemData &data)
-{
-    QJsonArray arr;
-    arr.append(createNode("Count", data.count, 1));
-    arr.append(createNode("Damage", data.damage, 2));
-    arr.append(createNode("Name", data.name, 8));
-    arr.append(createNode("WasPickedUp", 0, 1));
-
-    QJsonObject tag = buildTagNbt(data);
-    if (!tag.isEmpty()) arr.append(tag);
-
-    // 追加自定义节点
-    if (data.enableCustom) {
-        for (const QJsonValue &cv : data.customNodes) {
-            if (cv.isObject()) {
-                arr.append(cv.toObject());
-            }
-        }
-    }
-
-    return createNode(key, arr, 10);
-}
-
-QJsonObject VillagerEditor::buildSingleTradeJson(const TradeOption &trade)
-{
-    QJsonArray tradeValueArr;
-    tradeValueArr.append(buildItemNbt("buyA", trade.buyA));
-    tradeValueArr.append(buildItemNbt("buyB", trade.buyB));
-    tradeValueArr.append(createNode("buyCountA", trade.buyA.count, 3));
-    tradeValueArr.append(createNode("buyCountB", trade.buyB.count, 3));
-    tradeValueArr.append(createNode("demand", 0, 3));
-    tradeValueArr.append(createNode("maxUses", trade.maxUses, 3));
-    tradeValueArr.append(createNode("priceMultiplierA", 0.05, 5));
-    tradeValueArr.append(createNode("priceMultiplierB", 0.0, 5));
-    tradeValueArr.append(createNode("rewardExp", 1, 1));
-    tradeValueArr.append(buildItemNbt("sell", trade.sell));
-    tradeValueArr.append(createNode("tier", trade.tier, 3));
-    tradeValueArr.append(createNode("traderExp", 5, 3));
-    tradeValueArr.append(createNode("uses", trade.uses, 3));
-
-    return createNode("", tradeValueArr, 10);
-}
-
-QString VillagerEditor::serializeNbtData(const QList<TradeOption> &trades)
-{
-    QJsonArray recipesArr;
-    for (const TradeOption &trade : trades) {
-        recipesArr.append(buildSingleTradeJson(trade));
-    }
-    QJsonObject recipesObj = createNode("Recipes", recipesArr, 9);
-
-    // 构建 TierExpRequirements (硬编码以适配格式)
-    QJsonArray tierExpArr;
-    tierExpArr.append(createNode("", QJsonArray{createNode("0", 0, 3)}, 10));
-    tierExpArr.append(createNode("", QJsonArray{createNode("1", 10, 3)}, 10));
-    tierExpArr.append(createNode("", QJsonArray{createNode("2", 70, 3)}, 10));
-    tierExpArr.append(createNode("", QJsonArray{createNode("3", 150, 3)}, 10));
-    tierExpArr.append(createNode("", QJsonArray{createNode("4", 250, 3)}, 10));
-    QJsonObject tierExpObj = createNode("TierExpRequirements", tierExpArr, 9);
-
-    QJsonArray offersArr;
-    offersArr.append(recipesObj);
-    offersArr.append(tierExpObj);
-    QJsonObject offersObj = createNode("Offers", offersArr, 10);
-
-    // 头尾硬编码保护格式绝对正确 (保留你原本的长字符串)
-    QString fixedHead = "{\"name\":\"\",\"value\":[{\"name\":\"format_version\",\"value\":1,\"type\":3},{\"name\":\"size\",\"value\":[{\"name\":\"\",\"value\":1,\"type\":3},{\"name\":\"\",\"value\":1,\"type\":3},{\"name\":\"\",\"value\":1,\"type\":3}],\"type\":9},{\"name\":\"structure\",\"value\":[{\"name\":\"block_indices\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"\",\"value\":-1,\"type\":3}],\"type\":9},{\"name\":\"\",\"value\":[{\"name\":\"\",\"value\":-1,\"type\":3}],\"type\":9}],\"type\":9},{\"name\":\"entities\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Air\",\"value\":300,\"type\":2},{\"name\":\"Armor\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10}],\"type\":9},{\"name\":\"Attributes\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":20.0,\"type\":5},{\"name\":\"Current\",\"value\":20.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":20.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":20.0,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:health\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":128.0,\"type\":5},{\"name\":\"Current\",\"value\":128.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":2048.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":2048.0,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:follow_range\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.0,\"type\":5},{\"name\":\"Current\",\"value\":0.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":1.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":1.0,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:knockback_resistance\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.5,\"type\":5},{\"name\":\"Current\",\"value\":0.5,\"type\":5},{\"name\":\"DefaultMax\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:movement\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.02,\"type\":5},{\"name\":\"Current\",\"value\":0.02,\"type\":5},{\"name\":\"DefaultMax\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:underwater_movement\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.02,\"type\":5},{\"name\":\"Current\",\"value\":0.02,\"type\":5},{\"name\":\"DefaultMax\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":3.4028235E38,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:lava_movement\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.0,\"type\":5},{\"name\":\"Current\",\"value\":0.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":16.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":0.0,\"type\":5},{\"name\":\"Max\",\"value\":16.0,\"type\":5},{\"name\":\"Min\",\"value\":0.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:absorption\",\"type\":8}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Base\",\"value\":0.0,\"type\":5},{\"name\":\"Current\",\"value\":0.0,\"type\":5},{\"name\":\"DefaultMax\",\"value\":1024.0,\"type\":5},{\"name\":\"DefaultMin\",\"value\":-1024.0,\"type\":5},{\"name\":\"Max\",\"value\":1024.0,\"type\":5},{\"name\":\"Min\",\"value\":-1024.0,\"type\":5},{\"name\":\"Name\",\"value\":\"minecraft:luck\",\"type\":8}],\"type\":10}],\"type\":9},{\"name\":\"ChestItems\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":0,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":1,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":2,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":3,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":4,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":5,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":6,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10},{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"Slot\",\"value\":7,\"type\":1},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10}],\"type\":9},{\"name\":\"Chested\",\"value\":0,\"type\":1},{\"name\":\"Color\",\"value\":0,\"type\":1},{\"name\":\"Color2\",\"value\":0,\"type\":1},{\"name\":\"Dead\",\"value\":0,\"type\":1},{\"name\":\"DeathTime\",\"value\":0,\"type\":2},{\"name\":\"DwellingUniqueID\",\"value\":\"00000000-0000-0000-0000-000000000000\",\"type\":8},{\"name\":\"FallDistance\",\"value\":0.0,\"type\":5},{\"name\":\"HighTierCuredDiscount\",\"value\":0,\"type\":3},{\"name\":\"HurtTime\",\"value\":0,\"type\":2},{\"name\":\"InventoryVersion\",\"value\":\"1.21.132\",\"type\":8},{\"name\":\"Invulnerable\",\"value\":0,\"type\":1},{\"name\":\"IsAngry\",\"value\":0,\"type\":1},{\"name\":\"IsAutonomous\",\"value\":0,\"type\":1},{\"name\":\"IsBaby\",\"value\":0,\"type\":1},{\"name\":\"IsEating\",\"value\":0,\"type\":1},{\"name\":\"IsGliding\",\"value\":0,\"type\":1},{\"name\":\"IsGlobal\",\"value\":0,\"type\":1},{\"name\":\"IsIllagerCaptain\",\"value\":0,\"type\":1},{\"name\":\"IsInRaid\",\"value\":0,\"type\":1},{\"name\":\"IsOrphaned\",\"value\":0,\"type\":1},{\"name\":\"IsOutOfControl\",\"value\":0,\"type\":1},{\"name\":\"IsPregnant\",\"value\":0,\"type\":1},{\"name\":\"IsRoaring\",\"value\":0,\"type\":1},{\"name\":\"IsScared\",\"value\":0,\"type\":1},{\"name\":\"IsStunned\",\"value\":0,\"type\":1},{\"name\":\"IsSwimming\",\"value\":0,\"type\":1},{\"name\":\"IsTamed\",\"value\":0,\"type\":1},{\"name\":\"IsTrusting\",\"value\":0,\"type\":1},{\"name\":\"LeasherID\",\"value\":\"-1\",\"type\":4},{\"name\":\"LootDropped\",\"value\":0,\"type\":1},{\"name\":\"LowTierCuredDiscount\",\"value\":0,\"type\":3},{\"name\":\"Mainhand\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10}],\"type\":9},{\"name\":\"MarkVariant\",\"value\":__MARKVARIANT__,\"type\":3},{\"name\":\"NaturalSpawn\",\"value\":0,\"type\":1},{\"name\":\"NearbyCuredDiscount\",\"value\":0,\"type\":3},{\"name\":\"NearbyCuredDiscountTimeStamp\",\"value\":0,\"type\":3},";
-    QString fixedFoot = ",{\"name\":\"Offhand\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"Count\",\"value\":0,\"type\":1},{\"name\":\"Damage\",\"value\":0,\"type\":2},{\"name\":\"Name\",\"value\":\"\",\"type\":8},{\"name\":\"WasPickedUp\",\"value\":0,\"type\":1}],\"type\":10}],\"type\":9},{\"name\":\"OnGround\",\"value\":1,\"type\":1},{\"name\":\"OwnerNew\",\"value\":\"-1\",\"type\":4},{\"name\":\"Persistent\",\"value\":1,\"type\":1},{\"name\":\"PortalCooldown\",\"value\":0,\"type\":3},{\"name\":\"Pos\",\"value\":[{\"name\":\"\",\"value\":-58.5,\"type\":5},{\"name\":\"\",\"value\":-59.0,\"type\":5},{\"name\":\"\",\"value\":-223.5,\"type\":5}],\"type\":9},{\"name\":\"PreferredProfession\",\"value\":\"cartographer\",\"type\":8},{\"name\":\"ReactToBell\",\"value\":0,\"type\":1},{\"name\":\"RewardPlayersOnFirstFounding\",\"value\":1,\"type\":1},{\"name\":\"Riches\",\"value\":0,\"type\":3},{\"name\":\"Rotation\",\"value\":[{\"name\":\"\",\"value\":97.6936,\"type\":5},{\"name\":\"\",\"value\":39.88098,\"type\":5}],\"type\":9},{\"name\":\"Saddled\",\"value\":0,\"type\":1},{\"name\":\"Sheared\",\"value\":0,\"type\":1},{\"name\":\"ShowBottom\",\"value\":0,\"type\":1},{\"name\":\"Sitting\",\"value\":0,\"type\":1},{\"name\":\"SkinID\",\"value\":2,\"type\":3},{\"name\":\"SlotDropChances\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"DropChance\",\"value\":0.0,\"type\":5},{\"name\":\"Slot\",\"value\":\"mainhand\",\"type\":8}],\"type\":10}],\"type\":9},{\"name\":\"Strength\",\"value\":0,\"type\":3},{\"name\":\"StrengthMax\",\"value\":0,\"type\":3},{\"name\":\"Surface\",\"value\":0,\"type\":1},{\"name\":\"Tags\",\"value\":[],\"type\":9},{\"name\":\"TargetID\",\"value\":\"-1\",\"type\":4},{\"name\":\"TradeExperience\",\"value\":0,\"type\":3},{\"name\":\"TradeTier\",\"value\":0,\"type\":3},{\"name\":\"UniqueID\",\"value\":\"-317827579897\",\"type\":4},{\"name\":\"Variant\",\"value\":6,\"type\":3},{\"name\":\"Willing\",\"value\":0,\"type\":1},{\"name\":\"boundX\",\"value\":0,\"type\":3},{\"name\":\"boundY\",\"value\":0,\"type\":3},{\"name\":\"boundZ\",\"value\":0,\"type\":3},{\"name\":\"canPickupItems\",\"value\":0,\"type\":1},{\"name\":\"definitions\",\"value\":[{\"name\":\"\",\"value\":\"+minecraft:villager_v2\",\"type\":8},{\"name\":\"\",\"value\":\"+villager_skin_2\",\"type\":8},{\"name\":\"\",\"value\":\"+adult\",\"type\":8},{\"name\":\"\",\"value\":\"__PROFESSION__\",\"type\":8},{\"name\":\"\",\"value\":\"+basic_schedule\",\"type\":8},{\"name\":\"\",\"value\":\"-job_specific_goals\",\"type\":8}],\"type\":9},{\"name\":\"hasBoundOrigin\",\"value\":0,\"type\":1},{\"name\":\"hasSetCanPickupItems\",\"value\":1,\"type\":1},{\"name\":\"identifier\",\"value\":\"minecraft:villager_v2\",\"type\":8},{\"name\":\"internalComponents\",\"value\":[],\"type\":10}],\"type\":10}],\"type\":9},{\"name\":\"palette\",\"value\":[{\"name\":\"default\",\"value\":[{\"name\":\"block_palette\",\"value\":[],\"type\":9},{\"name\":\"block_position_data\",\"value\":[],\"type\":10}],\"type\":10}],\"type\":10}],\"type\":10},{\"name\":\"structure_world_origin\",\"value\":[{\"name\":\"\",\"value\":-59,\"type\":3},{\"name\":\"\",\"value\":-59,\"type\":3},{\"name\":\"\",\"value\":-224,\"type\":3}],\"type\":9}],\"type\":10}";
-
-    QJsonDocument doc;
-    doc.setObject(offersObj);
-    QString middle = doc.toJson(QJsonDocument::Compact);
-
-    QString full = fixedHead + middle + fixedFoot;
-
-    // 替换占位符
-    full.replace("__PROFESSION__", "+" + m_profession);   // m_profession 不带 +
-    full.replace("__MARKVARIANT__", QString::number(m_markVariant));
-
-    return full;
-}
-
-// ==================== 文件读写 ====================
-
-ItemData VillagerEditor::parseItemData(const QJsonArray &arr)
-{
-    ItemData item;
-    QJsonArray customNodes; // 临时收集自定义节点
-    for (const QJsonValue &v : arr) {
-        if (!v.isObject()) continue;
-        QJsonObject obj = v.toObject();
-        QString n = obj.value("name").toString();
-        QJsonValue val = obj.value("value");
-
-        if (n == "Count") item.count = val.toInt();
-        else if (n == "Damage") item.damage = val.toInt();
-        else if (n == "Name") item.name = val.toString();
-        else if (n == "WasPickedUp") {
-            // 忽略，保持默认值
-        }
-        else if (n == "tag" && val.isArray()) {
-            // 原有 tag 解析保持不变
-            QJsonArray tagArr = val.toArray();
-            for (const QJsonValue &tv : tagArr) {
-                QJsonObject tobj = tv.toObject();
-                QString tn = tobj.value("name").toString();
-
-                if (tn == "display" && tobj.value("value").isArray()) {
-                    for (const QJsonValue &dv : tobj.value("value").toArray()) {
-                        QJsonObject dobj = dv.toObject();
-                        if (dobj.value("name").toString() == "Name") {
-                            item.enableName = true;
-                            item.displayName = dobj.value("value").toString();
-                        } else if (dobj.value("name").toString() == "Lore") {
-                            item.enableLore = true;
-                            QJsonArray loreArr = dobj.value("value").toArray();
-                            QStringList lines;
-                            for (const QJsonValue &lv : loreArr) {
-                                if (lv.isObject()) {
-                                    lines.append(lv.toObject().value("value").toString());
-                                }
-                            }
-                            item.lore = lines.join('\n');   // 用换行符拼接，用于 UI 显示
-                        }
-                    }
-                } else if (tn == "ench" && tobj.value("value").isArray()) {
-                    item.enableEnch = true;
-                    QJsonArray enchArr = tobj.value("value").toArray();
-                    if (!enchArr.isEmpty()) {
-                        QJsonArray innerArr = enchArr[0].toObject().value("value").toArray();
-                        for (const QJsonValue &iv : innerArr) {
-                            QJsonObject iobj = iv.toObject();
-                            if (iobj.value("name").toString() == "id") item.enchId = iobj.value("value").toInt();
-                            if (iobj.value("name").toString() == "lvl") item.enchLevel = iobj.value("value").toInt();
-                        }
-                    }
-                }
-                // 注意：tag 内部的其他节点不会单独处理，它们将保留在原有的 tag 节点中，不会丢失
-            }
-        }
-        else {
-            // 不是标准字段，则视为自定义节点，保留原样
-            customNodes.append(obj);
-        }
-    }
-
-    if (!customNodes.isEmpty()) {
-        item.enableCustom = true;
-        item.customNodes = customNodes;
-    }
-    return item;
-}
-
-QList<TradeOption> VillagerEditor::parseNbtData(const QString &nbtText)
-{
-    QList<TradeOption> trades;
-    QJsonParseError err;
-    QJsonDocument doc = QJsonDocument::fromJson(nbtText.toUtf8(), &err);
-    if (err.error != QJsonParseError::NoError) {
-        return trades;
-    }
-
-    // 1. 获取最外层根数组
-    QJsonArray rootArr;
-    if (doc.isObject() && doc.object().contains("value")) {
-        rootArr = doc.object().value("value").toArray();
-    } else if (doc.isArray()) {
-        rootArr = doc.array();
-    }
-
-    // 2. 核心修复：使用递归函数，无视固定头尾的层层嵌套，直接提取 Offers 和 Recipes
-    QJsonArray offersArr = findNbtArray(rootArr, "Offers");
-    QJsonArray recipesArr = findNbtArray(offersArr, "Recipes");
-
-    // 3. 开始解析交易列表
-    for (const QJsonValue &r : recipesArr) {
-        TradeOption trade;
-        for (const QJsonValue &f : r.toObject().value("value").toArray()) {
-            QJsonObject fObj = f.toObject();
-            QString name = fObj.value("name").toString();
-
-            if (name == "buyA") trade.buyA = parseItemData(fObj.value("value").toArray());
-            else if (name == "buyB") trade.buyB = parseItemData(fObj.value("value").toArray());
-            else if (name == "sell") trade.sell = parseItemData(fObj.value("value").toArray());
-            else if (name == "uses") trade.uses = fObj.value("value").toInt();
-            else if (name == "maxUses") trade.maxUses = fObj.value("value").toInt();
-            else if (name == "tier") trade.tier = fObj.value("value").toInt();
-        }
-        trades.append(trade);
-    }
-
-    return trades;
-}
-
-void VillagerEditor::loadFile()
-{
-    QString path = QFileDialog::getOpenFileName(this, "加载文件", "", "JSON (*.json);;所有 (*.*)");
-    if (path.isEmpty()) return;
-
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return;
-    QString text = file.readAll();
-    file.close();
-
-    m_tradeOptions = parseNbtData(text);
-    extractGlobalAttributes(text); // <== 新增：提取职业和变种
-
-    updateTradeTable();
-
-    // 更新 UI 下拉框
-    m_isUpdatingUI = true;
-    int profIndex = m_cbProfession->findData(m_profession);
-    if (profIndex >= 0) m_cbProfession->setCurrentIndex(profIndex);
-    int varIndex = m_cbMarkVariant->findData(m_markVariant);
-    if (varIndex >= 0) m_cbMarkVariant->setCurrentIndex(varIndex);
-    m_isUpdatingUI = false;
-
-
-    if (!m_tradeOptions.isEmpty()) {
-        m_tradeTable->selectRow(0);
-        onTableItemSelected(0, 0);
-    } else {
-        TradeOption empty;
-        populateUIFromData(empty);
-        m_selectedTradeRow = -1;
-    }
-    m_tePreview->setText(text);
-    QMessageBox::information(this, "加载成功", QString("解析到 %1 条交易").arg(m_tradeOptions.size()));
-}
-
-void VillagerEditor::saveFile()
-{
-    // 新增：先验证所有自定义节点的有效性
-    if (!validateCustomNodes()) {
-        QMessageBox::warning(this, "保存失败",
-                             "存在启用了自定义NBT节点但内容为空或无效的交易项。\n"
-                             "请确保每个启用了自定义节点的输入框中的JSON格式正确（必须是数组，每个元素为对象，包含name, value, type）。");
-        return;
-    }
-
-    QString path = QFileDialog::getSaveFileName(this, "保存文件", "", "JSON (*.json)");
-    if (path.isEmpty()) return;
-
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return;
-    file.write(serializeNbtData(m_tradeOptions).toUtf8());
-    file.close();
-    QMessageBox::information(this, "成功", "保存完毕");
-}
-
-void VillagerEditor::updateCompleters()
-{
-    QList<ItemMapping> itemMappings = loadItemMappings();
-    QStringList completerItems;
-    for (const auto &mapping : itemMappings) {
-        completerItems << mapping.chineseName
-                       << mapping.englishId
-                       << QString("%1（%2）").arg(mapping.chineseName, mapping.englishId);
-    }
-
-    auto setupCompleter = [&](QLineEdit *le) {
-        QCompleter *completer = new QCompleter(completerItems, this);
-        completer->setCaseSensitivity(Qt::CaseInsensitive);
-        le->setCompleter(completer);
-    };
-
-    setupCompleter(wBuyA.leName);
-    setupCompleter(wBuyB.leName);
-    setupCompleter(wSell.leName);
-}
-
-// ==================== 物品库配置系统 ====================
-
-// 1. 生成默认的配置文件
-void VillagerEditor::createDefaultItemConfig(const QString &path)
-{
-    QFile file(path);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream out(&file);
-        out.setEncoding(QStringConverter::Utf8);
-        out << "# Minecraft 村民交易物品配置文件\n";
-        out << "# 格式：分类, 英文ID, 中文名, 默认Damage值, 预设JSON(可选，必须为数组，且整体用双引号括起来，内部双引号写两次)\n";
-        out << "# 示例：武器, minecraft:diamond_sword, 钻石剑, 32767, \"[{\"\"name\"\":\"\"ench\"\",\"\"value\"\":[{\"\"name\"\":\"\"\"\",\"\"value\"\":[{\"\"name\"\":\"\"id\"\",\"\"value\"\":15,\"\"type\"\":2},{\"\"name\"\":\"\"lvl\"\",\"\"value\"\":5,\"\"type\"\":2}],\"\"type\"\":10}],\"\"type\"\":9}]\"\n";
-        out << "# 以 # 开头的行是注释，不会被读取\n\n";
-
-        out << "基础, minecraft:air, 空气, 0,\n";
-        out << "矿物, minecraft:emerald, 绿宝石, 0,\n";
-        out << "矿物, minecraft:diamond, 钻石, 0,\n";
-        out << "矿物, minecraft:iron_ingot, 铁锭, 0,\n";
-        out << "矿物, minecraft:gold_ingot, 金锭, 0,\n";
-        out << "武器, minecraft:iron_sword, 铁剑, 32767,\n";
-
-        // 为钻石剑添加预设 JSON，并进行 CSV 转义：整体加双引号，内部双引号替换为两个
-        QString rawJson = "[{\"name\":\"ench\",\"value\":[{\"name\":\"\",\"value\":[{\"name\":\"id\",\"value\":15,\"type\":2},{\"name\":\"lvl\",\"value\":5,\"type\":2}],\"type\":10}],\"type\":9}]";
-        QString escapedJson = rawJson;
-        escapedJson.replace("\"", "\"\""); // 将每个双引号替换为两个双引号
-        out << "武器, minecraft:diamond_sword, 钻石剑, 32767, \"" << escapedJson << "\"\n";
-
-        out << "食物, minecraft:bread, 面包, 0,\n";
-        out << "食物, minecraft:apple, 苹果, 0,\n";
-        out << "方块, minecraft:chest, 箱子, 0,\n";
-        file.close();
-    }
-}
-
-// 2. 从文件读取物品映射列表
-QList<ItemMapping> VillagerEditor::loadItemMappings()
-{
-    QList<ItemMapping> items;
-    QString path = QCoreApplication::applicationDirPath() + "/items_config.csv";
-    QFile file(path);
-
-    if (!file.exists()) {
-        createDefaultItemConfig(path);
-    }
-
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream in(&file);
-        in.setEncoding(QStringConverter::Utf8);
-        while (!in.atEnd()) {
-            QString line = in.readLine().trimmed();
-            if (line.isEmpty() || line.startsWith('#')) continue;
-
-            QList<QString> parts = parseCsvLine(line);  // 使用新解析函数
-            if (parts.size() >= 4) {
-                ItemMapping mapping;
-                mapping.category = parts[0].trimmed();
-                mapping.englishId = parts[1].trimmed();
-                mapping.chineseName = parts[2].trimmed();
-                mapping.defaultDamage = parts[3].trimmed().toInt();
-                // 读取第五列（预设 JSON），如果有的话
-                if (parts.size() >= 5) {
-                    mapping.presetJson = parts[4].trimmed();
-                    // 注意：parseCsvLine 已经去除了外层引号，并处理了双引号转义（两个双引号->一个）
-                    // 所以直接赋值即可
-                } else {
-                    mapping.presetJson.clear();
-                }
-                items.append(mapping);
-            }
-        }
-        file.close();
-    }
-    return items;
-}
-
-// 3. 核心功能：内置的配置文件文本编辑器
-void VillagerEditor::openItemConfigEditor()
-{
-    QDialog dialog(this);
-    dialog.setWindowTitle("⚙️ 编辑物品库配置 (items_config.csv)");
-    dialog.resize(600, 500);
-    QVBoxLayout layout(&dialog);
-
-    QLabel *helpLabel = new QLabel(
-        "<b>配置格式：</b> 分类, 英文ID, 中文名, Damage, 预设JSON<br>"
-        "<b>示例：</b> <code>武器, minecraft:diamond_sword, 钻石剑, 32767, \"[{\"\"name\"\":\"\"ench\"\",...}]\"</code><br>"
-        "<font color='gray'>注意：如果预设JSON中包含逗号或双引号，必须用双引号括起来，且内部的每个双引号写两次（如 \"\" ）。<br>"
-        "可使用下方的转换按钮将普通JSON快速转换为CSV兼容格式。</font>", &dialog);
-    layout.addWidget(helpLabel);
-
-    QTextEdit *editor = new QTextEdit(&dialog);
-    editor->setStyleSheet("font-family: Consolas, monospace; font-size: 14px;");
-
-    QString path = QCoreApplication::applicationDirPath() + "/items_config.csv";
-    QFile file(path);
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        editor->setPlainText(QString::fromUtf8(file.readAll()));
-        file.close();
-    }
-    layout.addWidget(editor);
-
-    QHBoxLayout *btnLayout = new QHBoxLayout();
-    QPushButton *btnSave = new QPushButton("保存并刷新", &dialog);
-    QPushButton *btnCancel = new QPushButton("取消", &dialog);
-    QPushButton *btnConvert = new QPushButton("转换选中JSON为CSV格式", &dialog);
-    btnLayout->addStretch();
-    btnLayout->addWidget(btnConvert);
-    btnLayout->addWidget(btnSave);
-    btnLayout->addWidget(btnCancel);
-    layout.addLayout(btnLayout);
-    //转换
-    connect(btnConvert, &QPushButton::clicked, [&]() {
-        QTextCursor cursor = editor->textCursor();
-        QString selected = cursor.selectedText();
-        if (selected.isEmpty()) {
-            QMessageBox::information(&dialog, "提示", "请先选中要转换的JSON文本。");
-            return;
-        }
-
-        // Qt的selectedText使用段落分隔符(U+2029)表示换行，转换为普通换行符
-        selected.replace(QChar(0x2029), '\n');
-
-        QString toConvert;
-
-        // 尝试解析为JSON对象或数组
-        QJsonParseError err;
-        QJsonDocument doc = QJsonDocument::fromJson(selected.toUtf8(), &err);
-        if (err.error == QJsonParseError::NoError && (doc.isArray() || doc.isObject())) {
-            // 成功解析，压缩为单行紧凑格式（自动处理转义）
-            toConvert = doc.toJson(QJsonDocument::Compact);
-        } else {
-            // 不是完整JSON，将其作为普通字符串，通过JSON序列化获得转义后的字符串内容
-            QJsonArray arr;
-            arr.append(selected);
-            QJsonDocument arrDoc(arr);
-            QString arrJson = arrDoc.toJson(QJsonDocument::Compact);
-            // arrJson 格式为 ["..."]，提取中间的转义字符串
-            if (arrJson.size() >= 4) {
-                // 去掉开头的 [" 和结尾的 "]
-                toConvert = arrJson.mid(2, arrJson.size() - 4);
-            } else {
-                toConvert = selected;
-            }
-        }
-
-        // CSV转义：每个双引号替换为两个，外层加双引号
-        QString escaped = toConvert;
-        escaped.replace("\"", "\"\"");
-        QString result = "\"" + escaped + "\"";
-
-        cursor.insertText(result);
-    });
-
-    // 保存功能
-    connect(btnSave, &QPushButton::clicked, [&, this]() {
-        QString content = editor->toPlainText();
-        QString path = QCoreApplication::applicationDirPath() + "/items_config.csv";
-        QFile file(path);
-        if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-            QTextStream out(&file);
-            out.setEncoding(QStringConverter::Utf8);
-            out << content;
-            file.close();
-
-            updateCompleters();   // 刷新自动补全
-            dialog.accept();
-            QMessageBox::information(this, "成功", "物品库配置已更新并生效！");
-        } else {
-            QMessageBox::warning(this, "错误", "无法保存文件，请检查权限！");
-        }
-    });
-
-    connect(btnCancel, &QPushButton::clicked, &dialog, &QDialog::reject);
-
-    dialog.exec();
-}
-
-bool VillagerEditor::validateCustomNodes() const
-{
-    for (const TradeOption &trade : m_tradeOptions) {
-        // 检查三个物品的自定义节点
-        const ItemData* items[3] = { &trade.buyA, &trade.buyB, &trade.sell };
-        for (const ItemData* item : items) {
-            if (item->enableCustom) {
-                // 如果启用了自定义节点，但 customNodes 为空（解析失败或内容为空），则视为无效
-                if (item->customNodes.isEmpty()) {
-                    return false;
-                }
-                // 可选：进一步检查每个节点是否包含必要的字段，但通常 JSON 解析时已保证结构
-            }
-        }
-    }
-    return true;
-}
-
-void VillagerEditor::onGlobalAttributeChanged()
-{
-    if (m_isUpdatingUI) return;
-    m_profession = m_cbProfession->currentData().toString();
-    m_markVariant = m_cbMarkVariant->currentData().toInt();
-    onDataChanged(); // 触发预览更新
-}
-
-void VillagerEditor::extractGlobalAttributes(const QString &jsonText)
-{
-    QJsonParseError err;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonText.toUtf8(), &err);
-    if (err.error != QJsonParseError::NoError) {
-        // 使用默认值
-        m_profession = "cartographer";
-        m_markVariant = 0;
-        return;
-    }
-
-    QJsonArray rootArr;
-    if (doc.isObject() && doc.object().contains("value")) {
-        rootArr = doc.object().value("value").toArray();
-    } else if (doc.isArray()) {
-        rootArr = doc.array();
-    } else {
-        m_profession = "cartographer";
-        m_markVariant = 0;
-        return;
-    }
-
-    // 查找 MarkVariant
-    m_markVariant = 0;
-    for (const QJsonValue &v : rootArr) {
-        if (v.isObject()) {
-            QJsonObject obj = v.toObject();
-            if (obj.value("name").toString() == "MarkVariant") {
-                m_markVariant = obj.value("value").toInt();
-                break;
-            }
-        }
-    }
-
-    // 查找 definitions 数组
-    QJsonArray defArr = findNbtArray(rootArr, "definitions");
-    m_profession = "cartographer"; // 默认
-    if (!defArr.isEmpty()) {
-        for (const QJsonValue &v : defArr) {
-            if (!v.isObject()) continue;
-            QJsonObject obj = v.toObject();
-            QString val = obj.value("value").toString();
-            if (val.startsWith('+')) {
-                QString prof = val.mid(1);
-                // 排除固定定义
-                static const QStringList fixedDefs = {"minecraft:villager_v2", "villager_skin_2", "adult", "basic_schedule", "-job_specific_goals"};
-                if (!fixedDefs.contains(prof)) {
-                    m_profession = prof;
-                    break;
-                }
-            }
-        }
-    }
-}
+#include "villagereditor.h"
+#include "bulkedit.h"
+#include "catalogservice.h"
+#include "editjournal.h"
+#include "nbtcodec.h"
+#include "tracer.h"
+#include "tradefields.h"
+#include "stallwatchdog.h"
+#include "memtrace.h"
+#include "jsonescape.h"
+#include <QApplication>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QDir>
+#include <QMessageBox>
+#include <QJsonDocument>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QGridLayout>
+#include <QLabel>
+#include <QListWidget>
+#include <QCompleter>
+#include <QFile>
+#include <QHeaderView>
+#include <QStatusBar>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QTimer>
+#include <QShortcut>
+#include <QSet>
+#include <QMap>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+// 物品 ID 是否可以接受：空物品（空气、空名称）不要求在物品库中
+static bool isItemIdAccepted(const ItemIdResolver &resolver, const ItemData &d) {
+    if (d.name.isEmpty() || d.name == "minecraft:air") return true;
+    return resolver.isKnownId(d.name);
+}
+
+// 未知物品 ID 列表的提示文本（最多列出 10 个）
+static QString formatUnknownIds(const QStringList &ids) {
+    const int shown = 10;
+    QString text = ids.mid(0, shown).join("\n");
+    if (ids.size() > shown) text += QString("\n……共 %1 个").arg(ids.size());
+    return text;
+}
+
+VillagerEditor::VillagerEditor(QWidget *parent)
+    : QMainWindow(parent)
+    , m_profession("cartographer")   // <== 默认职业
+    , m_markVariant(0)               // <== 默认变种
+{
+    m_document.villagers.append(VillagerData());
+    m_villagerUndo.resize(1);
+    initUI();
+    m_undoStack.reset(currentUndoState());
+    updateUndoButtons();
+
+    // 编辑日志；上次异常退出留下的日志由 DocumentTabs 在新的标签页中恢复（见 recover）
+    m_journal = new EditJournal(this);
+
+    // 所有窗口与标签页都在同一个主线程上，共用一个监视器，避免同一次卡顿被记录多次
+    static StallWatchdog *sharedWatchdog = new StallWatchdog(StallWatchdog::defaultThresholdMs(), qApp);
+    m_watchdog = sharedWatchdog;
+    connect(m_watchdog, &StallWatchdog::stallRecorded, this, [this](const QString &stage, qint64 ms) {
+        if (!isActiveWindow() || !isVisible()) return;
+        statusBar()->showMessage(QString("界面卡顿 %1 ms（%2），按 Ctrl+Alt+W 查看记录")
+                                     .arg(ms).arg(stage.isEmpty() ? QString("未标记的阶段") : stage), 8000);
+    });
+    updateDocumentSize();
+
+    // 物品库在窗口显示后由工作线程加载，完成后再挂接自动补全和物品选择器
+    connect(CatalogService::instance(), &CatalogService::catalogReady, this, &VillagerEditor::updateCompleters);
+    if (CatalogService::instance()->isReady()) {
+        updateCompleters();
+    } else {
+        QTimer::singleShot(0, CatalogService::instance(), &CatalogService::loadAsync);
+    }
+}
+
+VillagerEditor::~VillagerEditor()
+{
+    m_journal->discard();   // 正常关闭，不需要恢复
+}
+
+void VillagerEditor::initUI()
+{
+    setWindowTitle("村民交易编辑器");
+    resize(1300, 900);
+
+    QWidget *centralWidget = new QWidget(this);
+    QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);
+    setCentralWidget(centralWidget);
+
+    // 工具栏
+    QHBoxLayout *toolLayout = new QHBoxLayout();
+    QPushButton *btnLoad = new QPushButton("加载源文件", this);
+    QPushButton *btnSave = new QPushButton("保存文件", this);
+    QPushButton *btnExportPacked = new QPushButton("打包导出", this);
+    btnExportPacked->setToolTip("把所有村民按网格排进同一个结构文件");
+    QPushButton *btnAdd = new QPushButton("添加交易项", this);
+    QPushButton *btnDelete = new QPushButton("删除选中项", this);
+    QPushButton *btnBulkEdit = new QPushButton("批量修改", this);
+    btnBulkEdit->setToolTip("对表格中选中的所有交易执行同一修改（按住 Ctrl 或 Shift 多选）；有筛选且没有选中时作用于所有匹配的交易");
+    QPushButton *btnEditItems = new QPushButton("⚙️ 编辑物品库", this); // <== 新增按钮
+    m_btnUndo = new QPushButton("撤销", this);
+    m_btnRedo = new QPushButton("重做", this);
+    m_btnUndo->setToolTip("撤销 (Ctrl+Z)");
+    m_btnRedo->setToolTip("重做 (Ctrl+Y / Ctrl+Shift+Z)");
+    toolLayout->addWidget(btnLoad);
+    toolLayout->addWidget(btnSave);
+    toolLayout->addWidget(btnExportPacked);
+    toolLayout->addWidget(btnAdd);
+    toolLayout->addWidget(btnDelete);
+    toolLayout->addWidget(btnBulkEdit);
+    toolLayout->addWidget(m_btnUndo);
+    toolLayout->addWidget(m_btnRedo);
+    toolLayout->addWidget(btnEditItems); // <== 添加到布局
+    mainLayout->addLayout(toolLayout);
+
+    // 交易表格
+    m_tradeTable = new QTableWidget(this);
+    m_tradeTable->setColumnCount(9);
+    QStringList headers = {"BuyA物品名", "BuyA数量", "BuyB物品名", "BuyB数量", "Sell物品名", "Sell数量", "已用次数", "最大次数", "Tier"};
+    m_tradeTable->setHorizontalHeaderLabels(headers);
+    m_tradeTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_tradeTable->setSelectionMode(QAbstractItemView::ExtendedSelection);   // 多选后可批量修改
+    m_tradeTable->setEditTriggers(QTableWidget::NoEditTriggers);
+    m_tradeTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+    // 村民列表：文件中有多个村民实体时显示在表格左侧，点击切换正在编辑的村民
+    m_villagerList = new QListWidget(this);
+    m_villagerList->setMaximumWidth(220);
+    m_villagerList->hide();
+    QHBoxLayout *tableLayout = new QHBoxLayout();
+    tableLayout->addWidget(m_villagerList);
+    tableLayout->addWidget(m_tradeTable, 1);
+    // 筛选栏
+    QHBoxLayout *filterLayout = new QHBoxLayout();
+    m_leFilter = new QLineEdit(this);
+    m_leFilter->setClearButtonEnabled(true);
+    m_leFilter->setPlaceholderText("筛选交易，例如：sell.enableEnch && tier > 2 && (buyA.name ~ diamond || buyB.name ~ diamond)");
+    m_leFilter->setToolTip("字段：buyA / buyB / sell 的 name、count、damage、enableName、displayName、enableLore、lore、enableEnch、enchId、enchLevel、enableCustom，"
+                           "以及 uses、maxUses、tier\n自定义节点：sell.custom.名称，或 custom.名称（任一物品）\n"
+                           "比较：== != < <= > >= ~（包含） !~（不包含）　逻辑：&& || ! 与括号");
+    m_lblFilter = new QLabel(this);
+    filterLayout->addWidget(new QLabel("筛选:"));
+    filterLayout->addWidget(m_leFilter, 1);
+    filterLayout->addWidget(m_lblFilter);
+    mainLayout->addLayout(filterLayout);
+    mainLayout->addLayout(tableLayout, 1);
+
+    // 交易项参数编辑区
+    // 三个物品面板在第一次选中交易时创建（ensureItemPanels），启动时只有一行提示
+    m_editGroup = new QGroupBox("当前交易项编辑", this);
+    QHBoxLayout *editLayout = new QHBoxLayout(m_editGroup);
+    m_editHint = new QLabel("在上方表格中选择或添加交易项后在这里编辑", this);
+    m_editHint->setAlignment(Qt::AlignCenter);
+    editLayout->addWidget(m_editHint);
+
+    mainLayout->addWidget(m_editGroup);
+
+    // 基础属性区 (Uses, Tier)
+    QGroupBox *baseAttrGroup = new QGroupBox("基础属性", this);
+    QHBoxLayout *baseAttrLayout = new QHBoxLayout(baseAttrGroup);
+    baseAttrLayout->addWidget(new QLabel("已用次数(uses):"));
+    m_sbUses = new QSpinBox(this); m_sbUses->setRange(-32767, 32767);
+    baseAttrLayout->addWidget(m_sbUses);
+    baseAttrLayout->addWidget(new QLabel("最大次数(maxUses):"));
+    m_sbMaxUses = new QSpinBox(this); m_sbMaxUses->setRange(-32767, 32767);
+    baseAttrLayout->addWidget(m_sbMaxUses);
+    baseAttrLayout->addWidget(new QLabel("购买等级(Tier):"));
+    m_sbTier = new QSpinBox(this); m_sbTier->setRange(0, 5); m_sbTier->setValue(0);
+    baseAttrLayout->addWidget(m_sbTier);
+    baseAttrLayout->addStretch();
+    mainLayout->addWidget(baseAttrGroup);
+
+    // <== 新增：村民属性组（职业与变种）
+    QGroupBox *villagerGroup = new QGroupBox("村民属性", this);
+    QHBoxLayout *villagerLayout = new QHBoxLayout(villagerGroup);
+    villagerLayout->addWidget(new QLabel("职业:"));
+    m_cbProfession = new QComboBox(this);
+    // 职业列表：显示名 -> 数据（职业字符串，不带+）
+    m_cbProfession->addItem("制图师", "cartographer");
+    m_cbProfession->addItem("盔甲商", "armorer");
+    m_cbProfession->addItem("武器商", "weaponsmith");
+    m_cbProfession->addItem("石匠", "mason");
+    m_cbProfession->addItem("制箭师", "fletcher");
+    m_cbProfession->addItem("工具匠", "toolsmith");
+    m_cbProfession->addItem("屠夫", "butcher");
+    m_cbProfession->addItem("牧师", "cleric");
+    m_cbProfession->addItem("牧羊人", "shepherd");
+    m_cbProfession->addItem("农民", "farmer");
+    m_cbProfession->addItem("渔夫", "fisherman");
+    m_cbProfession->addItem("图书管理员", "librarian");
+    m_cbProfession->addItem("皮匠", "leatherworker");
+    villagerLayout->addWidget(m_cbProfession);
+
+    villagerLayout->addWidget(new QLabel("变种:"));
+    m_cbMarkVariant = new QComboBox(this);
+    m_cbMarkVariant->addItem("平原(0)", 0);
+    m_cbMarkVariant->addItem("沙漠(1)", 1);
+    m_cbMarkVariant->addItem("丛林(2)", 2);
+    m_cbMarkVariant->addItem("热带草原(3)", 3);
+    m_cbMarkVariant->addItem("雪原(4)", 4);
+    m_cbMarkVariant->addItem("沼泽(5)", 5);
+    m_cbMarkVariant->addItem("针叶林(6)", 6);
+    villagerLayout->addWidget(m_cbMarkVariant);
+    villagerLayout->addStretch();
+
+    mainLayout->addWidget(villagerGroup);
+
+    // 预览区
+    QGroupBox *previewGroup = new QGroupBox("文件预览", this);
+    QVBoxLayout *previewLayout = new QVBoxLayout(previewGroup);
+    m_tePreview = new QTextEdit(this);
+    m_tePreview->setReadOnly(true);
+    m_tePreview->setLineWrapMode(QTextEdit::NoWrap);
+    previewLayout->addWidget(m_tePreview);
+    mainLayout->addWidget(previewGroup, 1);
+
+    // 状态栏：后台加载 / 保存的进度与取消
+    m_progress = new QProgressBar(this);
+    m_progress->setMaximumWidth(240);
+    m_progress->hide();
+    m_btnCancel = new QPushButton("取消", this);
+    m_btnCancel->hide();
+    statusBar()->addPermanentWidget(m_progress);
+    statusBar()->addPermanentWidget(m_btnCancel);
+    m_editControls = { btnLoad, btnSave, btnExportPacked, btnAdd, btnDelete, btnBulkEdit, btnEditItems, m_btnUndo, m_btnRedo,
+                       m_editGroup, baseAttrGroup, villagerGroup, m_villagerList };
+
+    // 信号连接
+    connect(btnLoad, &QPushButton::clicked, this, &VillagerEditor::loadFile);
+    connect(btnSave, &QPushButton::clicked, this, &VillagerEditor::saveFile);
+    connect(btnExportPacked, &QPushButton::clicked, this, &VillagerEditor::exportPackedStructure);
+    connect(btnAdd, &QPushButton::clicked, this, &VillagerEditor::addTradeOption);
+    connect(btnDelete, &QPushButton::clicked, this, &VillagerEditor::deleteTradeOption);
+    connect(btnBulkEdit, &QPushButton::clicked, this, &VillagerEditor::bulkEditSelection);
+    connect(btnEditItems, &QPushButton::clicked, this, &VillagerEditor::openItemConfigEditor); // <== 绑定点击事件
+    connect(m_btnUndo, &QPushButton::clicked, this, &VillagerEditor::undo);
+    connect(m_btnRedo, &QPushButton::clicked, this, &VillagerEditor::redo);
+    // 焦点在文本框内时，Ctrl+Z 先由文本框自己处理（其修改同样会进入撤销栈）
+    connect(new QShortcut(QKeySequence::Undo, this), &QShortcut::activated, this, &VillagerEditor::undo);
+    connect(new QShortcut(QKeySequence::Redo, this), &QShortcut::activated, this, &VillagerEditor::redo);
+    connect(new QShortcut(QKeySequence("Ctrl+Shift+Z"), this), &QShortcut::activated, this, &VillagerEditor::redo);
+    connect(new QShortcut(QKeySequence("Ctrl+Alt+T"), this), &QShortcut::activated, this, &VillagerEditor::toggleTracing);
+    connect(new QShortcut(QKeySequence("Ctrl+Alt+W"), this), &QShortcut::activated, this, &VillagerEditor::showStallLog);
+#ifdef VTE_MEMTRACE
+    connect(new QShortcut(QKeySequence("Ctrl+Alt+M"), this), &QShortcut::activated, this, &VillagerEditor::showMemoryStats);
+#endif
+    connect(m_tradeTable, &QTableWidget::cellClicked, this, &VillagerEditor::onTableItemSelected);
+    m_filterTimer.setSingleShot(true);
+    m_filterTimer.setInterval(250);
+    connect(&m_filterTimer, &QTimer::timeout, this, &VillagerEditor::onFilterEdited);
+    connect(m_leFilter, &QLineEdit::textChanged, &m_filterTimer, QOverload<>::of(&QTimer::start));
+    connect(m_leFilter, &QLineEdit::returnPressed, this, &VillagerEditor::onFilterEdited);
+    connect(m_villagerList, &QListWidget::currentRowChanged, this, &VillagerEditor::switchVillager);
+    connect(m_cbProfession, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &VillagerEditor::onGlobalAttributeChanged);
+    connect(m_cbMarkVariant, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &VillagerEditor::onGlobalAttributeChanged);
+
+    // 后台加载 / 保存
+    connect(&m_loadWatcher, &QFutureWatcherBase::resultsReadyAt, this, &VillagerEditor::onLoadResults);
+    connect(&m_loadWatcher, &QFutureWatcherBase::finished, this, &VillagerEditor::onLoadFinished);
+    connect(&m_saveWatcher, &QFutureWatcherBase::finished, this, &VillagerEditor::onSaveFinished);
+    connect(&m_previewWatcher, &QFutureWatcherBase::finished, this, &VillagerEditor::onPreviewFinished);
+    m_previewPool.setMaxThreadCount(1);
+    for (QFutureWatcherBase *watcher : { static_cast<QFutureWatcherBase *>(&m_loadWatcher), static_cast<QFutureWatcherBase *>(&m_saveWatcher) }) {
+        connect(watcher, &QFutureWatcherBase::progressRangeChanged, m_progress, &QProgressBar::setRange);
+        connect(watcher, &QFutureWatcherBase::progressValueChanged, m_progress, &QProgressBar::setValue);
+    }
+    connect(m_btnCancel, &QPushButton::clicked, this, [this]() {
+        m_btnCancel->setEnabled(false);
+        m_loadWatcher.cancel();
+        m_saveWatcher.cancel();
+    });
+
+    // 绑定基础属性的同步槽
+    connect(m_sbUses, &QSpinBox::valueChanged, this, &VillagerEditor::onDataChanged);
+    connect(m_sbMaxUses, &QSpinBox::valueChanged, this, &VillagerEditor::onDataChanged);
+    connect(m_sbTier, &QSpinBox::valueChanged, this, &VillagerEditor::onDataChanged);
+}
+
+// 核心重构：高度抽象的 UI 生成器
+QGroupBox* VillagerEditor::createItemSection(const QString &title, ItemWidgets &w)
+{
+    QGroupBox *group = new QGroupBox(title, this);
+    QGridLayout *layout = new QGridLayout(group);
+    w.grid = layout;
+
+    // 基础物品信息
+    layout->addWidget(new QLabel("物品名:"), 0, 0);
+    w.leName = new QLineEdit(this);
+    layout->addWidget(w.leName, 0, 1, 1, 2);
+    w.btnSelect = new QPushButton("选择", this);
+    w.btnSelect->setEnabled(false);   // 物品库加载完成前不可用
+    w.btnSelect->setToolTip("物品库加载中…");
+    layout->addWidget(w.btnSelect, 0, 3);
+
+    layout->addWidget(new QLabel("数量:"), 1, 0);
+    w.sbCount = new QSpinBox(this); w.sbCount->setRange(0, 999);
+    layout->addWidget(w.sbCount, 1, 1);
+
+    layout->addWidget(new QLabel("Damage:"), 1, 2);
+    w.sbDamage = new QSpinBox(this); w.sbDamage->setRange(0, 32767);
+    layout->addWidget(w.sbDamage, 1, 3);
+
+    // Tag 信息：复选框常驻，对应的输入控件（第 3、5、6、8、9 行）由 ensureTagEditors 按需创建
+    w.cbEnableName = new QCheckBox("启用自定义名称", this);
+    layout->addWidget(w.cbEnableName, 2, 0, 1, 2);
+    w.cbEnableLore = new QCheckBox("启用注释(Lore)", this);
+    layout->addWidget(w.cbEnableLore, 4, 0, 1, 2);
+    w.cbEnableEnch = new QCheckBox("启用附魔", this);
+    layout->addWidget(w.cbEnableEnch, 6, 0, 1, 2);
+    // 新增：自定义 NBT 节点
+    w.cbEnableCustom = new QCheckBox("启用自定义NBT节点", this);
+    layout->addWidget(w.cbEnableCustom, 7, 0, 1, 4); // 占用整行
+
+    // 绑定所有的统一更新事件
+    auto syncSlot = &VillagerEditor::onDataChanged;
+    connect(w.leName, &QLineEdit::textChanged, this, syncSlot);
+    connect(w.leName, &QLineEdit::editingFinished, this, [this, &w]() { commitItemName(w); });
+    connect(w.sbCount, &QSpinBox::valueChanged, this, syncSlot);
+    connect(w.sbDamage, &QSpinBox::valueChanged, this, syncSlot);
+
+    // 绑定复选框状态显示/隐藏事件
+    connect(w.cbEnableName, &QCheckBox::stateChanged, this, &VillagerEditor::onTagCheckboxToggled);
+    connect(w.cbEnableLore, &QCheckBox::stateChanged, this, &VillagerEditor::onTagCheckboxToggled);
+    connect(w.cbEnableEnch, &QCheckBox::stateChanged, this, &VillagerEditor::onTagCheckboxToggled);
+
+    // 绑定物品选择按钮
+    connect(w.btnSelect, &QPushButton::clicked, this, [this, &w]() { openItemSelector(&w); });
+    // 连接自定义节点复选框的切换事件
+    connect(w.cbEnableCustom, &QCheckBox::toggled, this, [this, &w](bool checked) {
+        // 当自定义节点启用时，禁用并取消勾选其他三个复选框
+        w.cbEnableName->setEnabled(!checked);
+        w.cbEnableLore->setEnabled(!checked);
+        w.cbEnableEnch->setEnabled(!checked);
+
+        // 先创建自定义编辑框：下面取消勾选会触发 syncDataFromUI，届时它必须已存在
+        ensureTagEditors(w, selectedItemData(w), false, false, false, checked);
+        if (checked) {
+            w.cbEnableName->setChecked(false);
+            w.cbEnableLore->setChecked(false);
+            w.cbEnableEnch->setChecked(false);
+        }
+
+        // 显示/隐藏自定义编辑框
+        if (w.teCustom) w.teCustom->setVisible(checked);
+        validateCustomInput(w);
+        onDataChanged();   // 触发数据更新
+    });
+
+    return group;
+}
+
+void VillagerEditor::ensureItemPanels()
+{
+    if (wBuyA.leName) return;
+    m_editGroup->setUpdatesEnabled(false);
+    delete m_editHint;
+    m_editHint = nullptr;
+    // 抽象出三个相同的编辑面板
+    m_editGroup->layout()->addWidget(createItemSection("Buy A (主输入)", wBuyA));
+    m_editGroup->layout()->addWidget(createItemSection("Buy B (副输入)", wBuyB));
+    m_editGroup->layout()->addWidget(createItemSection("Sell (输出)", wSell));
+    if (CatalogService::instance()->isReady()) {
+        setupItemCompleter(wBuyA);
+        setupItemCompleter(wBuyB);
+        setupItemCompleter(wSell);
+    }
+    m_editGroup->setUpdatesEnabled(true);
+}
+
+void VillagerEditor::ensureTagEditors(ItemWidgets &w, const ItemData *data, bool name, bool lore, bool ench, bool custom)
+{
+    // 先填入初始内容再连接信号，创建控件本身不产生修改
+    if (name && !w.leDisp) {
+        w.leDisp = new QTextEdit(this);
+        w.leDisp->setMaximumHeight(60);
+        w.leDisp->setAcceptRichText(false);
+        if (data) w.leDisp->setPlainText(data->displayName);
+        w.grid->addWidget(w.leDisp, 3, 0, 1, 4);  // 独占一行
+        connect(w.leDisp, &QTextEdit::textChanged, this, &VillagerEditor::onDataChanged);
+    }
+    if (lore && !w.leLore) {
+        w.leLore = new QTextEdit(this);
+        w.leLore->setMaximumHeight(60);
+        w.leLore->setAcceptRichText(false);
+        if (data) w.leLore->setPlainText(data->lore);
+        w.grid->addWidget(w.leLore, 5, 0, 1, 4);  // 独占一行
+        connect(w.leLore, &QTextEdit::textChanged, this, &VillagerEditor::onDataChanged);
+    }
+    if (ench && !w.enchBox) {
+        w.enchBox = new QWidget(this);
+        QHBoxLayout *enchLayout = new QHBoxLayout(w.enchBox);
+        enchLayout->setContentsMargins(0, 0, 0, 0);
+        enchLayout->addWidget(new QLabel("ID:"));
+        w.sbEnchId = new QSpinBox(this); w.sbEnchId->setRange(0, 255);
+        enchLayout->addWidget(w.sbEnchId);
+        enchLayout->addWidget(new QLabel("Lvl:"));
+        w.sbEnchLvl = new QSpinBox(this); w.sbEnchLvl->setRange(1, 255);
+        enchLayout->addWidget(w.sbEnchLvl);
+        if (data) {
+            w.sbEnchId->setValue(data->enchId);
+            w.sbEnchLvl->setValue(data->enchLevel);
+        }
+        w.grid->addWidget(w.enchBox, 6, 2, 1, 2);
+        connect(w.sbEnchId, &QSpinBox::valueChanged, this, &VillagerEditor::onDataChanged);
+        connect(w.sbEnchLvl, &QSpinBox::valueChanged, this, &VillagerEditor::onDataChanged);
+    }
+    if (custom && !w.teCustom) {
+        w.teCustom = new QTextEdit(this);
+        w.teCustom->setPlaceholderText("输入JSON数组，例如：\n[{\"name\":\"CanPlaceOn\",\"value\":[\"minecraft:grass\"],\"type\":9}]");
+        w.teCustom->setMaximumHeight(100);
+        if (data && data->enableCustom) {
+            w.teCustom->setPlainText(unescapeForDisplay(QJsonDocument(data->customNodes).toJson(QJsonDocument::Indented)));
+        }
+        w.grid->addWidget(w.teCustom, 8, 0, 1, 4);
+        w.lblCustomStatus = new QLabel(this);
+        w.lblCustomStatus->setWordWrap(true);
+        w.lblCustomStatus->setStyleSheet("color: #c0392b;");
+        w.lblCustomStatus->setVisible(false);
+        w.grid->addWidget(w.lblCustomStatus, 9, 0, 1, 4);
+        // 连接文本变化
+        connect(w.teCustom, &QTextEdit::textChanged, this, &VillagerEditor::onDataChanged);
+        connect(w.teCustom, &QTextEdit::textChanged, this, [this, &w]() { validateCustomInput(w); });
+    }
+}
+
+const ItemData *VillagerEditor::selectedItemData(const ItemWidgets &w) const
+{
+    if (m_selectedTradeRow < 0 || m_selectedTradeRow >= m_tradeOptions.size()) return nullptr;
+    const TradeOption &trade = m_tradeOptions[m_selectedTradeRow];
+    if (&w == &wBuyA) return &trade.buyA;
+    if (&w == &wBuyB) return &trade.buyB;
+    return &trade.sell;
+}
+
+// 核心重构：统一的 UI 状态切换
+void VillagerEditor::onTagCheckboxToggled()
+{
+    if (m_isUpdatingUI) return;
+
+    auto toggle = [this](ItemWidgets &w) {
+        ensureTagEditors(w, selectedItemData(w), w.cbEnableName->isChecked(), w.cbEnableLore->isChecked(),
+                         w.cbEnableEnch->isChecked(), false);
+        if (w.leDisp) w.leDisp->setVisible(w.cbEnableName->isChecked());
+        if (w.leLore) w.leLore->setVisible(w.cbEnableLore->isChecked());
+        if (w.enchBox) w.enchBox->setVisible(w.cbEnableEnch->isChecked());
+    };
+    toggle(wBuyA); toggle(wBuyB); toggle(wSell);
+
+    onDataChanged(); // 触发保存
+}
+
+// 核心重构：单向数据流 - 数据推送到 UI
+void VillagerEditor::populateUIFromData(const TradeOption &trade)
+{
+    VTE_TRACE("VillagerEditor::populateUIFromData");
+    StallWatchdog::Stage stage("populateUIFromData");
+    m_isUpdatingUI = true; // 锁定，防止触发 onChange
+
+    auto fillItem = [this](ItemWidgets &w, const ItemData &d) {
+        w.leName->setText(d.name);
+        w.sbCount->setValue(d.count);
+        w.sbDamage->setValue(d.damage);
+
+        // 如果启用了自定义节点，则强制禁用并取消勾选内置 Tag 复选框
+        if (d.enableCustom) {
+            w.cbEnableName->setChecked(false);
+            w.cbEnableLore->setChecked(false);
+            w.cbEnableEnch->setChecked(false);
+            w.cbEnableName->setEnabled(false);
+            w.cbEnableLore->setEnabled(false);
+            w.cbEnableEnch->setEnabled(false);
+        } else {
+            w.cbEnableName->setChecked(d.enableName);
+            w.cbEnableLore->setChecked(d.enableLore);
+            w.cbEnableEnch->setChecked(d.enableEnch);
+            w.cbEnableName->setEnabled(true);
+            w.cbEnableLore->setEnabled(true);
+            w.cbEnableEnch->setEnabled(true);
+        }
+
+        // 需要显示的输入框还没创建时先创建（创建时已填好内容）；没创建的输入框对应的值只保存在数据中
+        const bool creating[] = { !w.leDisp, !w.leLore, !w.enchBox, !w.teCustom };
+        ensureTagEditors(w, &d, w.cbEnableName->isChecked(), w.cbEnableLore->isChecked(),
+                         w.cbEnableEnch->isChecked(), d.enableCustom);
+
+        // 设置显示文本（即使被禁用也保留内容）
+        if (w.leDisp) {
+            if (!creating[0]) w.leDisp->setPlainText(d.displayName);
+            w.leDisp->setVisible(w.cbEnableName->isChecked());
+        }
+        if (w.leLore) {
+            if (!creating[1]) w.leLore->setPlainText(d.lore);
+            w.leLore->setVisible(w.cbEnableLore->isChecked());
+        }
+        if (w.enchBox) {
+            if (!creating[2]) {
+                w.sbEnchId->setValue(d.enchId);
+                w.sbEnchLvl->setValue(d.enchLevel);
+            }
+            w.enchBox->setVisible(w.cbEnableEnch->isChecked());
+        }
+
+        // 自定义节点本身
+        w.cbEnableCustom->setChecked(d.enableCustom);
+        if (w.teCustom) {
+            if (creating[3]) {
+                validateCustomInput(w);
+            } else if (d.enableCustom) {
+                QJsonDocument doc(d.customNodes);
+                QString jsonText = doc.toJson(QJsonDocument::Indented);
+                w.teCustom->setPlainText(unescapeForDisplay(jsonText));  // 转换显示
+            } else {
+                w.teCustom->clear();
+            }
+            w.teCustom->setVisible(d.enableCustom);
+        }
+    };
+
+    // 还没有选中过交易时面板尚未创建，空白的交易项不需要填充
+    if (m_selectedTradeRow >= 0) ensureItemPanels();
+    if (wBuyA.leName) {
+        // 三个面板的文本、数值与可见性一次改完，期间不重绘，布局在之后统一计算一次
+        m_editGroup->setUpdatesEnabled(false);
+        fillItem(wBuyA, trade.buyA);
+        fillItem(wBuyB, trade.buyB);
+        fillItem(wSell, trade.sell);
+        m_editGroup->setUpdatesEnabled(true);
+    }
+
+    m_sbUses->setValue(trade.uses);
+    m_sbMaxUses->setValue(trade.maxUses);
+    m_sbTier->setValue(trade.tier);
+
+    m_isUpdatingUI = false; // 解锁
+}
+
+// 核心重构：单向数据流 - UI 更新到数据模型
+void VillagerEditor::syncDataFromUI()
+{
+    VTE_TRACE("VillagerEditor::syncDataFromUI");
+    StallWatchdog::Stage stage("syncDataFromUI");
+    if (m_selectedTradeRow < 0 || m_selectedTradeRow >= m_tradeOptions.size()) return;
+
+    TradeOption &trade = m_tradeOptions[m_selectedTradeRow];
+
+    if (!wBuyA.leName) return;
+
+    // 选中时已展开完整内容；尚未创建的输入框保持数据中原有的值
+    auto readItem = [](const ItemWidgets &w, ItemData &d) {
+        d.pendingNodes = QJsonArray();   // 界面上的值就是完整内容
+        d.name = w.leName->text().trimmed();
+        d.count = w.sbCount->value();
+        d.damage = w.sbDamage->value();
+        d.enableName = w.cbEnableName->isChecked();
+        if (w.leDisp) d.displayName = w.leDisp->toPlainText();
+        if (w.leLore) d.lore = w.leLore->toPlainText();
+        d.enableLore = w.cbEnableLore->isChecked();
+        d.enableEnch = w.cbEnableEnch->isChecked();
+        if (w.enchBox) {
+            d.enchId = w.sbEnchId->value();
+            d.enchLevel = w.sbEnchLvl->value();
+        }
+        // 新增：自定义节点
+        d.enableCustom = w.cbEnableCustom->isChecked();
+        if (d.enableCustom && w.teCustom) {
+            QString customText = w.teCustom->toPlainText().trimmed();
+            if (!customText.isEmpty()) {
+                // 将显示用的实际换行符等转义回JSON标准形式
+                QString escaped = escapeForJson(customText);
+                QJsonParseError err;
+                QJsonDocument doc = QJsonDocument::fromJson(escaped.toUtf8(), &err);
+                if (err.error == QJsonParseError::NoError && doc.isArray()) {
+                    d.customNodes = doc.array();
+                } else {
+                    d.customNodes = QJsonArray();
+                }
+            } else {
+                d.customNodes = QJsonArray();
+            }
+        } else if (!d.enableCustom) {
+            d.customNodes = QJsonArray();
+        }
+    };
+
+    readItem(wBuyA, trade.buyA);
+    readItem(wBuyB, trade.buyB);
+    readItem(wSell, trade.sell);
+
+    trade.uses = m_sbUses->value();
+    trade.maxUses = m_sbMaxUses->value();
+    trade.tier = m_sbTier->value();
+}
+
+void VillagerEditor::onDataChanged()
+{
+    VTE_TRACE("VillagerEditor::onDataChanged");
+    StallWatchdog::Stage stage("onDataChanged");
+    if (m_isUpdatingUI) return; // 如果正在填充界面，则不响应更改
+
+    syncDataFromUI();
+
+    // 与撤销栈中的版本比较，只有真正改变了数据才记录；同一控件的连续输入合并为一步
+    const int row = m_selectedTradeRow;
+    const UndoStack::State &current = m_undoStack.current();
+    if (row >= 0 && row < m_tradeOptions.size() && row < current.trades.size()
+        && !NbtCodec::sameContent(current.trades.at(row), m_tradeOptions[row])) {
+        m_journal->recordTrade(row, current.trades.at(row), m_tradeOptions[row]);
+        UndoStack::State next = current;
+        next.trades = current.trades.set(row, m_tradeOptions[row]);
+        next.focusRow = row;
+        const QString key = QString("trade:%1:%2").arg(row).arg(quintptr(sender()), 0, 16);
+        m_undoStack.commit(next, key, UndoStack::estimateBytes(m_tradeOptions[row], m_tradeOptions.size()));
+        updateUndoButtons();
+    }
+
+    updateTradeTable();
+    updatePreview();
+}
+
+// ==================== 原有的其他逻辑封装 ====================
+
+void VillagerEditor::onTableItemSelected(int row, int /*column*/)
+{
+    VTE_TRACE("VillagerEditor::onTableItemSelected");
+    StallWatchdog::Stage stage("onTableItemSelected");
+    if (row < 0 || row >= m_tradeOptions.size()) {
+        m_selectedTradeRow = -1;
+        TradeOption emptyTrade; // 加载默认空项
+        populateUIFromData(emptyTrade);
+        return;
+    }
+    m_selectedTradeRow = row;
+    NbtCodec::materialize(m_tradeOptions[row]);   // 载入时只解析了摘要，打开时再展开 Tag 与自定义节点
+    populateUIFromData(m_tradeOptions[row]);
+}
+
+void VillagerEditor::addTradeOption()
+{
+    StallWatchdog::Stage stage("addTradeOption");
+    TradeOption newTrade;
+    newTrade.buyB.count = 0; // 默认 BuyB 不启用
+    m_tradeOptions.append(newTrade);
+
+    UndoStack::State next = m_undoStack.current();
+    next.trades = next.trades.append(newTrade);
+    next.focusRow = m_tradeOptions.size() - 1;
+    m_undoStack.commit(next, QString(), UndoStack::estimateBytes(newTrade, m_tradeOptions.size()));
+    m_journal->recordInsert(m_tradeOptions.size() - 1, newTrade);
+    updateUndoButtons();
+
+    updateTradeTable();
+    m_tradeTable->selectRow(m_tradeOptions.size() - 1);
+    onTableItemSelected(m_tradeOptions.size() - 1, 0);
+    updateVillagerList();
+
+    updatePreview();
+}
+
+void VillagerEditor::deleteTradeOption()
+{
+    StallWatchdog::Stage stage("deleteTradeOption");
+    if (m_selectedTradeRow < 0 || m_selectedTradeRow >= m_tradeOptions.size()) return;
+
+    m_tradeOptions.removeAt(m_selectedTradeRow);
+
+    UndoStack::State next = m_undoStack.current();
+    next.trades = next.trades.removeAt(m_selectedTradeRow);
+    next.focusRow = m_selectedTradeRow;
+    m_undoStack.commit(next, QString(), UndoStack::estimateBytes(TradeOption(), m_tradeOptions.size()));
+    m_journal->recordRemove(m_selectedTradeRow);
+    updateUndoButtons();
+
+    m_selectedTradeRow = -1;
+    TradeOption emptyTrade;
+    populateUIFromData(emptyTrade);
+    updateTradeTable();
+    updateVillagerList();
+    updatePreview();
+}
+
+void VillagerEditor::updateTradeTable()
+{
+    VTE_TRACE("VillagerEditor::updateTradeTable");
+    StallWatchdog::Stage stage("updateTradeTable");
+    VTE_MEM_SCOPE(MemTrace::TableRefresh);
+    m_tradeTable->setRowCount(0);
+    appendTradeRows(0);
+    updateDocumentSize();
+
+    if (m_selectedTradeRow >= 0 && m_selectedTradeRow < m_tradeOptions.size()) {
+        m_isUpdatingUI = true;
+        m_tradeTable->selectRow(m_selectedTradeRow);
+        m_isUpdatingUI = false;
+    }
+}
+
+void VillagerEditor::appendTradeRows(int from)
+{
+    VTE_MEM_SCOPE(MemTrace::TableRefresh);
+    m_isUpdatingUI = true; // 防止触发表格变动带来的副作用
+
+    // 物品库已就绪时，把不在物品库中的物品 ID 标红
+    const ItemIdResolver *resolver = CatalogService::instance()->isReady() ? &CatalogService::instance()->resolver() : nullptr;
+    m_tradeTable->setRowCount(m_tradeOptions.size());
+    for (int i = from; i < m_tradeOptions.size(); ++i) fillTradeRow(i, resolver);
+    m_isUpdatingUI = false;
+    if (!m_filter.isEmpty()) applyFilter(from);   // 新建的行默认可见
+}
+
+void VillagerEditor::refreshTradeRows(const QList<int> &rows)
+{
+    VTE_TRACE("VillagerEditor::refreshTradeRows");
+    VTE_MEM_SCOPE(MemTrace::TableRefresh);
+    m_isUpdatingUI = true;
+    const ItemIdResolver *resolver = CatalogService::instance()->isReady() ? &CatalogService::instance()->resolver() : nullptr;
+    m_tradeTable->setUpdatesEnabled(false);
+    for (int row : rows) fillTradeRow(row, resolver);
+    m_tradeTable->setUpdatesEnabled(true);
+    m_isUpdatingUI = false;
+    applyFilterToRows(rows);
+}
+
+void VillagerEditor::fillTradeRow(int row, const ItemIdResolver *resolver)
+{
+    auto nameItem = [resolver](const ItemData &d) {
+        QTableWidgetItem *item = new QTableWidgetItem(d.name);
+        if (resolver && !isItemIdAccepted(*resolver, d)) {
+            item->setForeground(Qt::red);
+            item->setToolTip("物品库中没有这个物品ID");
+        }
+        return item;
+    };
+
+    const TradeOption &t = m_tradeOptions[row];
+    m_tradeTable->setItem(row, 0, nameItem(t.buyA));
+    m_tradeTable->setItem(row, 1, new QTableWidgetItem(QString::number(t.buyA.count)));
+    m_tradeTable->setItem(row, 2, nameItem(t.buyB));
+    m_tradeTable->setItem(row, 3, new QTableWidgetItem(QString::number(t.buyB.count)));
+    m_tradeTable->setItem(row, 4, nameItem(t.sell));
+    m_tradeTable->setItem(row, 5, new QTableWidgetItem(QString::number(t.sell.count)));
+    m_tradeTable->setItem(row, 6, new QTableWidgetItem(QString::number(t.uses)));
+    m_tradeTable->setItem(row, 7, new QTableWidgetItem(QString::number(t.maxUses)));
+    m_tradeTable->setItem(row, 8, new QTableWidgetItem(QString::number(t.tier)));
+}
+
+QList<int> VillagerEditor::selectedTradeRows() const
+{
+    QList<int> rows;
+    const QModelIndexList selected = m_tradeTable->selectionModel()->selectedRows();
+    rows.reserve(selected.size());
+    for (const QModelIndex &index : selected) {
+        if (!m_tradeTable->isRowHidden(index.row())) rows.append(index.row());
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+QList<int> VillagerEditor::matchedTradeRows() const
+{
+    QList<int> rows;
+    for (int row = 0; row < m_tradeTable->rowCount(); ++row) {
+        if (!m_tradeTable->isRowHidden(row)) rows.append(row);
+    }
+    return rows;
+}
+
+void VillagerEditor::onFilterEdited()
+{
+    m_filterTimer.stop();
+    QString error;
+    const TradeQuery query = TradeQuery::compile(m_leFilter->text(), &error);
+    if (!query.isValid()) {
+        // 保留上一次有效的筛选，输入到一半时表格不会闪烁
+        m_lblFilter->setStyleSheet("color: #c0392b;");
+        m_lblFilter->setText(error);
+        return;
+    }
+    if (query.text() == m_filter.text()) {
+        updateFilterLabel();
+        return;
+    }
+    m_filter = query;
+    applyFilter(0);
+}
+
+void VillagerEditor::applyFilter(int from)
+{
+    VTE_TRACE("VillagerEditor::applyFilter");
+    StallWatchdog::Stage stage("applyFilter");
+    const QList<bool> matched = m_filter.matchAll(m_tradeOptions, from);
+    m_tradeTable->setUpdatesEnabled(false);
+    for (int i = 0; i < matched.size(); ++i) m_tradeTable->setRowHidden(from + i, !matched[i]);
+    m_tradeTable->setUpdatesEnabled(true);
+    updateFilterLabel();
+}
+
+void VillagerEditor::applyFilterToRows(const QList<int> &rows)
+{
+    if (m_filter.isEmpty()) return;
+    for (int row : rows) m_tradeTable->setRowHidden(row, !m_filter.matches(m_tradeOptions[row]));
+    updateFilterLabel();
+}
+
+void VillagerEditor::updateFilterLabel()
+{
+    m_lblFilter->setStyleSheet(QString());
+    if (m_filter.isEmpty()) {
+        m_lblFilter->clear();
+        return;
+    }
+    m_lblFilter->setText(QString("匹配 %1 / %2").arg(matchedTradeRows().size()).arg(m_tradeOptions.size()));
+}
+
+// 批量修改：选择操作、字段与参数，应用到表格中选中的所有交易
+void VillagerEditor::bulkEditSelection()
+{
+    // 有筛选时，没有选中任何行就作用于所有匹配的交易
+    QList<int> rows = selectedTradeRows();
+    if (rows.isEmpty() && !m_filter.isEmpty()) rows = matchedTradeRows();
+    if (rows.isEmpty()) {
+        QMessageBox::information(this, "批量修改", "请先在表格中选中要修改的交易（按住 Ctrl 或 Shift 多选），或用筛选栏筛出要修改的交易。");
+        return;
+    }
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(QString("批量修改 %1 条交易").arg(rows.size()));
+    QGridLayout layout(&dialog);
+    QComboBox *cbOp = new QComboBox(&dialog);
+    cbOp->addItem("设为", BulkEdit::Set);
+    cbOp->addItem("乘以", BulkEdit::Scale);
+    cbOp->addItem("加上", BulkEdit::Offset);
+    cbOp->addItem("替换物品 ID", BulkEdit::ReplaceItemId);
+    QComboBox *cbField = new QComboBox(&dialog);
+    QLabel *lblFrom = new QLabel("原物品 ID:", &dialog);
+    QLineEdit *leFrom = new QLineEdit(&dialog);
+    leFrom->setPlaceholderText("留空表示任意物品");
+    QLineEdit *leValue = new QLineEdit(&dialog);
+    layout.addWidget(new QLabel("操作:", &dialog), 0, 0);
+    layout.addWidget(cbOp, 0, 1);
+    layout.addWidget(new QLabel("字段:", &dialog), 1, 0);
+    layout.addWidget(cbField, 1, 1);
+    layout.addWidget(lblFrom, 2, 0);
+    layout.addWidget(leFrom, 2, 1);
+    layout.addWidget(new QLabel("值:", &dialog), 3, 0);
+    layout.addWidget(leValue, 3, 1);
+
+    // 字段列表随操作变化：缩放与偏移只列整数字段，替换只列物品名
+    auto updateFields = [&]() {
+        const int op = cbOp->currentData().toInt();
+        cbField->clear();
+        if (op == BulkEdit::ReplaceItemId) cbField->addItem("所有物品", -1);
+        for (int f = 0; f < TradeFields::FieldCount; ++f) {
+            BulkEdit::Transform probe;
+            probe.op = BulkEdit::Operation(op);
+            probe.field = f;
+            probe.value = op == BulkEdit::ReplaceItemId ? QString("x") : QString("1");
+            if (BulkEdit::isValid(probe)) cbField->addItem(TradeFields::path(f), f);
+        }
+        lblFrom->setVisible(op == BulkEdit::ReplaceItemId);
+        leFrom->setVisible(op == BulkEdit::ReplaceItemId);
+        leValue->setPlaceholderText(op == BulkEdit::Scale ? "例如 0.5 或 2"
+                                    : op == BulkEdit::ReplaceItemId ? "新的物品 ID"
+                                    : "整数、文本，或 true / false");
+    };
+    connect(cbOp, QOverload<int>::of(&QComboBox::currentIndexChanged), &dialog, updateFields);
+    updateFields();
+
+    QHBoxLayout buttons;
+    QPushButton *btnOk = new QPushButton("确定", &dialog);
+    QPushButton *btnCancel = new QPushButton("取消", &dialog);
+    btnOk->setDefault(true);
+    buttons.addStretch();
+    buttons.addWidget(btnOk);
+    buttons.addWidget(btnCancel);
+    layout.addLayout(&buttons, 4, 0, 1, 2);
+    connect(btnOk, &QPushButton::clicked, &dialog, &QDialog::accept);
+    connect(btnCancel, &QPushButton::clicked, &dialog, &QDialog::reject);
+
+    while (dialog.exec() == QDialog::Accepted) {
+        BulkEdit::Transform transform;
+        transform.op = BulkEdit::Operation(cbOp->currentData().toInt());
+        transform.field = cbField->currentData().toInt();
+        transform.value = leValue->text().trimmed();
+        transform.from = leFrom->text().trimmed();
+        QString error;
+        if (!BulkEdit::isValid(transform, &error)) {
+            QMessageBox::warning(&dialog, "批量修改", error);
+            continue;
+        }
+        // 输入的别名（中文名等）换成规范物品 ID
+        if (transform.op == BulkEdit::ReplaceItemId && CatalogService::instance()->isReady()) {
+            const QString id = CatalogService::instance()->resolver().resolve(transform.value.toString());
+            if (!id.isEmpty()) transform.value = id;
+        }
+        applyBulkEdit(transform, rows);
+        break;
+    }
+}
+
+void VillagerEditor::applyBulkEdit(const BulkEdit::Transform &t, const QList<int> &rows)
+{
+    VTE_TRACE("VillagerEditor::applyBulkEdit");
+    StallWatchdog::Stage stage("applyBulkEdit");
+    const QList<int> changed = BulkEdit::applyToRows(m_tradeOptions, rows, t);
+    if (changed.isEmpty()) {
+        statusBar()->showMessage("选中的交易都不需要修改", 5000);
+        return;
+    }
+
+    // 所有改动合成一个撤销步骤；编辑日志仍按行记录变化的字段
+    UndoStack::State next = m_undoStack.current();
+    qint64 bytes = 0;
+    for (int row : changed) {
+        m_journal->recordTrade(row, next.trades.at(row), m_tradeOptions[row]);
+        next.trades = next.trades.set(row, m_tradeOptions[row]);
+        bytes += UndoStack::estimateBytes(m_tradeOptions[row], m_tradeOptions.size());
+    }
+    next.focusRow = changed.first();
+    m_undoStack.commit(next, QString(), bytes);
+    updateUndoButtons();
+
+    refreshTradeRows(changed);
+    if (std::binary_search(changed.begin(), changed.end(), m_selectedTradeRow)) {
+        populateUIFromData(m_tradeOptions[m_selectedTradeRow]);
+    }
+    updatePreview();
+    statusBar()->showMessage(QString("已修改 %1 条交易（%2）").arg(changed.size()).arg(BulkEdit::describe(t)), 5000);
+}
+
+// 物品选择器
+void VillagerEditor::openItemSelector(ItemWidgets *widgets)
+{
+    int damage = 0;
+    QString presetJson;
+    QString itemName = selectItemFromDialog(damage, presetJson);
+    if (!itemName.isEmpty()) {
+        widgets->leName->setText(itemName);
+        widgets->sbDamage->setValue(damage);
+        if (widgets->sbCount->value() == 0) widgets->sbCount->setValue(1);
+
+        if (!presetJson.isEmpty()) {
+            widgets->cbEnableCustom->setChecked(true);
+            // 将预设JSON中的转义序列转换为实际换行符显示
+            QString displayText = unescapeForDisplay(presetJson);
+            widgets->teCustom->setPlainText(displayText);
+        }
+    }
+}
+
+QString VillagerEditor::selectItemFromDialog(int &outDamage, QString &outPresetJson)
+{
+    StallWatchdog::Stage stage("selectItemFromDialog");
+    QDialog dialog(this);
+    dialog.setWindowTitle("选择物品");
+    dialog.setModal(true);
+    dialog.resize(500, 550); // 稍微加宽一点以显示分类
+
+    QVBoxLayout vLayout(&dialog);
+
+    // ========== 1. 顶部搜索与分类区 ==========
+    QHBoxLayout hLayout;
+
+    QComboBox *categoryCombo = new QComboBox(&dialog);
+    categoryCombo->addItem("全部"); // 默认选项
+
+    QLineEdit searchEdit(&dialog);
+    searchEdit.setPlaceholderText("搜索物品(中/英文)...");
+
+    // 设置下拉框和搜索框比例为 1:2
+    hLayout.addWidget(categoryCombo, 1);
+    hLayout.addWidget(&searchEdit, 2);
+    vLayout.addLayout(&hLayout);
+
+    // ========== 2. 物品列表加载 ==========
+    QListWidget itemList(&dialog);
+    const QList<ItemMapping> items = CatalogService::instance()->items();
+
+    QStringList categories;
+    for (const auto &mapping : items) {
+        // 收集不重复的分类用于填充下拉框
+        if (!categories.contains(mapping.category)) {
+            categories.append(mapping.category);
+        }
+
+        // UI 显示格式：[矿物] 绿宝石（minecraft:emerald）
+        QListWidgetItem *item = new QListWidgetItem(ItemCatalog::displayLabel(mapping));
+
+        // 绑定隐藏数据
+        item->setData(Qt::UserRole, mapping.englishId);
+        item->setData(Qt::UserRole + 1, mapping.defaultDamage);
+        item->setData(Qt::UserRole + 2, mapping.category); // 存入分类名，用于过滤
+        item->setData(Qt::UserRole + 3, mapping.presetJson);   // <-- 新增：预设 JSON
+        item->setData(Qt::UserRole + 4, mapping.searchKey);    // 预生成的搜索键
+        item->setData(Qt::UserRole + 5, mapping.presetJson.isEmpty() || mapping.presetValid);
+
+        itemList.addItem(item);
+    }
+
+    categoryCombo->addItems(categories);
+    vLayout.addWidget(&itemList);
+
+    // ========== 3. 双重过滤逻辑 (分类 + 搜索) ==========
+    auto filterItems = [&]() {
+        QString searchText = searchEdit.text().toCaseFolded();
+        QString selectedCategory = categoryCombo->currentText();
+
+        for (int i = 0; i < itemList.count(); ++i) {
+            QListWidgetItem *item = itemList.item(i);
+            QString itemCategory = item->data(Qt::UserRole + 2).toString();
+
+            // 条件1：分类匹配（或是选择了"全部"）
+            bool categoryMatch = (selectedCategory == "全部" || selectedCategory == itemCategory);
+            // 条件2：搜索文本匹配（搜索键已预先做大小写折叠）
+            bool textMatch = item->data(Qt::UserRole + 4).toString().contains(searchText);
+
+            // 只有同时满足分类和搜索词才显示
+            item->setHidden(!(categoryMatch && textMatch));
+        }
+    };
+
+    // 搜索框输入和下拉框选择改变时，都触发过滤
+    connect(&searchEdit, &QLineEdit::textChanged, filterItems);
+    connect(categoryCombo, &QComboBox::currentTextChanged, filterItems);
+
+    // ========== 4. 确认与取消逻辑 ==========
+    QString selectedId;
+    auto onSelect = [&]() {
+        if (QListWidgetItem *item = itemList.currentItem()) {
+            selectedId = item->data(Qt::UserRole).toString();
+            outDamage = item->data(Qt::UserRole + 1).toInt();
+            outPresetJson = item->data(Qt::UserRole + 3).toString();   // <-- 获取预设 JSON
+            if (!item->data(Qt::UserRole + 5).toBool()) {
+                // 预设 JSON 在加载物品库时已校验，无效的预设不再插入编辑框
+                QMessageBox::warning(&dialog, "预设无效",
+                                     QString("物品 %1 的预设JSON不是合法的数组，已忽略预设。").arg(selectedId));
+                outPresetJson.clear();
+            }
+            dialog.accept();
+        }
+    };
+
+    QPushButton btnConfirm("确认");
+    QPushButton btnCancel("取消");
+    QHBoxLayout btnLayout;
+    btnLayout.addStretch();
+    btnLayout.addWidget(&btnConfirm);
+    btnLayout.addWidget(&btnCancel);
+    vLayout.addLayout(&btnLayout);
+
+    connect(&btnConfirm, &QPushButton::clicked, onSelect);
+    connect(&btnCancel, &QPushButton::clicked, &dialog, &QDialog::reject);
+    connect(&itemList, &QListWidget::itemDoubleClicked, onSelect); // 双击直接选择
+
+    stage.end();   // 对话框打开期间的卡顿不属于构建列表
+    dialog.exec();
+    return selectedId;
+}
+
+// ==================== NBT 序列化与解析重构 ====================
+
+// ==================== 文件读写 ====================
+
+void VillagerEditor::updatePreview()
+{
+    ++m_previewSerial;
+    m_previewQueued = true;
+    if (!m_previewWatcher.isRunning()) startPreview();
+}
+
+void VillagerEditor::setPreviewText(const QString &text)
+{
+    ++m_previewSerial;
+    m_previewQueued = false;
+    VTE_TRACE("预览 setText");
+    m_tePreview->setText(text);
+}
+
+void VillagerEditor::startPreview()
+{
+    StallWatchdog::Stage stage("startPreview");
+    m_previewQueued = false;
+    m_previewStarted = m_previewSerial;
+    // 文档副本与其中的交易列表都是隐式共享的，这里不复制数据
+    m_previewWatcher.setFuture(QtConcurrent::run(&m_previewPool, [document = currentDocument()]() {
+        VTE_TRACE("VillagerEditor::serializePreview");
+        return NbtCodec::serialize(document);
+    }));
+}
+
+void VillagerEditor::onPreviewFinished()
+{
+    StallWatchdog::Stage stage("onPreviewFinished");
+    if (m_previewStarted == m_previewSerial && m_previewWatcher.future().resultCount() > 0) {
+        VTE_TRACE("预览 setText");
+        m_tePreview->setText(m_previewWatcher.result());
+    }
+    if (m_previewQueued) startPreview();
+}
+
+void VillagerEditor::toggleTracing()
+{
+    if (!Tracer::isEnabled()) {
+        Tracer::setEnabled(true);
+        statusBar()->showMessage("性能追踪已开启，再按 Ctrl+Alt+T 停止并导出", 5000);
+        return;
+    }
+    Tracer::setEnabled(false);
+    const QString path = QFileDialog::getSaveFileName(this, "导出性能追踪", "trace.json", "Chrome Trace (*.json)");
+    if (path.isEmpty()) return;
+    QString error;
+    if (Tracer::writeChromeTrace(path, &error)) {
+        statusBar()->showMessage(QString("已导出到 %1，可在 chrome://tracing 或 ui.perfetto.dev 中打开").arg(QDir::toNativeSeparators(path)), 8000);
+    } else {
+        QMessageBox::warning(this, "导出失败", error);
+    }
+}
+
+void VillagerEditor::showStallLog()
+{
+    const QList<StallWatchdog::Entry> entries = StallWatchdog::readLog();
+
+    QDialog dialog(this);
+    dialog.setWindowTitle("界面卡顿记录");
+    dialog.resize(760, 520);
+    QVBoxLayout layout(&dialog);
+    const qint64 threshold = StallWatchdog::defaultThresholdMs();
+    layout.addWidget(new QLabel(QString("阈值 %1（可用环境变量 VTE_STALL_MS 修改）　日志：%2")
+                                    .arg(threshold > 0 ? QString("%1 ms").arg(threshold) : QString("未启用"),
+                                         QDir::toNativeSeparators(StallWatchdog::logPath())), &dialog));
+
+    // 按阶段汇总：次数、最长、平均与发生时的最大文档
+    struct Summary { int count = 0; qint64 maxMs = 0; qint64 totalMs = 0; qint64 maxTrades = 0; };
+    QMap<QString, Summary> byStage;
+    for (const StallWatchdog::Entry &e : entries) {
+        Summary &s = byStage[e.stage.isEmpty() ? QString("（未标记）") : e.stage];
+        ++s.count;
+        s.maxMs = qMax(s.maxMs, e.durationMs);
+        s.totalMs += e.durationMs;
+        s.maxTrades = qMax(s.maxTrades, e.trades);
+    }
+    QTableWidget *summary = new QTableWidget(byStage.size(), 5, &dialog);
+    summary->setHorizontalHeaderLabels({ "阶段", "次数", "最长 (ms)", "平均 (ms)", "最大交易数" });
+    int row = 0;
+    for (auto it = byStage.cbegin(); it != byStage.cend(); ++it, ++row) {
+        summary->setItem(row, 0, new QTableWidgetItem(it.key()));
+        summary->setItem(row, 1, new QTableWidgetItem(QString::number(it->count)));
+        summary->setItem(row, 2, new QTableWidgetItem(QString::number(it->maxMs)));
+        summary->setItem(row, 3, new QTableWidgetItem(QString::number(it->totalMs / it->count)));
+        summary->setItem(row, 4, new QTableWidgetItem(QString::number(it->maxTrades)));
+    }
+    summary->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    summary->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    layout.addWidget(new QLabel("按阶段汇总：", &dialog));
+    layout.addWidget(summary);
+
+    // 最近的记录（新的在前）
+    const int shown = qMin(int(entries.size()), 200);
+    QTableWidget *recent = new QTableWidget(shown, 5, &dialog);
+    recent->setHorizontalHeaderLabels({ "时间", "时长 (ms)", "阶段", "村民 / 交易", "状态" });
+    for (int i = 0; i < shown; ++i) {
+        const StallWatchdog::Entry &e = entries[entries.size() - 1 - i];
+        recent->setItem(i, 0, new QTableWidgetItem(e.start.toString("yyyy-MM-dd HH:mm:ss")));
+        recent->setItem(i, 1, new QTableWidgetItem(QString::number(e.durationMs)));
+        recent->setItem(i, 2, new QTableWidgetItem(e.stage));
+        recent->setItem(i, 3, new QTableWidgetItem(QString("%1 / %2").arg(e.villagers).arg(e.trades)));
+        recent->setItem(i, 4, new QTableWidgetItem(e.ongoing ? "未结束（可能被强制关闭）" : "已恢复"));
+    }
+    recent->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    recent->horizontalHeader()->setSectionResizeMode(2, QHeaderView::Stretch);
+    layout.addWidget(new QLabel(QString("最近 %1 条记录：").arg(shown), &dialog));
+    layout.addWidget(recent);
+
+    QPushButton *btnClose = new QPushButton("关闭", &dialog);
+    connect(btnClose, &QPushButton::clicked, &dialog, &QDialog::accept);
+    layout.addWidget(btnClose, 0, Qt::AlignRight);
+    dialog.exec();
+}
+
+#ifdef VTE_MEMTRACE
+void VillagerEditor::showMemoryStats()
+{
+    // 当前文档每条交易的常驻内存（近似）
+    const VillagerDocument document = currentDocument();
+    qint64 tradeCount = 0, tradeBytes = 0;
+    for (const VillagerData &villager : document.villagers) {
+        for (const TradeOption &trade : villager.trades) tradeBytes += MemTrace::residentBytes(trade);
+        tradeCount += villager.trades.size();
+    }
+    const qint64 perTrade = tradeCount > 0 ? tradeBytes / tradeCount : MemTrace::residentBytes(TradeOption());
+
+    QDialog dialog(this);
+    dialog.setWindowTitle("内存分配统计");
+    dialog.resize(640, 360);
+    QVBoxLayout layout(&dialog);
+    QLabel *summary = new QLabel(&dialog);
+    layout.addWidget(summary);
+    QTableWidget *table = new QTableWidget(0, 5, &dialog);
+    table->setHorizontalHeaderLabels({ "阶段", "分配次数", "分配字节", "阶段内净增", "堆峰值" });
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    layout.addWidget(table);
+
+    auto refresh = [&]() {
+        summary->setText(QString("接管方式：%1　当前堆：%2 KiB　交易 %3 条，每条约 %4 字节")
+                             .arg(MemTrace::hookName()).arg(MemTrace::liveBytes() / 1024)
+                             .arg(tradeCount).arg(perTrade));
+        const QList<MemTrace::StageStats> stats = MemTrace::snapshot();
+        table->setRowCount(stats.size());
+        for (int row = 0; row < stats.size(); ++row) {
+            const MemTrace::StageStats &st = stats[row];
+            table->setItem(row, 0, new QTableWidgetItem(st.name));
+            table->setItem(row, 1, new QTableWidgetItem(QString::number(st.allocations)));
+            table->setItem(row, 2, new QTableWidgetItem(QString::number(st.bytes)));
+            table->setItem(row, 3, new QTableWidgetItem(QString::number(st.netBytes)));
+            table->setItem(row, 4, new QTableWidgetItem(QString::number(st.peakBytes)));
+        }
+    };
+    refresh();
+
+    QHBoxLayout *btnLayout = new QHBoxLayout();
+    QPushButton *btnReset = new QPushButton("清零", &dialog);
+    QPushButton *btnExport = new QPushButton("导出 JSON", &dialog);
+    QPushButton *btnClose = new QPushButton("关闭", &dialog);
+    btnLayout->addStretch();
+    btnLayout->addWidget(btnReset);
+    btnLayout->addWidget(btnExport);
+    btnLayout->addWidget(btnClose);
+    layout.addLayout(btnLayout);
+    connect(btnReset, &QPushButton::clicked, &dialog, [&]() {
+        MemTrace::reset();
+        refresh();
+    });
+    connect(btnExport, &QPushButton::clicked, &dialog, [&]() {
+        const QString path = QFileDialog::getSaveFileName(&dialog, "导出内存统计", "memtrace.json", "JSON (*.json)");
+        if (path.isEmpty()) return;
+        QJsonObject extra;
+        extra["trades"] = tradeCount;
+        extra["residentBytesPerTrade"] = perTrade;
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(MemTrace::toJson(extra)).toJson()) < 0) {
+            QMessageBox::warning(&dialog, "导出失败", file.errorString());
+        }
+    });
+    connect(btnClose, &QPushButton::clicked, &dialog, &QDialog::accept);
+    dialog.exec();
+}
+#endif
+
+void VillagerEditor::updateDocumentSize()
+{
+    qint64 trades = m_tradeOptions.size();
+    for (int v = 0; v < m_document.villagers.size(); ++v) {
+        if (v != m_currentVillager) trades += m_document.villagers[v].trades.size();
+    }
+    StallWatchdog::setDocumentSize(m_document.villagers.size(), trades);
+}
+
+void VillagerEditor::loadFile()
+{
+    if (isBusy()) return;
+    QString path = QFileDialog::getOpenFileName(this, "加载文件", "", "JSON (*.json);;所有 (*.*)");
+    if (path.isEmpty()) return;
+    openPath(path);
+}
+
+void VillagerEditor::openPath(const QString &path)
+{
+    VTE_TRACE("VillagerEditor::openPath");
+    if (isBusy()) return;
+
+    // 读取与解析在工作线程中进行，表格随解析进度逐批填充（先显示第一个村民）；
+    // 其他村民的交易收集在 m_loadHeader.document 中，加载完成后才替换 m_document
+    m_loadingPath = path;
+    m_loadHeader = DocumentIO::LoadChunk();
+    m_tradeOptions.clear();
+    m_selectedTradeRow = -1;
+    populateUIFromData(TradeOption());
+    updateTradeTable();
+    setBusy(QString("正在加载 %1…").arg(QFileInfo(path).fileName()));
+    m_loadWatcher.setFuture(QtConcurrent::run(&DocumentIO::load, path));
+}
+
+void VillagerEditor::onLoadResults(int begin, int end)
+{
+    VTE_TRACE("VillagerEditor::onLoadResults");
+    StallWatchdog::Stage stage("onLoadResults");
+    for (int i = begin; i < end; ++i) {
+        const DocumentIO::LoadChunk chunk = m_loadWatcher.resultAt(i);
+        if (chunk.first) {
+            m_loadHeader = chunk;
+            continue;
+        }
+        if (chunk.villager > 0 && chunk.villager < m_loadHeader.document.villagers.size()) {
+            m_loadHeader.document.villagers[chunk.villager].trades.append(chunk.trades);
+            continue;
+        }
+        const int from = m_tradeOptions.size();
+        m_tradeOptions.append(chunk.trades);
+        appendTradeRows(from);
+    }
+    updateDocumentSize();
+}
+
+void VillagerEditor::onLoadFinished()
+{
+    VTE_TRACE("VillagerEditor::onLoadFinished");
+    StallWatchdog::Stage stage("onLoadFinished");
+    // 换成空的 future 以释放已交付的批次；空 future 同样会发出 finished，用路径区分
+    if (m_loadingPath.isEmpty()) return;
+    const QString path = std::exchange(m_loadingPath, QString());
+    const bool canceled = m_loadWatcher.isCanceled();
+    m_loadWatcher.setFuture(QFuture<DocumentIO::LoadChunk>());
+    clearBusy();
+
+    const QString error = m_loadHeader.first ? m_loadHeader.error : QString("读取被中断");
+    if (canceled || !error.isEmpty()) {
+        // 回到加载前的文档（撤销栈的当前状态与之一致）
+        m_tradeOptions = m_undoStack.current().trades.toList();
+        m_selectedTradeRow = -1;
+        updateTradeTable();
+        populateUIFromData(TradeOption());
+        m_loadHeader = DocumentIO::LoadChunk();
+        if (canceled) {
+            statusBar()->showMessage("已取消加载", 5000);
+        } else {
+            stage.end();
+            QMessageBox::warning(this, "加载失败", QString("无法读取 %1：\n%2").arg(QDir::toNativeSeparators(path), error));
+        }
+        return;
+    }
+
+    m_document = m_loadHeader.document;
+    m_document.villagers[0].trades = m_tradeOptions;
+    m_currentVillager = 0;
+    m_profession = m_document.villagers[0].profession; // <== 新增：提取职业和变种
+    m_markVariant = m_document.villagers[0].markVariant;
+    m_unsavedRecovery = false;
+    showLoadedDocument();
+    setBasePath(path);
+    m_journal->rebase(path, m_currentVillager);
+
+    setPreviewText(m_loadHeader.text);
+    QString message = QString("解析到 %1 条交易").arg(m_loadHeader.total);
+    if (m_document.villagers.size() > 1) {
+        message = QString("解析到 %1 个村民，共 %2 条交易").arg(m_document.villagers.size()).arg(m_loadHeader.total);
+    }
+    m_loadHeader = DocumentIO::LoadChunk();
+    const QStringList unknown = findUnknownItemIds();
+    if (!unknown.isEmpty()) {
+        message += QString("\n\n以下物品ID不在物品库中（已在表格中标红）：\n%1").arg(formatUnknownIds(unknown));
+    }
+    stage.end();
+    if (m_interactive) QMessageBox::information(this, "加载成功", message);
+}
+
+void VillagerEditor::showLoadedDocument()
+{
+    StallWatchdog::Stage stage("showLoadedDocument");
+    // 每个村民从自己加载时的状态开始记录撤销历史
+    m_villagerUndo = QList<UndoStack>(m_document.villagers.size());
+    for (int i = 0; i < m_document.villagers.size(); ++i) {
+        if (i == m_currentVillager) continue;
+        const VillagerData &villager = m_document.villagers[i];
+        UndoStack::State state;
+        state.trades = PersistentList<TradeOption>::fromList(villager.trades);
+        state.profession = villager.profession;
+        state.markVariant = villager.markVariant;
+        m_villagerUndo[i].reset(state);
+    }
+    m_undoStack.reset(currentUndoState());
+    updateVillagerList();
+    showCurrentVillager();
+}
+
+void VillagerEditor::showCurrentVillager()
+{
+    // 更新 UI 下拉框
+    m_isUpdatingUI = true;
+    int profIndex = m_cbProfession->findData(m_profession);
+    if (profIndex >= 0) m_cbProfession->setCurrentIndex(profIndex);
+    int varIndex = m_cbMarkVariant->findData(m_markVariant);
+    if (varIndex >= 0) m_cbMarkVariant->setCurrentIndex(varIndex);
+    m_isUpdatingUI = false;
+
+    updateUndoButtons();
+
+    if (!m_tradeOptions.isEmpty()) {
+        m_tradeTable->selectRow(0);
+        onTableItemSelected(0, 0);
+    } else {
+        TradeOption empty;
+        populateUIFromData(empty);
+        m_selectedTradeRow = -1;
+    }
+}
+
+// 写出文件前的检查：自定义节点必须有效，未知物品 ID 需要确认
+bool VillagerEditor::confirmBeforeWrite()
+{
+    // 新增：先验证所有自定义节点的有效性
+    const QList<NbtValidator::Issue> issues = validateCustomNodes();
+    if (!issues.isEmpty()) {
+        QStringList lines;
+        for (int i = 0; i < issues.size() && i < 10; ++i) lines << NbtValidator::formatIssue(issues[i]);
+        if (issues.size() > 10) lines << QString("……共 %1 处问题").arg(issues.size());
+        QMessageBox::warning(this, "保存失败",
+                             "自定义NBT节点存在以下问题：\n" + lines.join('\n') +
+                             "\n\n请确保每个启用了自定义节点的输入框中的JSON格式正确（必须是数组，每个元素为对象，包含name, value, type）。");
+        return false;
+    }
+
+    const QStringList unknown = findUnknownItemIds();
+    if (!unknown.isEmpty()) {
+        auto answer = QMessageBox::question(this, "未知物品ID",
+                                            QString("以下物品ID不在物品库中：\n%1\n\n仍要保存吗？").arg(formatUnknownIds(unknown)));
+        if (answer != QMessageBox::Yes) return false;
+    }
+    return true;
+}
+
+void VillagerEditor::saveFile()
+{
+    VTE_TRACE("VillagerEditor::saveFile");
+    if (isBusy() || !confirmBeforeWrite()) return;
+
+    QString path = QFileDialog::getSaveFileName(this, "保存文件", "", "JSON (*.json)");
+    if (path.isEmpty()) return;
+
+    // 序列化与写入在工作线程中进行；交易列表与原始文档都是隐式共享的，传入副本不需要复制数据
+    m_savingPath = path;
+    m_saveCommitted = std::make_shared<std::atomic_bool>(false);
+    setBusy(QString("正在保存 %1…").arg(QFileInfo(path).fileName()));
+    m_saveWatcher.setFuture(QtConcurrent::run(&DocumentIO::save, path, currentDocument(), m_saveCommitted));
+}
+
+void VillagerEditor::exportPackedStructure()
+{
+    if (isBusy() || !confirmBeforeWrite()) return;
+
+    const VillagerDocument document = currentDocument();
+    bool ok = false;
+    NbtCodec::PackLayout layout;
+    layout.columns = QInputDialog::getInt(this, "打包导出",
+                                          QString("把 %1 个村民按网格排进同一个结构。\n每行村民数（0 为自动）：").arg(document.villagers.size()),
+                                          0, 0, 4096, 1, &ok);
+    if (!ok) return;
+    QString path = QFileDialog::getSaveFileName(this, "打包导出", "", "JSON (*.json)");
+    if (path.isEmpty()) return;
+
+    // 与保存共用后台任务与进度条；导出的文件不成为编辑日志的基准
+    m_savingPath = path;
+    m_saveIsExport = true;
+    m_saveCommitted = std::make_shared<std::atomic_bool>(false);
+    setBusy(QString("正在导出 %1…").arg(QFileInfo(path).fileName()));
+    m_saveWatcher.setFuture(QtConcurrent::run(&DocumentIO::exportPacked, path, document.villagers, layout, m_saveCommitted));
+}
+
+void VillagerEditor::onSaveFinished()
+{
+    VTE_TRACE("VillagerEditor::onSaveFinished");
+    StallWatchdog::Stage stage("onSaveFinished");
+    if (m_savingPath.isEmpty()) return;   // 见 onLoadFinished
+    const QString path = std::exchange(m_savingPath, QString());
+    const bool isExport = std::exchange(m_saveIsExport, false);
+    // 提交之后才按的取消不生效：文件已经替换，按成功处理
+    const bool committed = std::exchange(m_saveCommitted, DocumentIO::CommitFlag())->load();
+    const bool canceled = !committed && m_saveWatcher.isCanceled();
+    const QString error = (!committed && !canceled && m_saveWatcher.future().resultCount() > 0) ? m_saveWatcher.result() : QString();
+    m_saveWatcher.setFuture(QFuture<QString>());
+    clearBusy();
+
+    if (canceled) {
+        statusBar()->showMessage("已取消保存，原文件没有改动", 5000);
+        return;
+    }
+    stage.end();   // 下面的消息框是模态的，期间的卡顿不属于保存完成的处理
+    if (!error.isEmpty()) {
+        QMessageBox::warning(this, "保存失败", QString("无法写入 %1：\n%2").arg(QDir::toNativeSeparators(path), error));
+        return;
+    }
+    if (isExport) {
+        QMessageBox::information(this, "成功", "导出完毕");
+        return;
+    }
+    // 保存的文件成为新的基准，之前的日志记录不再需要
+    setBasePath(path);
+    m_journal->rebase(path, m_currentVillager);
+    m_undoStack.markClean();
+    for (UndoStack &undo : m_villagerUndo) undo.markClean();
+    m_unsavedRecovery = false;
+    updateUndoButtons();
+    QMessageBox::information(this, "成功", "保存完毕");
+}
+
+void VillagerEditor::setBasePath(const QString &path)
+{
+    if (m_basePath == path) return;
+    m_basePath = path;
+    emit documentPathChanged(path);
+}
+
+void VillagerEditor::showEvent(QShowEvent *event)
+{
+    QMainWindow::showEvent(event);
+    updateDocumentSize();   // 多个文档共用卡顿监视器，卡顿记录以正在显示的文档为准
+}
+
+bool VillagerEditor::isBusy() const
+{
+    return m_loadWatcher.isRunning() || m_saveWatcher.isRunning();
+}
+
+void VillagerEditor::setBusy(const QString &message)
+{
+    for (QWidget *w : std::as_const(m_editControls)) w->setEnabled(false);
+    m_progress->setRange(0, 100);
+    m_progress->setValue(0);
+    m_progress->show();
+    m_btnCancel->setEnabled(true);
+    m_btnCancel->show();
+    statusBar()->showMessage(message);
+}
+
+void VillagerEditor::clearBusy()
+{
+    for (QWidget *w : std::as_const(m_editControls)) w->setEnabled(true);
+    updateUndoButtons();
+    m_progress->hide();
+    m_btnCancel->hide();
+    statusBar()->clearMessage();
+}
+
+// 在基准文件上重放上次异常退出留下的编辑日志，结果替换本文档
+void VillagerEditor::recover(const EditJournal::Recovery &recovery)
+{
+    const QString baseName = recovery.basePath.isEmpty() ? QString("新建的文档") : QDir::toNativeSeparators(recovery.basePath);
+    VillagerDocument document;
+    if (!recovery.basePath.isEmpty()) {
+        QFile file(recovery.basePath);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QMessageBox::warning(this, "无法恢复",
+                                 QString("找不到基准文件 %1。\n编辑日志保留在 %2。")
+                                     .arg(baseName, QDir::toNativeSeparators(recovery.journalPath)));
+            return;
+        }
+        const QString text = file.readAll();
+        file.close();
+        if (!FileFingerprint::fromStat(recovery.basePath).sameStat(recovery.baseFingerprint)) {
+            QMessageBox::warning(this, "基准文件已变化", "基准文件在上次退出后被修改过，恢复结果可能与当时不完全一致。");
+        }
+        document = NbtCodec::parseDocument(text);
+    }
+    int current = recovery.initialVillager;
+    EditJournal::replay(recovery.records, document.villagers, current);
+
+    m_document = document;
+    m_currentVillager = current;
+    const VillagerData &villager = m_document.villagers[current];
+    m_tradeOptions = villager.trades;
+    m_profession = villager.profession;
+    m_markVariant = villager.markVariant;
+    setBasePath(recovery.basePath);
+    m_selectedTradeRow = -1;
+    updateTradeTable();
+    m_unsavedRecovery = true;
+    showLoadedDocument();
+    updatePreview();
+
+    // 恢复结果整体写入本次会话的日志，再删除旧日志
+    m_journal->rebase(m_basePath, m_currentVillager);
+    qsizetype total = 0;
+    for (int i = 0; i < m_document.villagers.size(); ++i) {
+        m_journal->recordSelectVillager(i);
+        m_journal->recordReset(m_document.villagers[i].trades);
+        m_journal->recordGlobals(m_document.villagers[i].profession, m_document.villagers[i].markVariant);
+        total += m_document.villagers[i].trades.size();
+    }
+    m_journal->recordSelectVillager(m_currentVillager);
+    QFile::remove(recovery.journalPath);
+
+    QMessageBox::information(this, "已恢复", QString("已恢复 %1 条交易，请尽快保存。").arg(total));
+}
+
+// 输入提交时把别名（中文名、补全项等）解析为物品库中的规范 ID
+void VillagerEditor::commitItemName(ItemWidgets &w)
+{
+    if (m_isUpdatingUI || !CatalogService::instance()->isReady()) return;
+    const QString text = w.leName->text().trimmed();
+    const QString id = CatalogService::instance()->resolver().resolve(text);
+    if (!id.isEmpty() && id != text) {
+        w.leName->setText(id);   // 触发 textChanged -> onDataChanged
+    }
+}
+
+// 检查所有村民的交易中的物品 ID，返回物品库中不存在的 ID（去重，按出现顺序）
+QStringList VillagerEditor::findUnknownItemIds() const
+{
+    QStringList unknown;
+    if (!CatalogService::instance()->isReady()) return unknown;
+    const ItemIdResolver &resolver = CatalogService::instance()->resolver();
+    QSet<QString> seen;
+    const VillagerDocument document = currentDocument();
+    for (const VillagerData &villager : document.villagers) {
+        for (const TradeOption &trade : villager.trades) {
+            for (const ItemData *item : { &trade.buyA, &trade.buyB, &trade.sell }) {
+                if (isItemIdAccepted(resolver, *item) || seen.contains(item->name)) continue;
+                seen.insert(item->name);
+                unknown.append(item->name);
+            }
+        }
+    }
+    return unknown;
+}
+
+void VillagerEditor::updateCompleters()
+{
+    // 编辑面板尚未创建时，由 ensureItemPanels 在创建时挂接
+    if (wBuyA.leName) {
+        setupItemCompleter(wBuyA);
+        setupItemCompleter(wBuyB);
+        setupItemCompleter(wSell);
+    }
+
+    // 物品库晚于文件加载完成时，补上未知物品 ID 的标记
+    if (!m_tradeOptions.isEmpty()) updateTradeTable();
+}
+
+// 三个输入框共用物品库服务中的同一个候选模型
+void VillagerEditor::setupItemCompleter(ItemWidgets &w)
+{
+    if (!w.leName->completer()) {
+        QCompleter *completer = new QCompleter(CatalogService::instance()->completerModel(), this);
+        completer->setCaseSensitivity(Qt::CaseInsensitive);
+        w.leName->setCompleter(completer);
+        // 补全项（中文名等）被选中后立即换成规范 ID；排队执行，保证在补全器写入文本之后
+        connect(completer, QOverload<const QString &>::of(&QCompleter::activated), this,
+                [this, &w]() { commitItemName(w); }, Qt::QueuedConnection);
+    }
+    w.btnSelect->setEnabled(true);
+    w.btnSelect->setToolTip(QString());
+}
+
+// 物品库的生成与加载见 itemcatalog.cpp / catalogservice.cpp
+
+// 核心功能：内置的配置文件文本编辑器
+void VillagerEditor::openItemConfigEditor()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("⚙️ 编辑物品库配置 (items_config.csv)");
+    dialog.resize(600, 500);
+    QVBoxLayout layout(&dialog);
+
+    QLabel *helpLabel = new QLabel(
+        "<b>配置格式：</b> 分类, 英文ID, 中文名, Damage, 预设JSON<br>"
+        "<b>示例：</b> <code>武器, minecraft:diamond_sword, 钻石剑, 32767, \"[{\"\"name\"\":\"\"ench\"\",...}]\"</code><br>"
+        "<font color='gray'>注意：如果预设JSON中包含逗号或双引号，必须用双引号括起来，且内部的每个双引号写两次（如 \"\" ）。<br>"
+        "可使用下方的转换按钮将普通JSON快速转换为CSV兼容格式。</font>", &dialog);
+    layout.addWidget(helpLabel);
+
+    QTextEdit *editor = new QTextEdit(&dialog);
+    editor->setStyleSheet("font-family: Consolas, monospace; font-size: 14px;");
+
+    QString path = CatalogService::configPath();
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        editor->setPlainText(QString::fromUtf8(file.readAll()));
+        file.close();
+    }
+    layout.addWidget(editor);
+
+    QHBoxLayout *btnLayout = new QHBoxLayout();
+    QPushButton *btnSave = new QPushButton("保存并刷新", &dialog);
+    QPushButton *btnCancel = new QPushButton("取消", &dialog);
+    QPushButton *btnConvert = new QPushButton("转换选中JSON为CSV格式", &dialog);
+    btnLayout->addStretch();
+    btnLayout->addWidget(btnConvert);
+    btnLayout->addWidget(btnSave);
+    btnLayout->addWidget(btnCancel);
+    layout.addLayout(btnLayout);
+    //转换
+    connect(btnConvert, &QPushButton::clicked, [&]() {
+        QTextCursor cursor = editor->textCursor();
+        QString selected = cursor.selectedText();
+        if (selected.isEmpty()) {
+            QMessageBox::information(&dialog, "提示", "请先选中要转换的JSON文本。");
+            return;
+        }
+
+        // Qt的selectedText使用段落分隔符(U+2029)表示换行，转换为普通换行符
+        selected.replace(QChar(0x2029), '\n');
+
+        QString toConvert;
+
+        // 尝试解析为JSON对象或数组
+        QJsonParseError err;
+        QJsonDocument doc = QJsonDocument::fromJson(selected.toUtf8(), &err);
+        if (err.error == QJsonParseError::NoError && (doc.isArray() || doc.isObject())) {
+            // 成功解析，压缩为单行紧凑格式（自动处理转义）
+            toConvert = doc.toJson(QJsonDocument::Compact);
+        } else {
+            // 不是完整JSON，将其作为普通字符串，通过JSON序列化获得转义后的字符串内容
+            QJsonArray arr;
+            arr.append(selected);
+            QJsonDocument arrDoc(arr);
+            QString arrJson = arrDoc.toJson(QJsonDocument::Compact);
+            // arrJson 格式为 ["..."]，提取中间的转义字符串
+            if (arrJson.size() >= 4) {
+                // 去掉开头的 [" 和结尾的 "]
+                toConvert = arrJson.mid(2, arrJson.size() - 4);
+            } else {
+                toConvert = selected;
+            }
+        }
+
+        // CSV转义：每个双引号替换为两个，外层加双引号
+        QString escaped = toConvert;
+        escaped.replace("\"", "\"\"");
+        QString result = "\"" + escaped + "\"";
+
+        cursor.insertText(result);
+    });
+
+    // 保存功能
+    connect(btnSave, &QPushButton::clicked, [&, this]() {
+        QString content = editor->toPlainText();
+        QString path = CatalogService::configPath();
+        QFile file(path);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+            QTextStream out(&file);
+            out.setEncoding(QStringConverter::Utf8);
+            out << content;
+            file.close();
+
+            // 后台重新加载，完成后自动刷新补全；加载完成才算生效，届时再提示
+            connect(CatalogService::instance(), &CatalogService::catalogReady, this, [this]() {
+                statusBar()->clearMessage();
+                QMessageBox::information(this, "成功", "物品库配置已更新并生效！");
+            }, Qt::SingleShotConnection);
+            CatalogService::instance()->reload();
+            dialog.accept();
+            statusBar()->showMessage("物品库配置已保存，正在重新加载……");
+        } else {
+            QMessageBox::warning(this, "错误", "无法保存文件，请检查权限！");
+        }
+    });
+
+    connect(btnCancel, &QPushButton::clicked, &dialog, &QDialog::reject);
+
+    dialog.exec();
+}
+
+// 校验单个交易中三个物品的自定义节点
+static QList<NbtValidator::Issue> validateTradeCustomNodes(TradeOption trade, int index)
+{
+    QList<NbtValidator::Issue> issues;
+    NbtCodec::materialize(trade);   // 未打开过的交易，自定义节点还在原始节点里
+    const struct { const ItemData *item; const char *label; } items[3] = {
+        { &trade.buyA, "buyA" }, { &trade.buyB, "buyB" }, { &trade.sell, "sell" }
+    };
+    for (const auto &entry : items) {
+        if (!entry.item->enableCustom) continue;
+        const QString path = QString("交易 #%1 / %2").arg(index + 1).arg(QString::fromLatin1(entry.label));
+        // 启用了自定义节点，但 customNodes 为空（解析失败或内容为空），视为无效
+        if (entry.item->customNodes.isEmpty()) {
+            issues.append(NbtValidator::Issue{ path, "启用了自定义节点，但内容为空或不是合法的JSON数组" });
+            continue;
+        }
+        issues.append(NbtValidator::validateNodes(entry.item->customNodes, path));
+    }
+    return issues;
+}
+
+QList<NbtValidator::Issue> VillagerEditor::validateCustomNodes() const
+{
+    QList<NbtValidator::Issue> issues;
+    const VillagerDocument document = currentDocument();   // 隐式共享，工作线程只读
+    const bool multiple = document.villagers.size() > 1;
+    QList<QPair<int, int>> entries;   // (村民, 交易)
+    for (int v = 0; v < document.villagers.size(); ++v) {
+        for (int i = 0; i < document.villagers[v].trades.size(); ++i) entries.append({ v, i });
+    }
+    // 有多个村民时在路径前标出村民序号
+    auto check = [document, multiple](const QPair<int, int> &entry) {
+        QList<NbtValidator::Issue> found = validateTradeCustomNodes(document.villagers[entry.first].trades[entry.second], entry.second);
+        if (multiple) {
+            for (NbtValidator::Issue &issue : found) issue.path.prepend(QString("村民 #%1 / ").arg(entry.first + 1));
+        }
+        return found;
+    };
+
+    // 交易较少时直接顺序校验，较多时按交易并行
+    if (entries.size() < 64) {
+        for (const QPair<int, int> &entry : std::as_const(entries)) issues.append(check(entry));
+        return issues;
+    }
+
+    QFuture<QList<NbtValidator::Issue>> future = QtConcurrent::mapped(entries, check);
+    future.waitForFinished();
+    for (const QList<NbtValidator::Issue> &part : future.results()) issues.append(part);
+    return issues;
+}
+
+// 编辑时只校验正在编辑的这个物品，结果显示在输入框下方
+void VillagerEditor::validateCustomInput(ItemWidgets &w)
+{
+    if (!w.teCustom) return;
+    QString message;
+    const QString customText = w.teCustom->toPlainText().trimmed();
+    if (w.cbEnableCustom->isChecked() && !customText.isEmpty()) {
+        QJsonParseError err;
+        QJsonDocument doc = QJsonDocument::fromJson(escapeForJson(customText).toUtf8(), &err);
+        if (err.error != QJsonParseError::NoError) {
+            message = QString("JSON 解析错误（位置 %1）：%2").arg(err.offset).arg(err.errorString());
+        } else if (!doc.isArray()) {
+            message = "自定义节点必须是 JSON 数组";
+        } else {
+            const QList<NbtValidator::Issue> issues = NbtValidator::validateNodes(doc.array(), QString(), 4);
+            QStringList lines;
+            for (int i = 0; i < issues.size() && i < 3; ++i) lines << NbtValidator::formatIssue(issues[i]);
+            if (issues.size() > 3) lines << "……";
+            message = lines.join('\n');
+        }
+    }
+    w.lblCustomStatus->setText(message);
+    w.lblCustomStatus->setVisible(!message.isEmpty());
+}
+
+void VillagerEditor::onGlobalAttributeChanged()
+{
+    if (m_isUpdatingUI) return;
+    m_profession = m_cbProfession->currentData().toString();
+    m_markVariant = m_cbMarkVariant->currentData().toInt();
+
+    UndoStack::State next = m_undoStack.current();
+    if (next.profession != m_profession || next.markVariant != m_markVariant) {
+        next.profession = m_profession;
+        next.markVariant = m_markVariant;
+        next.focusRow = -1;
+        m_undoStack.commit(next, QString(), 64);
+        m_journal->recordGlobals(m_profession, m_markVariant);
+        updateUndoButtons();
+        updateVillagerList();
+    }
+    onDataChanged(); // 触发预览更新
+}
+
+UndoStack::State VillagerEditor::currentUndoState() const
+{
+    UndoStack::State state;
+    state.trades = PersistentList<TradeOption>::fromList(m_tradeOptions);
+    state.profession = m_profession;
+    state.markVariant = m_markVariant;
+    return state;
+}
+
+void VillagerEditor::undo()
+{
+    if (isBusy()) return;   // 快捷键在加载 / 保存期间也会触发
+    if (m_undoStack.undo()) applyUndoState();
+}
+
+void VillagerEditor::redo()
+{
+    if (isBusy()) return;
+    if (m_undoStack.redo()) applyUndoState();
+}
+
+void VillagerEditor::applyUndoState()
+{
+    VTE_TRACE("VillagerEditor::applyUndoState");
+    StallWatchdog::Stage stage("applyUndoState");
+    const UndoStack::State &state = m_undoStack.current();
+    const QList<TradeOption> before = m_tradeOptions;
+    m_tradeOptions = state.trades.toList();
+    m_journal->recordDiff(before, m_tradeOptions);
+    if (m_profession != state.profession || m_markVariant != state.markVariant) {
+        m_journal->recordGlobals(state.profession, state.markVariant);
+    }
+    m_profession = state.profession;
+    m_markVariant = state.markVariant;
+
+    m_isUpdatingUI = true;
+    int profIndex = m_cbProfession->findData(m_profession);
+    if (profIndex >= 0) m_cbProfession->setCurrentIndex(profIndex);
+    int varIndex = m_cbMarkVariant->findData(m_markVariant);
+    if (varIndex >= 0) m_cbMarkVariant->setCurrentIndex(varIndex);
+    m_isUpdatingUI = false;
+
+    // 选中被撤销 / 重做的修改所在的行；全局属性的修改保持原来的选中行
+    int row = m_undoStack.focusRow() >= 0 ? m_undoStack.focusRow() : m_selectedTradeRow;
+    row = qMin(row, int(m_tradeOptions.size()) - 1);
+    m_selectedTradeRow = row;
+    updateTradeTable();
+    if (row >= 0) {
+        NbtCodec::materialize(m_tradeOptions[row]);
+        populateUIFromData(m_tradeOptions[row]);
+    } else {
+        populateUIFromData(TradeOption());
+    }
+    updatePreview();
+    updateUndoButtons();
+    updateVillagerList();
+}
+
+void VillagerEditor::updateUndoButtons()
+{
+    m_btnUndo->setEnabled(m_undoStack.canUndo());
+    m_btnRedo->setEnabled(m_undoStack.canRedo());
+    const bool modified = isModified();
+    if (modified != m_modified) {
+        m_modified = modified;
+        emit modifiedChanged(modified);
+    }
+}
+
+bool VillagerEditor::isModified() const
+{
+    if (m_unsavedRecovery || !m_undoStack.isClean()) return true;
+    for (int i = 0; i < m_villagerUndo.size(); ++i) {
+        if (i != m_currentVillager && !m_villagerUndo[i].isClean()) return true;
+    }
+    return false;
+}
+
+// ==================== 多村民 ====================
+
+VillagerDocument VillagerEditor::currentDocument() const
+{
+    VillagerDocument document = m_document;
+    VillagerData &villager = document.villagers[m_currentVillager];
+    villager.trades = m_tradeOptions;
+    villager.profession = m_profession;
+    villager.markVariant = m_markVariant;
+    return document;
+}
+
+void VillagerEditor::storeActiveVillager()
+{
+    VillagerData &villager = m_document.villagers[m_currentVillager];
+    villager.trades = m_tradeOptions;
+    villager.profession = m_profession;
+    villager.markVariant = m_markVariant;
+}
+
+void VillagerEditor::switchVillager(int index)
+{
+    StallWatchdog::Stage stage("switchVillager");
+    if (m_isUpdatingUI || isBusy() || index == m_currentVillager || index < 0 || index >= m_document.villagers.size()) return;
+
+    storeActiveVillager();
+    std::swap(m_undoStack, m_villagerUndo[m_currentVillager]);
+    m_currentVillager = index;
+    std::swap(m_undoStack, m_villagerUndo[m_currentVillager]);
+    m_journal->recordSelectVillager(index);
+
+    const VillagerData &villager = m_document.villagers[index];
+    m_tradeOptions = villager.trades;
+    m_profession = villager.profession;
+    m_markVariant = villager.markVariant;
+    m_selectedTradeRow = -1;
+    updateTradeTable();
+    showCurrentVillager();
+}
+
+void VillagerEditor::updateVillagerList()
+{
+    m_isUpdatingUI = true;
+    const VillagerDocument document = currentDocument();
+    m_villagerList->clear();
+    for (int i = 0; i < document.villagers.size(); ++i) {
+        const VillagerData &villager = document.villagers[i];
+        const int profIndex = m_cbProfession->findData(villager.profession);
+        const QString profession = profIndex >= 0 ? m_cbProfession->itemText(profIndex) : villager.profession;
+        m_villagerList->addItem(QString("%1. %2（%3 条）").arg(i + 1).arg(profession).arg(villager.trades.size()));
+    }
+    m_villagerList->setCurrentRow(m_currentVillager);
+    m_villagerList->setVisible(document.villagers.size() > 1);
+    m_isUpdatingUI = false;
+}
@@ -1,154 +1,242 @@
-#ifndef VILLAGEREDITOR_H
-#define VILLAGEREDITOR_H
-
-#include <QMainWindow>
-#include <QTableWidget>
-#include <QLineEdit>
-#include <QSpinBox>
-#include <QCheckBox>
-#include <QTextEdit>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QGroupBox>
-#include <QPushButton>
-#include <QComboBox>
-#include <QCoreApplication>
-#include <QFile>
-#include <QTextStream>
-#include <QStringConverter>
-
-// ==================== 数据模型 ====================
-struct ItemData {
-    QString name = "minecraft:air";
-    int count = 1;
-    int damage = 0;
-
-    // Tag 字段
-    bool enableName = false;
-    QString displayName = "自定义名称";
-    bool enableLore = false;
-    QString lore = "自定义注释";
-    bool enableEnch = false;
-    int enchId = 9;
-    int enchLevel = 5;
-
-    // 新增：自定义 NBT 节点
-    bool enableCustom = false;
-    QJsonArray customNodes;   // 存储自定义节点数组，每个元素是完整的 {name,value,type}
-};
-
-struct TradeOption {
-    ItemData buyA;
-    ItemData buyB;
-    ItemData sell;
-    int uses = 0;
-    int maxUses = 12;
-    int tier = 0;
-};
-
-struct ItemMapping {
-    QString englishId;
-    QString chineseName;
-    int defaultDamage;
-    QString category;  // <== 新增分类字段
-    QString presetJson;  // 新增
-};
-
-// ==================== UI 控件组映射 ====================
-struct ItemWidgets {
-    QLineEdit *leName;
-    QPushButton *btnSelect;
-    QSpinBox *sbCount;
-    QSpinBox *sbDamage;
-
-    QCheckBox *cbEnableName;
-    QTextEdit *leDisp;      // 原 QLineEdit*
-
-    QCheckBox *cbEnableLore;
-    QTextEdit *leLore;      // 原 QLineEdit*
-
-    QCheckBox *cbEnableEnch;
-    QSpinBox *sbEnchId;
-    QSpinBox *sbEnchLvl;
-
-    // 新增：自定义 NBT 节点
-    QCheckBox *cbEnableCustom;
-    QTextEdit *teCustom;   // 用于输入 JSON 数组
-};
-
-class VillagerEditor : public QMainWindow
-{
-    Q_OBJECT
-
-public:
-    explicit VillagerEditor(QWidget *parent = nullptr);
-    ~VillagerEditor();
-
-private slots:
-    void openItemConfigEditor();
-    void loadFile();
-    void saveFile();
-    void onTableItemSelected(int row, int column);
-    void addTradeOption();
-    void deleteTradeOption();
-
-    // 统一的数据同步与 UI 联动槽函数
-    void onDataChanged();
-    void onTagCheckboxToggled();
-    void openItemSelector(ItemWidgets *widgets);
-    void onGlobalAttributeChanged(); // <== 新增：职业/变种改变时
-
-private:
-    bool validateCustomNodes() const;  // 新增：验证所有自定义节点是否有效
-    void initUI();
-    QGroupBox* createItemSection(const QString &title, ItemWidgets &widgets);
-    void updateTradeTable();
-    void extractGlobalAttributes(const QString &jsonText); // <== 新增函数声明
-
-    // 数据同步核心
-    void populateUIFromData(const TradeOption &trade);
-    void syncDataFromUI();
-
-    // NBT 解析
-    QList<TradeOption> parseNbtData(const QString &nbtText);
-    ItemData parseItemData(const QJsonArray &itemArr);
-
-    // NBT 构建核心
-    QJsonObject createNode(const QString &name, const QJsonValue &value, int type);
-    QJsonObject buildItemNbt(const QString &key, const ItemData &data);
-    QJsonObject buildTagNbt(const ItemData &data);
-    QJsonObject buildSingleTradeJson(const TradeOption &trade);
-    QString serializeNbtData(const QList<TradeOption> &trades);
-
-    // 物品选择器辅助
-    QList<ItemMapping> buildItemMappingList();
-    QString selectItemFromDialog(int &outDamage, QString &outPresetJson);
-
-    // 控件与状态
-    QTableWidget *m_tradeTable;
-    QTextEdit *m_tePreview;
-    QSpinBox *m_sbUses;
-    QSpinBox *m_sbMaxUses;
-    QSpinBox *m_sbTier;
-
-    // <== 新增：全局属性控件
-    QComboBox *m_cbProfession;
-    QComboBox *m_cbMarkVariant;
-
-    ItemWidgets wBuyA;
-    ItemWidgets wBuyB;
-    ItemWidgets wSell;
-
-    QList<TradeOption> m_tradeOptions;
-    int m_selectedTradeRow = -1;
-    bool m_isUpdatingUI = false; // 用于阻止 UI 填充时触发 onDataChanged
-    void updateCompleters();     // 新增：更新输入框的自动补全列表
-    QList<ItemMapping> loadItemMappings(); // 修改：从文件加载映射
-    void createDefaultItemConfig(const QString &path); // 新增：生成默认配置
-
-    // <== 新增：全局属性数据
-    QString m_profession;   // 职业字符串，不带 '+'，例如 "cartographer"
-    int m_markVariant;      // 变种数值 0-6
-};
-
-#endif // VILLAGEREDITOR_H
+#ifndef VILLAGEREDITOR_H
+#define VILLAGEREDITOR_H
+
+#include <QMainWindow>
+#include <QTableWidget>
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QCheckBox>
+#include <QTextEdit>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QGroupBox>
+#include <QPushButton>
+#include <QComboBox>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QStringConverter>
+#include <QLabel>
+#include <QFutureWatcher>
+#include <QProgressBar>
+#include <QListWidget>
+#include <QThreadPool>
+#include <QTimer>
+#include "itemcatalog.h"
+#include "nbtvalidator.h"
+#include "tradedata.h"
+#include "undostack.h"
+#include "documentio.h"
+#include "tradequery.h"
+#include "editjournal.h"
+
+class ItemIdResolver;
+class StallWatchdog;
+namespace BulkEdit { struct Transform; }
+
+class QGridLayout;
+
+// ==================== UI 控件组映射 ====================
+// 三个面板在第一次选中交易时才创建（见 ensureItemPanels），之前所有指针为空；
+// 显示名、Lore、附魔与自定义节点的编辑控件在第一次需要显示时才创建（见 ensureTagEditors）
+struct ItemWidgets {
+    QGridLayout *grid = nullptr;
+    QLineEdit *leName = nullptr;
+    QPushButton *btnSelect = nullptr;
+    QSpinBox *sbCount = nullptr;
+    QSpinBox *sbDamage = nullptr;
+
+    QCheckBox *cbEnableName = nullptr;
+    QTextEdit *leDisp = nullptr;      // 原 QLineEdit*
+
+    QCheckBox *cbEnableLore = nullptr;
+    QTextEdit *leLore = nullptr;      // 原 QLineEdit*
+
+    QCheckBox *cbEnableEnch = nullptr;
+    QWidget *enchBox = nullptr;       // ID 与等级两个输入框及其标签
+    QSpinBox *sbEnchId = nullptr;
+    QSpinBox *sbEnchLvl = nullptr;
+
+    // 新增：自定义 NBT 节点
+    QCheckBox *cbEnableCustom = nullptr;
+    QTextEdit *teCustom = nullptr;   // 用于输入 JSON 数组
+    QLabel *lblCustomStatus = nullptr;   // 自定义节点的实时校验结果
+};
+
+class VillagerEditor : public QMainWindow
+{
+    Q_OBJECT
+    friend class GuiBenchmark;   // 基准测试直接驱动界面控件与槽函数
+
+public:
+    explicit VillagerEditor(QWidget *parent = nullptr);
+    ~VillagerEditor();
+
+    void openPath(const QString &path);   // 在后台加载指定文件（正在加载或保存时忽略）
+    QString documentPath() const { return m_basePath; }   // 最近一次加载或保存的文件；新建的文档为空
+    bool isBusy() const;
+    // 有未保存的修改：某个村民的撤销栈不在加载或最近一次保存时的那一步，或恢复的结果还没保存
+    bool isModified() const;
+    // 恢复上次异常退出留下的编辑日志，替换本文档；应在空闲的新文档上调用，成功后删除旧日志
+    void recover(const EditJournal::Recovery &recovery);
+
+signals:
+    void documentPathChanged(const QString &path);
+    void modifiedChanged(bool modified);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private slots:
+    void openItemConfigEditor();
+    void loadFile();
+    void saveFile();
+    void exportPackedStructure();   // 所有村民打包成一个结构
+    void onTableItemSelected(int row, int column);
+    void addTradeOption();
+    void deleteTradeOption();
+    void bulkEditSelection();   // 对表格中选中的多条交易执行同一变换（见 bulkedit.h）
+
+    // 统一的数据同步与 UI 联动槽函数
+    void onDataChanged();
+    void onTagCheckboxToggled();
+    void openItemSelector(ItemWidgets *widgets);
+    void onGlobalAttributeChanged(); // <== 新增：职业/变种改变时
+    void undo();
+    void redo();
+    void toggleTracing();   // Ctrl+Alt+T：开始 / 停止热路径追踪，停止时导出 trace 文件
+    void showStallLog();    // Ctrl+Alt+W：界面卡顿记录汇总
+#ifdef VTE_MEMTRACE
+    void showMemoryStats(); // Ctrl+Alt+M：各阶段的内存分配统计（仅 CONFIG+=memtrace 构建）
+#endif
+
+private:
+    bool confirmBeforeWrite();   // 保存 / 导出前的校验与确认
+    QList<NbtValidator::Issue> validateCustomNodes() const;  // 校验所有交易的自定义节点（交易多时并行）
+    void validateCustomInput(ItemWidgets &w);                // 编辑时只校验当前物品的自定义节点
+    void initUI();
+    QGroupBox* createItemSection(const QString &title, ItemWidgets &widgets);
+    void ensureItemPanels();
+    // data 为新建控件的初始内容（为空时留空）；已创建的控件不受影响
+    void ensureTagEditors(ItemWidgets &w, const ItemData *data, bool name, bool lore, bool ench, bool custom);
+    const ItemData *selectedItemData(const ItemWidgets &w) const;
+    void setupItemCompleter(ItemWidgets &w);
+    void updateTradeTable();
+    void appendTradeRows(int from);   // 只追加 from 之后的行（后台加载时逐批填充）
+    void refreshTradeRows(const QList<int> &rows);   // 只重写这些行的单元格，不重建表格、不改变选择
+    void fillTradeRow(int row, const ItemIdResolver *resolver);
+    QList<int> selectedTradeRows() const;   // 被筛选隐藏的行不算在内
+    void applyBulkEdit(const BulkEdit::Transform &t, const QList<int> &rows);   // 一个撤销步骤、一次预览
+
+    // 筛选栏：表达式（见 tradequery.h）编译一次，对交易并行求值，不匹配的行在表格中隐藏
+    QLineEdit *m_leFilter;
+    QLabel *m_lblFilter;
+    QTimer m_filterTimer;   // 输入停顿后再编译，避免每个按键都重新筛选
+    TradeQuery m_filter;
+    void onFilterEdited();
+    void applyFilter(int from = 0);              // 重新判断 from 之后的各行
+    void applyFilterToRows(const QList<int> &rows);
+    void updateFilterLabel();
+    QList<int> matchedTradeRows() const;
+
+    // 数据同步核心
+    void populateUIFromData(const TradeOption &trade);
+    void syncDataFromUI();
+
+    // 预览：NBT 编解码见 nbtcodec.cpp。每个文档有自己的单线程序列化池，用当前文档的副本在后台生成文本；
+    // 生成期间的再次请求合并为一次，完成后用最新数据重新生成，过时的结果不显示
+    void updatePreview();
+    void setPreviewText(const QString &text);   // 直接显示给定文本（加载时的原文），正在生成的结果作废
+    void startPreview();
+    void onPreviewFinished();
+
+    // 物品选择器辅助
+    QList<ItemMapping> buildItemMappingList();
+    QString selectItemFromDialog(int &outDamage, QString &outPresetJson);
+
+    // 控件与状态
+    QTableWidget *m_tradeTable;
+    QTextEdit *m_tePreview;
+    QSpinBox *m_sbUses;
+    QSpinBox *m_sbMaxUses;
+    QSpinBox *m_sbTier;
+
+    // <== 新增：全局属性控件
+    QComboBox *m_cbProfession;
+    QComboBox *m_cbMarkVariant;
+
+    QGroupBox *m_editGroup;
+    QLabel *m_editHint;   // 面板创建前的提示
+    ItemWidgets wBuyA;
+    ItemWidgets wBuyB;
+    ItemWidgets wSell;
+
+    QList<TradeOption> m_tradeOptions;
+    int m_selectedTradeRow = -1;
+    bool m_isUpdatingUI = false; // 用于阻止 UI 填充时触发 onDataChanged
+    void updateCompleters();     // 物品库加载完成后挂接自动补全与选择按钮
+    void commitItemName(ItemWidgets &w);     // 把输入的别名解析为规范物品 ID
+    QStringList findUnknownItemIds() const;  // 物品库中不存在的物品 ID
+
+    // 撤销 / 重做：m_undoStack.current() 始终与下面的交易列表和全局属性一致
+    UndoStack m_undoStack;
+    QPushButton *m_btnUndo;
+    QPushButton *m_btnRedo;
+    UndoStack::State currentUndoState() const;   // 以当前数据重建完整快照（加载文件后）
+    void applyUndoState();                       // 把撤销栈的当前状态恢复到数据与界面
+    void updateUndoButtons();   // 同时在未保存状态变化时发出 modifiedChanged
+    bool m_unsavedRecovery = false;   // 恢复的结果在保存前始终算作修改
+    bool m_modified = false;          // 最近一次发出 modifiedChanged 时的状态
+
+    // 崩溃恢复：每次修改写入编辑日志，启动时在基准文件上重放上次异常退出前的修改
+    EditJournal *m_journal;
+    bool m_interactive = true;   // 是否弹出加载结果（界面基准测试中关闭）
+    QString m_basePath;     // 最近一次加载或保存的文件，日志以它为基准
+    void showLoadedDocument();   // 加载或恢复后刷新村民列表与下拉框、选中第一行并重置所有村民的撤销历史
+
+    // 卡顿监视：主线程卡住时记录正在执行的阶段（StallWatchdog::Stage）与文档大小
+    StallWatchdog *m_watchdog;
+    void updateDocumentSize();
+
+    // 后台加载 / 保存：期间禁用编辑控件，状态栏显示进度与取消按钮
+    QFutureWatcher<DocumentIO::LoadChunk> m_loadWatcher;
+    QFutureWatcher<QString> m_saveWatcher;
+    DocumentIO::LoadChunk m_loadHeader;   // 正在加载的文件的第一批结果（全局属性、原始文本）
+    QString m_loadingPath;
+    QString m_savingPath;
+    bool m_saveIsExport = false;
+    DocumentIO::CommitFlag m_saveCommitted;   // 正在保存的任务已替换目标文件（取消后仍以它为准）
+    QProgressBar *m_progress;
+    QPushButton *m_btnCancel;
+    QList<QWidget *> m_editControls;
+    void setBusy(const QString &message);
+    void clearBusy();
+    void onLoadResults(int begin, int end);
+    void onLoadFinished();
+    void onSaveFinished();
+    void setBasePath(const QString &path);
+
+    QThreadPool m_previewPool;
+    QFutureWatcher<QString> m_previewWatcher;   // 声明在池之后，先于池析构；池析构时等待正在生成的任务
+    quint64 m_previewSerial = 0;    // 每次请求或直接设置预览时递增
+    quint64 m_previewStarted = 0;   // 正在生成的结果对应的序号
+    bool m_previewQueued = false;   // 生成期间又有新的请求
+
+    // 多村民：m_document 保存文件中的所有村民，当前村民在上面的交易列表与全局属性中编辑，
+    // 切换村民时写回。每个村民有自己的撤销历史，当前村民的在 m_undoStack 中
+    VillagerDocument m_document;
+    int m_currentVillager = 0;
+    QList<UndoStack> m_villagerUndo;   // 下标与 m_document.villagers 对应；当前村民的一项不使用
+    QListWidget *m_villagerList;
+    VillagerDocument currentDocument() const;   // m_document 加上当前村民正在编辑的数据
+    void storeActiveVillager();
+    void switchVillager(int index);
+    void showCurrentVillager();   // 刷新下拉框、选中第一行（不重建表格）
+    void updateVillagerList();
+
+    // <== 新增：全局属性数据
+    QString m_profession;   // 职业字符串，不带 '+'，例如 "cartographer"
+    int m_markVariant;      // 变种数值 0-6
+};
+
+#endif // VILLAGEREDITOR_H